@@ -1,12 +1,13 @@
 /****************************************************************************************
  * Program:     e2a
  * Description: EBCDIC-To-ASCII Converter with packed fields (COMP-3) management
- *              for Codepage 273 (Germany)
+ *              for Codepage 273 (Germany), 1141, 037 and 500
  * Author:      Peter Ebel, peter.ebel@outlook.de
  * Date:        2017-09-27
- * Execution:   ./e2a <input ecbdic file> <output ascii file> <output metadata file> <input metadata file> <unique-number>
+ * Execution:   ./e2a [options] <input ecbdic file> <output ascii file> <output metadata file> <input metadata file> <unique-number>
  *
- * Compilation: gcc -lm e2a.c -o e2a
+ * Compilation: make (make check runs the self-test), or gcc e2a.c -o e2a -lm -lpthread -lz
+ *              with zstd input: make ZSTD=1, or gcc -DHAVE_ZSTD e2a.c -o e2a -lm -lpthread -lz -lzstd
  *
  * Change History
  * Version    By         Date        Change
@@ -26,22 +27,208 @@
  *                                   fix:     to exit if an unmanaged datatype is encountered
  *                                   feature: type T treated as type A
  * 1.7.5      Ebel       2021-10-16  fix: Euro symbol in Codepage
+ * 1.8        Ebel       2026-10-16  feature: --threads option, converts record-aligned chunks in parallel
+ *                                   fix:     ConvertDateToEuro() read/wrote past its local buffers
+ * 1.9        Ebel       2026-10-16  feature: memory-mapped input, fields are decoded straight from the mapping
+ * 1.10       Ebel       2026-10-16  feature: AVX2/SSE4.1 translation kernel selected at runtime, scans blanks for trim()
+ * 1.11       Ebel       2026-10-16  fields are converted and trimmed in place in the write buffer, no allocations per record
+ * 1.12       Ebel       2026-10-16  feature: packed and zoned decimals formatted in integer arithmetic
+ *                                   fix:     decimals longer than the output field length were cut off
+ * 1.13       Ebel       2026-10-16  feature: packed and zoned fields beyond 18 digits (128 bit up to 38 digits, digit by digit beyond)
+ * 1.14       Ebel       2026-10-16  records are converted by a record plan compiled from the metadata, adjacent text fields merged
+ * 1.15       Ebel       2026-10-16  feature: output written in large blocks by a flush thread (--output-buffer, --direct for O_DIRECT)
+ *                                   CR/LF replaced while trimming instead of a second pass over the record
+ * 1.16       Ebel       2026-10-16  feature: gzip and zstd input decompressed on a separate thread while converting
+ * 1.17       Ebel       2026-10-16  feature: --compress gzip|zstd, output blocks compressed on background threads
+ * 1.18       Ebel       2026-10-16  feature: --format parquet, typed columns in row groups, dictionary encoded text
+ * 1.19       Ebel       2026-10-16  feature: --batch manifest converts many files in one process (--jobs), metadata parsed once per schema
+ * 1.20       Ebel       2026-10-16  feature: --watch directory, files converted as soon as inotify reports their upload complete
+ * 1.21       Ebel       2026-10-16  feature: --generate synthetic EBCDIC test files from a schema, --benchmark with MB/s per stage
+ * 1.22       Ebel       2026-10-16  feature: runtime metrics per datatype, I/O wait and memory as JSON (--metrics) and Prometheus text (--metrics-prom)
+ * 1.23       Ebel       2026-10-16  feature: --reject-file, records with invalid sign nibbles are rejected instead of ending the run (--max-errors)
+ * 1.24       Ebel       2026-10-16  feature: --checkpoint, output synced and position saved periodically, --resume continues from there
+ * 1.25       Ebel       2026-10-16  feature: --columns projection and --where filter evaluated on the raw record before any conversion
+ * 1.26       Ebel       2026-10-16  feature: --sink fan-out, one read of the input feeds several outputs on threads of their own, --format fixed
+ * 1.27       Ebel       2026-10-16  feature: --shards, --shard-size and --shard-records write the output in parts listed in a manifest with crc32
+ * 1.28       Ebel       2026-10-16  feature: --recfm V|VB|VS|VBS, variable length records with RDW/BDW, a mapped input is indexed in one pass
+ * 1.29       Ebel       2026-10-16  feature: COBOL copybooks as metadata input with OCCURS, DEPENDING ON and REDEFINES (--when),
+ *                                   compiled once per copybook hash into <copybook>.e2ac
+ * 1.30       Ebel       2026-10-16  feature: binary integers (B, COMP/COMP-4/COMP-5), IEEE (F) and IBM hexadecimal (H, COMP-1/COMP-2) floats
+ * 1.31       Ebel       2026-10-16  feature: --codepage 273|1141|037|500 per file or per field (metadata column 8), --encoding utf8
+ * 1.32       Ebel       2026-10-16  feature: dates parsed at fixed positions in the format of the metadata (L:DD.MM.YYYY, L:YYYY-MM-DD,
+ *                                   L:YYYYMMDD, L:CYYMMDD), invalid dates left empty or rejected (--invalid-dates)
+ * 1.32.1     Ebel       2026-10-16  fix: an undecodable record, unreadable input or failed output write fails only its file, a batch or
+ *                                   watch goes on with the next one
+ * 1.32.2     Ebel       2026-10-16  fix: the batch summary reports the records read and rejected of failed files as well
+ * 1.32.3     Ebel       2026-10-16  fix: zoned decimals accept C, A and E as plus signs like COBOL writes them, not only F
+ * 1.32.4     Ebel       2026-10-16  feature: --self-test compares the AVX2/SSE4.1 translation kernels with the scalar table lookup
+ *                                   fix:     a kernel differing at startup is logged as an error
+ * 1.32.5     Ebel       2026-10-16  feature: --self-test compares FormatDecimal()/FormatDecimal128() with the "%.*Lf" output they replaced
+ * 1.32.6     Ebel       2026-10-16  fix:     -DE2A_COUNT_ALLOCATIONS counts the threaded, fan-out, shard and Parquet loops too, fails the file on any
+ * 1.32.7     Ebel       2026-10-16  fix:     ingestion types and lengths of packed and zoned decimals by their stored digits, as in Parquet
+ * 1.32.8     Ebel       2026-10-16  fix:     usage of --recfm: a decimal field a short record cuts in its middle is rejected, not zero
+ * 1.32.9     Ebel       2026-10-16  fix:     usage of --shards: the part number goes before the extensions of the output file name
+ * 1.32.10    Ebel       2026-10-16  fix:     conditions on text fields compare the text as it is written: trimmed, without " and |
+ * 1.32.11    Ebel       2026-10-16  fix:     packed and zoned decimals with a digit nibble above 9 are rejected like invalid signs
+ * 1.32.12    Ebel       2026-10-16  fix:     --self-test decodes and formats every value up to +-2000000 and random values of 17, 18
+ *                                            and 38 digits, compared with the digit by digit decoding and "%.*Lf" output they replaced
+ * 1.32.13    Ebel       2026-10-16  fix:     checkpoints save the input offset the records end at, descriptor words included, and
+ *                                            --resume checks the input against it
+ * 1.32.14    Ebel       2026-10-16  fix:     gzip input is only detected with the deflate method byte after its magic bytes
+ * 1.32.15    Ebel       2026-10-16  fix:     Makefile, make check runs --self-test on the kernels and decimal formatting of every build
  ****************************************************************************************/
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
 #include <string.h>
-#include <math.h>
 #include <time.h>
 #include <ctype.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include <sys/resource.h>
 #include <linux/limits.h>
+#include <math.h>
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#define E2A_VERSION "1.32.15"
+
+//input bytes per chunk handed to a worker thread in parallel mode
+#define CHUNK_SIZE (1024 * 1024)
+#define MAX_THREADS 256
+#define BATCH_JOBS 4                     //files of a batch converted at the same time
+#define BENCH_BLOCK_RECORDS 1024         //records a benchmark stage processes before the next stage runs on them
+
+//runtime metrics: one record in METRICS_SAMPLE_RECORDS is timed field by field,
+//converting threads add their counts to the process metrics every METRICS_FLUSH_RECORDS records
+#define METRIC_TYPES 8
+#define METRICS_SAMPLE_RECORDS 64
+#define METRICS_FLUSH_RECORDS 4096
+
+//tolerant conversion: rejected records above the threshold abort the file, the first few are logged as well
+#define REJECT_MAX_ERRORS 1000
+#define REJECT_LOGGED_RECORDS 10
+
+//checkpoints of text output: taken every CHECKPOINT_SECONDS unless given, the single-threaded loop
+//looks at the clock every CHECKPOINT_CHECK_RECORDS records (a power of two)
+#define CHECKPOINT_SECONDS 60
+#define CHECKPOINT_CHECK_RECORDS 4096
+
+//--where conditions, all of them must hold for a record to be converted
+#define MAX_FILTERS 16
+
+//--sink outputs fed by the same read of the input besides the output file,
+//the reader stays up to FANOUT_CHUNKS chunks ahead of the slowest sink
+#define MAX_SINKS 8
+#define FANOUT_CHUNKS 4
+
+//output blocks, O_DIRECT needs block sizes, offsets and buffers aligned
+#define OUTPUT_BLOCK_SIZE_MB 8
+#define MAX_OUTPUT_BLOCK_SIZE_MB 1024
+#define OUTPUT_ALIGNMENT 4096
+
+//compression of the output file, every output block is compressed on its own
+enum { COMPRESS_NONE, COMPRESS_GZIP, COMPRESS_ZSTD };
+#define COMPRESS_LEVEL_GZIP 3
+#define COMPRESS_LEVEL_ZSTD 3
+
+//Parquet output, text columns with more distinct values in a row group are written plain
+enum { FORMAT_TEXT, FORMAT_PARQUET, FORMAT_FIXED };
+#define PARQUET_ROW_GROUP_RECORDS 1000000
+#define PARQUET_DICTIONARY_ENTRIES 65536
+#define PARQUET_DICTIONARY_BYTES (1024 * 1024)
+#define PARQUET_ROW_GROUP_CAPACITY 16
+//enumerations of parquet.thrift
+enum { PARQUET_BOOLEAN, PARQUET_INT32, PARQUET_INT64, PARQUET_INT96, PARQUET_FLOAT, PARQUET_DOUBLE, PARQUET_BYTE_ARRAY, PARQUET_FIXED_LEN_BYTE_ARRAY };
+enum { LOGICAL_NONE = 0, LOGICAL_STRING = 1, LOGICAL_DECIMAL = 5, LOGICAL_DATE = 6 };
+enum { CODEC_UNCOMPRESSED = 0, CODEC_GZIP = 2, CODEC_ZSTD = 6 };
+#define ENCODING_PLAIN 0
+#define ENCODING_RLE 3
+#define ENCODING_RLE_DICTIONARY 8
+#define PAGE_DATA 0
+#define PAGE_DICTIONARY 2
+//types of the thrift compact protocol
+enum { THRIFT_STOP, THRIFT_TRUE, THRIFT_FALSE, THRIFT_BYTE, THRIFT_I16, THRIFT_I32, THRIFT_I64, THRIFT_DOUBLE, THRIFT_BINARY, THRIFT_LIST, THRIFT_SET, THRIFT_MAP, THRIFT_STRUCT };
+
+//compressed input is decompressed by a thread into a ring of record-aligned buffers
+enum { INPUT_PLAIN, INPUT_GZIP, INPUT_ZSTD };
+#define INPUT_BUFFERS 4
+#define INPUT_READ_SIZE (256 * 1024)
+
+//record formats of the input: fixed length records as given by the metadata, or variable length records behind a
+//record descriptor word (RDW), in blocks behind a block descriptor word (BDW) and spanned over segments
+enum { RECFM_F, RECFM_V, RECFM_VB, RECFM_VS, RECFM_VBS };
+//segment control code in the third byte of the RDW of a spanned record
+enum { SEGMENT_COMPLETE, SEGMENT_FIRST, SEGMENT_LAST, SEGMENT_MIDDLE };
+#define DESCRIPTOR_WORD_LENGTH 4
+#define RECORD_INDEX_RECORDS (1024 * 1024)   //first size of the record index, doubled as needed
+
+//blank as isspace() sees it in the C locale
+#define IS_BLANK(c) ((c) == ' ' || ((c) >= '\t' && (c) <= '\r'))
+
+//decoding paths of packed and zoned fields, chosen per field by the number of digits
+enum { DECIMAL_LONG, DECIMAL_INT128, DECIMAL_DIGITS };
+#define MAX_DIGITS_LONG   18
+#define MAX_DIGITS_INT128 38
+
+//binary integers hold up to 5, 10 or 19 digits in 2, 4 or 8 bytes, unsigned 8 bytes up to 20, floats are written with
+//the significant digits that read back to the same value, %.17g takes up to 24 characters
+#define MAX_DIGITS_UNSIGNED_LONG 20
+#define FLOAT_TEXT_LENGTH 24
+
+//output encodings of text: the single byte ISO-8859 characters of the code page, or UTF-8 with up to two bytes per
+//character, three for the euro sign
+enum { ENCODING_LATIN1, ENCODING_UTF8 };
+//--self-test: field lengths the translation kernels are compared on (two AVX2 vectors and every tail up to 63 bytes),
+//differences logged at most per test
+#define TEST_KERNEL_LENGTH 127
+#define TEST_LOGGED_ERRORS 10
+//--self-test: decimals decoded and formatted, every value up to +- TEST_SWEEP_VALUE and TEST_RANDOM_VALUES random ones
+#define TEST_SWEEP_VALUE 2000000
+#define TEST_SWEEP_PRECISION 8
+#define TEST_RANDOM_VALUES 5000000
+#define UTF8_EURO_LENGTH 3
+
+//input formats of dates (L), given in the metadata as L:FORMAT, DD.MM.YYYY without, all written as YYYY-MM-DD,
+//CYYMMDD is the AS400 date with C 0 for 19YY and 1 for 20YY, packed in 4 bytes or as 7 digits of text
+enum { DATE_DMY, DATE_ISO, DATE_YYYYMMDD, DATE_CYYMMDD };
+#define DATE_TEXT_LENGTH 10
+//result of parsing a date: blank and zero dates are no date and left empty like invalid ones
+enum { DATE_VALID, DATE_NULL, DATE_INVALID };
+#define IS_PACKED_DATE(pField) ((pField)->iDateFormat == DATE_CYYMMDD && (pField)->iInputFieldLength == 4)
+
+//COBOL copybooks as metadata input: names, REDEFINES alternatives and the compiled form next to the copybook
+#define MAX_COBOL_NAME 30
+#define MAX_FIELD_NAME 40                //a COBOL name with the occurrence numbers of its OCCURS
+#define MAX_ALTERNATIVES 64              //REDEFINES alternatives of a copybook, one bit each per record
+#define COPYBOOK_MAGIC "E2AC"
+
+//words of a data description entry kept, longer ones are VALUE lists of condition names, and the longest PICTURE
+#define MAX_COPYBOOK_TOKENS 64
+#define MAX_COPYBOOK_TOKEN 80
+#define MAX_PICTURE 50
+
+//USAGE of copybook items, NONE until an item or one of its groups gives it
+enum { USAGE_NONE, USAGE_DISPLAY, USAGE_PACKED, USAGE_BINARY, USAGE_FLOAT, USAGE_DOUBLE };
 
 //main types of objects
 //holds the structure metadata
 typedef struct tag_metadatarecord {
-  char sFieldname[11];
-  char sSize[5];
+  char sFieldname[MAX_FIELD_NAME + 1];
+  char sSize[8];
   int  iInputPosition;
   int  iOutputPosition;
   int  iPrecision;
@@ -50,8 +237,14 @@ typedef struct tag_metadatarecord {
   int  iTo;
   int  iInputFieldLength;
   int  iOutputFieldLength;
+  int  iDigits;                  //packed and zoned fields: number of digits stored
+  int  iDecimalPath;             //packed and zoned fields: DECIMAL_LONG, DECIMAL_INT128 or DECIMAL_DIGITS
   char sDescription[50];
   char sTranslation[50];
+  int  iAlternative;             //copybook fields: REDEFINES alternative the field lies in, counted from 1, 0 outside of any
+  int  iUnsigned;                //binary fields without sign, copybook PICTURE without S
+  int  iCodePage;                //text and date fields: index in CodePages + 1 from column 8, 0 for the code page of the file
+  int  iDateFormat;              //date fields: DATE_DMY, DATE_ISO, DATE_YYYYMMDD or DATE_CYYMMDD of the input
 } METADATARECORD;
 
 //holds metadata required by the file ingestion process
@@ -59,13 +252,144 @@ typedef struct tag_ingestionmetadata {
   char sDatabase[100];
   char sTable[20];
   int  iFieldposition;
-  char sFieldname[20];
+  char sFieldname[MAX_FIELD_NAME + 1];
   char sDatatype[20];
   int  iLength;
   int  iPrecision;
   int  iPositionInPK;
 } INGESTIONMETADATA;
 
+//states of an output block, a block being filled is still free for the other threads
+enum { BLOCK_FREE, BLOCK_FILLED, BLOCK_COMPRESSED };
+
+typedef struct tag_outputblock {
+  unsigned char *pData;
+  unsigned char *pCompressed;    //NULL without compression
+  size_t lLength;
+  size_t lCompressedLength;
+  int    iState;
+  long   lCheckpointRecords;     //input records complete at the end of the block, 0 if no checkpoint follows it
+  long   lCheckpointRejected;
+  off_t  lCheckpointInput;       //offset of the (decompressed) input these records end at
+} OUTPUTBLOCK;
+
+//block writer of the output file: records are collected in large aligned blocks, full blocks are
+//compressed by the compressor threads (if any) and written in their order by the flush thread with pwrite()
+//while the next block is filled
+typedef struct tag_outputwriter {
+  int  fd;
+  int  iDirect;                  //file is written with O_DIRECT
+  int  iCompression;             //COMPRESS_NONE, COMPRESS_GZIP or COMPRESS_ZSTD
+  int  iCompressThreads;
+  size_t lBlockSize;
+  size_t lCompressedCapacity;
+  OUTPUTBLOCK *Blocks;           //ring of blocks
+  int  iNumberOfBlocks;
+  long lNextToFill;              //sequence number of the block being filled
+  long lNextToCompress;          //sequence number of the next block to be picked up by a compressor
+  long lNextToFlush;             //sequence number of the next block to be written
+  size_t lFill;                  //bytes in the current block, may exceed lBlockSize by one record
+  off_t lOffset;                 //file offset of the next block to be written
+  const char *sCheckpointFileName;  //NULL without checkpoints
+  int  iInputRecordLength;
+  int  iChecksum;                //the crc32 of the bytes written is kept, parts of a sharded output only
+  unsigned long lCrc;
+  int  iStop;
+  int  iFailed;                  //a write failed, the rest is dropped and the file fails
+  pthread_t FlushThread;
+  pthread_t CompressThreads[MAX_THREADS];
+  pthread_mutex_t mutex;
+  pthread_cond_t  cond;
+} OUTPUTWRITER;
+
+//input read by a thread: gzip and zstd files are decompressed, pipes are read ahead as they are
+typedef struct tag_inputstream {
+  int  iCodec;
+  FILE *fpInFile;
+  unsigned char sMagic[4];       //bytes read to detect the codec, they are the first input of the thread
+  size_t lMagicLength;
+  unsigned char *pBuffers[INPUT_BUFFERS];
+  size_t lLengths[INPUT_BUFFERS];
+  size_t lCapacity;              //whole records only, so only the last buffer can end in a partial record
+  long lNextToFill;              //sequence number of the buffer being filled by the thread
+  long lNextToRead;              //sequence number of the buffer being read by the converter
+  size_t lReadOffset;            //offset of the next record in the buffer being read
+  int  iEndOfInput;
+  int  iFailed;                  //the input could not be read or decompressed, the file fails
+  pthread_t Thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t  cond;
+} INPUTSTREAM;
+
+//growable byte buffer of the Parquet writer
+typedef struct tag_bytebuffer {
+  unsigned char *pData;
+  size_t lLength;
+  size_t lCapacity;
+} BYTEBUFFER;
+
+//a column of the Parquet file, the values of the current row group are kept plain encoded
+typedef struct tag_parquetcolumn {
+  METADATARECORD *pField;
+  int  iType;                    //physical type
+  int  iLogicalType;
+  int  iTypeLength;              //fixed length byte arrays only
+  int  iScale;
+  int  iPrecision;
+  int  iOptional;                //values may be null, a definition level is kept per row
+  BYTEBUFFER Values;
+  int  *pOffsets;                //byte arrays: offset of the value of every row in Values
+  unsigned char *pDefined;       //optional columns: definition level of every row
+  int  iNulls;
+} PARQUETCOLUMN;
+
+//where a column chunk of a row group went, needed for the file metadata
+typedef struct tag_parquetchunk {
+  long lFileOffset;
+  long lDataPageOffset;
+  long lDictionaryPageOffset;    //-1 without dictionary
+  long lUncompressedSize;
+  long lCompressedSize;
+  long lValues;
+} PARQUETCHUNK;
+
+typedef struct tag_parquetwriter {
+  PARQUETCOLUMN *Columns;
+  int  iColumns;
+  int  iRowGroupSize;            //rows per row group
+  int  iRows;                    //rows of the current row group
+  long lTotalRows;
+  int  iCompression;             //COMPRESS_NONE, COMPRESS_GZIP or COMPRESS_ZSTD for the pages
+  long lOffset;                  //bytes written to the file
+  PARQUETCHUNK *Chunks;          //iColumns per row group
+  long *RowGroupRows;
+  long *RowGroupSizes;
+  int  iRowGroups;
+  int  iRowGroupCapacity;        //row groups the metadata arrays hold
+  BYTEBUFFER Page;               //page being built
+  BYTEBUFFER Compressed;
+  BYTEBUFFER Header;             //thrift encoded page header and file metadata
+  BYTEBUFFER Dictionary;
+  int  *HashTable;               //dictionary entry + 1 per slot, 0 if free
+  int  *DictionaryOffsets;       //offset of every dictionary entry in Values
+  unsigned int *Indices;         //dictionary index of every row
+  unsigned char *pScratch;       //a text field being translated and trimmed
+  int  iFieldDepth;              //thrift: last field id of every open struct
+  int  LastFieldIds[8];
+  z_stream zs;
+#ifdef HAVE_ZSTD
+  ZSTD_CCtx *cctx;
+#endif
+} PARQUETWRITER;
+
+//a part of a sharded output as listed in the manifest
+typedef struct tag_part {
+  char sFileName[PATH_MAX];
+  long lRecords;
+  long lBytes;
+  unsigned long lCrc;
+} PART;
+
 //the main container
 typedef struct tag_converter {
   char sDatabase[40];
@@ -76,33 +400,480 @@ typedef struct tag_converter {
   int  iInputRecordLength;
   int  iOutputRecordLength;
   int  iNumberOfAttributes;
+  int  iWriteRecordSize;         //size of the write buffer of one record
+  int  iWriteRecordGrowth;       //UTF-8 output: bytes text may take beyond its characters, part of iWriteRecordSize
   int  iCurrentRecord;
+  int  iNumberOfThreads;
+  int  iUseMmap;
+  int  iOutputBlockSizeMB;
+  int  iDirectOutput;
+  int  iCompression;
+  int  iCompressThreads;
+  int  iOutputFormat;            //FORMAT_TEXT, FORMAT_PARQUET or FORMAT_FIXED
+  int  iRowGroupSize;
+  PARQUETWRITER *pParquet;
+  const struct tag_codepage *pCodePage;
+  int  iEncoding;                //ENCODING_LATIN1 or ENCODING_UTF8 of the text output
+  int  iRejectDates;             //invalid dates are undecodable fields instead of being left empty
+  unsigned char *pInputMap;      //whole input file if it could be mapped, NULL otherwise
+  size_t lInputMapSize;
+  size_t lInputOffset;           //offset of the next record to be read from the mapping
+  off_t lInputPosition;          //offset of the (decompressed) input the records read so far end at, descriptor words included
+  INPUTSTREAM *pInputStream;     //decompressing input thread, NULL if the input is read directly
+  int  iRecordFormat;            //RECFM_F, RECFM_V, RECFM_VB, RECFM_VS or RECFM_VBS
+  size_t *RecordIndex;           //variable length records of a mapped input: offset of the first RDW of every record
+  long lIndexedRecords;
+  long lNextRecord;              //variable length records: number of the next record to be read, counted from 0
+  long lBlockRemaining;          //variable length records read sequentially: bytes left in the current block
+  unsigned char *pPadRecord;     //variable length records: fill of the bytes a short record lacks, by datatype
+  int  *PadFieldEnds;            //end of the decimal field a short record ends inside of, by record length, 0 between fields
+  long lShortRecords;            //variable length records shorter than the metadata, missing fields filled
+  long lLongRecords;             //variable length records longer than the metadata, cut
+  int  iAlternatives;            //copybook: REDEFINES alternatives, the items redefined and redefining
+  char (*AlternativeNames)[MAX_FIELD_NAME + 1];
+  int  *AlternativeParents;      //alternative a nested alternative lies in, 0 at the top
+  const char *When[MAX_FILTERS]; //--when ALTERNATIVE:CONDITION as given
+  int  iWhenConditions;
+  struct tag_filter *Selectors;  //--when conditions compiled for the metadata, each with its alternative
+  int  iSelectors;
+  int  iOccursMax;               //copybook OCCURS DEPENDING ON: maximum number of occurrences, 0 without
+  int  iDependingField;          //metadata index of the counter
+  int  iOccursPosition;          //first byte and length of the occurrences
+  int  iOccursLength;
+  int  iSelectFields;            //--when or DEPENDING ON: the fields to convert are chosen record by record
   unsigned char *pReadBuffer;
-  unsigned char *pWriteBuffer;
   char sUUID[36];
   FILE *fpInFile;
-  FILE *fpOutFile;
+  OUTPUTWRITER Output;
   FILE *fpIngestionMetadataFile;
   METADATARECORD **Metadata;     //pointer to an array of metadata structures
+  struct tag_fieldplan *Plan;    //record plan compiled from the metadata
+  int  iPlanSteps;
+  int  *PlanFieldLengths;
+  int  iRejectRecords;           //bad records go to the reject file instead of ending the run
+  long lMaxErrors;               //rejected records tolerated before the file is aborted
+  long lRejected;
+  int  iAbort;                   //too many rejected records, the conversion stops
+  long lSteadyStateAllocations;  //heap allocations of the conversion loops after their first record, -DE2A_COUNT_ALLOCATIONS
+  int  iCheckpointSeconds;       //0 without checkpoints
+  int  iResume;                  //continue from the checkpoint of the output file if there is one
+  char sCheckpointFileName[PATH_MAX];
+  double dNextCheckpoint;
+  long lResumeRecords;           //records converted before the checkpoint, 0 if the conversion starts from the beginning
+  off_t lResumeOffset;           //length of the output file at the checkpoint
+  off_t lResumeInput;            //input offset the records converted before the checkpoint end at
+  const char *sColumns;          //--columns: comma separated field names, NULL for all fields
+  const char *Where[MAX_FILTERS];  //--where conditions as given
+  int  iWhereConditions;
+  int  *Columns;                 //metadata index of every output column, in the order of the metadata
+  int  iNumberOfColumns;
+  struct tag_filter *Filters;    //--where conditions compiled for the metadata
+  int  iFilters;
+  const char *SinkSpecs[MAX_SINKS];  //--sink FILE[:key=value...] as given
+  int  iSinkSpecs;
+  struct tag_converter *Sinks[MAX_SINKS];  //converters of the sinks, sharing the metadata of this one
+  int  iSinks;
+  char *sSinkSpec;               //a sink: copy of its spec, its columns and conditions point into it
+  int  iShards;                  //parts written in parallel, 1 for parts one after the other, 0 for a single output file
+  long lShardBytes;              //a part is closed once its output reaches this many bytes, 0 without limit
+  long lShardRecords;            //a part is closed once it holds this many records, 0 without limit
+  struct tag_converter **Shards; //converters of the parallel shards, sharing the record plan of this one
+  int  iShard;                   //a shard: its number
+  int  iPart;                    //number of the current part of this converter
+  long lPartRecords;             //records written to the current part
+  long lPartBytes;
+  PART *Parts;                   //parts closed by this converter
+  int  iParts;
+  char sPartBaseName[PATH_MAX];  //output file name the parts are named after
 } CONVERTER;
 
+//a trimmed field inside the write buffer
 typedef struct tag_trimbuffer {
-  unsigned char *pBuffer;
+  char *pBuffer;
   int iLength;
 } TRIMBUFFER;
 
-//global buffers (easier to deallocate)
-char *pDateTimeBuffer;
+//result of scanning a translated text field for trim()
+typedef struct tag_textscan {
+  int iFirst;                    //first non-blank position, -1 if the field is blank
+  int iLast;                     //last non-blank position
+  int iSpecial;                  //field contains characters trim() filters out (" and |) or replaces (CR/LF)
+  int iHigh;                     //field contains characters outside of ASCII, more than one byte each in UTF-8
+} TEXTSCAN;
+
+//translation kernel: table lookup of count bytes, optionally scanning the result
+typedef void (*TRANSLATEKERNEL)(unsigned char *, const unsigned char *, size_t, const unsigned char *, TEXTSCAN *);
+
+//an EBCDIC code page and its 256 entry translation table into ISO-8859 characters
+typedef struct tag_codepage {
+  const char *sName;
+  const unsigned char *pTable;
+  unsigned char cEuro;           //character of the table that stands for the euro sign in UTF-8, 0 without
+} CODEPAGE;
+
+//a step of the record plan compiled from the metadata: one field or a run of adjacent text fields
+typedef struct tag_fieldplan {
+  int (*Handler)(const struct tag_fieldplan *, const unsigned char *, char *);
+  int  iInputPosition;
+  int  iInputFieldLength;        //length of all fields of the step
+  int  iPrecision;
+  int  iFields;                  //number of fields of the step
+  const int *pFieldLengths;      //input length of every field of the step
+  const unsigned char *pTable;   //translation table of text fields
+  unsigned char cEuro;           //UTF-8 output: character of pTable written as the euro sign, 0 without
+  char cDatatype;
+  int  iMetricType;              //index of the datatype in the metrics, a text run counts as its first field
+  int  iField;                   //index of the first field of the step in the metadata
+  int  iWidth;                   //fixed-width output: width of the field
+  int  iAlternative;             //REDEFINES alternative of the fields of the step, 0 if they are always converted
+  int  iDateFormat;              //dates: format of the input
+  int  iRejectDates;             //dates: an invalid date rejects the record
+} FIELDPLAN;
+
+//an item of a copybook, group or elementary, laid out in the occurrence of its group
+typedef struct tag_copybookitem {
+  int  iLevel;
+  char sName[MAX_COBOL_NAME + 1];        //empty for FILLER
+  char sRedefines[MAX_COBOL_NAME + 1];
+  char sDependingOn[MAX_COBOL_NAME + 1];
+  char sPicture[MAX_PICTURE + 1];
+  int  iUsage;
+  int  iOccurs;                          //maximum number of occurrences, 0 without OCCURS
+  int  iParent;                          //group of the item, -1 for records
+  int  iRedefined;                       //item the item redefines, the first record for later ones, -1 if none
+  int  iOffset;                          //first byte in the occurrence of the group
+  int  iLength;                          //bytes of one occurrence
+  int  iAlternative;                     //REDEFINES alternative of the item, 0 if it is neither redefined nor redefines
+  char cDatatype;                        //elementary items: A, S, P, B or H
+  int  iSigned;                          //PICTURE with S
+  int  iDigits;
+  int  iPrecision;
+  int  iLine;
+} COPYBOOKITEM;
+
+//header of a compiled copybook <copybook>.e2ac, followed by the names and parents of its alternatives, entry 0 included,
+//and its metadata records
+typedef struct tag_copybookcache {
+  char sMagic[4];
+  int  iRecordSize;                      //sizeof(METADATARECORD) of the writer
+  unsigned long lHash;                   //FNV-1a of E2A_VERSION and the copybook
+  int  iNumberOfAttributes;
+  int  iInputRecordLength;
+  int  iOutputRecordLength;
+  int  iWriteRecordSize;
+  int  iAlternatives;
+  int  iDependingField;
+  int  iOccursPosition;
+  int  iOccursLength;
+  int  iOccursMax;
+} COPYBOOKCACHE;
+
+//comparison results a --where condition accepts: bit 0 less, bit 1 equal, bit 2 greater
+enum { FILTER_LT = 1, FILTER_EQ = 2, FILTER_GT = 4 };
+
+//a --where condition compiled for the metadata: text is compared through the translation table byte by byte,
+//packed and zoned fields as integers scaled to the precision of the field, nothing is formatted
+typedef struct tag_filter {
+  int  iField;                   //index of the field in the metadata
+  int  iAccept;                  //FILTER_LT, FILTER_EQ and FILTER_GT combined
+  int  iInputPosition;
+  int  iInputFieldLength;
+  char cDatatype;
+  int  iDecimalPath;
+  __int128 llValue;              //packed and zoned fields
+  unsigned char *pText;          //text fields: the value without leading and trailing blanks
+  int  iTextLength;
+  const unsigned char *pTable;
+  int  iAlternative;             //--when: the REDEFINES alternative the condition selects
+  int  iUnsigned;                //binary fields without sign
+} FILTER;
+
+//states of a chunk in the parallel conversion pipeline
+enum { CHUNK_FREE, CHUNK_READ, CHUNK_CONVERTED };
+
+//a record-aligned piece of the input file together with its converted output
+typedef struct tag_chunk {
+  unsigned char *pReadBuffer;
+  unsigned char *pRecords;       //either pReadBuffer or a pointer into the input mapping
+  unsigned char *pWriteBuffer;
+  int    iRecords;
+  size_t iWriteLength;
+  int    iState;
+  long   lFirstRecord;       //record number of the first record of the chunk
+  long   lFirstIndex;        //variable length records of a mapped input: index of the first record, gathered by the worker
+  off_t  lInputEnd;          //input offset the records of the chunk end at
+  int    iRejected;
+  int    iWritten;           //records in the write buffer, filtered and rejected ones are not
+  int    iPending;           //fan-out: sinks that haven't converted the chunk yet
+} CHUNK;
+
+//shared state of the reader/writer (main thread) and the worker threads
+typedef struct tag_workqueue {
+  CONVERTER *cv;
+  CHUNK *Chunks;
+  int  iNumberOfChunks;
+  int  iRecordsPerChunk;
+  long lNextToRead;       //sequence number of the next chunk to be read
+  long lNextToConvert;    //sequence number of the next chunk to be picked up by a worker
+  long lNextToWrite;      //sequence number of the next chunk to be written
+  long lRecordsRead;      //record number of the next chunk to be read, counted from 1
+  int  iEndOfInput;
+  pthread_mutex_t mutex;
+  pthread_cond_t  cond;
+} WORKQUEUE;
+
+//shared state of the reader (main thread) and the sink threads of a fan-out, every sink converts every chunk,
+//parallel shards are converted the same way, every shard converts every iStride-th chunk
+typedef struct tag_fanout {
+  CONVERTER *cv;
+  CHUNK *Chunks;
+  int  iNumberOfChunks;
+  int  iRecordsPerChunk;
+  int  iSinks;                   //the output file counts as a sink, shards are sinks of their own
+  int  iStride;                  //1 for sinks, the number of shards for shards
+  long lNextToRead;
+  int  iEndOfInput;
+  pthread_mutex_t mutex;
+  pthread_cond_t  cond;
+} FANOUT;
+
+//a sink or shard thread of a fan-out and the next chunk it converts
+typedef struct tag_sinkthread {
+  FANOUT *fo;
+  CONVERTER *cv;
+  long lNextToConvert;
+  pthread_t Thread;
+} SINKTHREAD;
+
+//a file of the batch manifest and the result of its conversion
+typedef struct tag_batchentry {
+  char sInputFileName[PATH_MAX];
+  char sOutputFileName[PATH_MAX];
+  char sIngestionMetadataFileName[PATH_MAX];
+  char sSchema[PATH_MAX];
+  char sDatabase[40];
+  int  iStatus;                              //0 converted, -1 failed
+  long lRecords;                             //records read, of a failed file those read before it was aborted
+  long lRejected;
+  double dSeconds;
+  struct tag_batchentry *pNext;              //next file waiting for a worker
+} BATCHENTRY;
+
+//metadata parsed once per schema and shared by all files of a batch, NULL if the schema can't be loaded,
+//a schema file modified while watching a directory is parsed again
+typedef struct tag_schemacacheentry {
+  char sSchema[PATH_MAX];
+  time_t tModified;
+  CONVERTER *cv;
+} SCHEMACACHEENTRY;
+
+typedef struct tag_batch {
+  const CONVERTER *pOptions;                 //command line options applied to every file
+  BATCHENTRY *Entries;                       //files of the manifest
+  int  iEntries;
+  BATCHENTRY *pQueueHead;                    //files waiting for a worker, guarded by mutex
+  BATCHENTRY *pQueueTail;
+  int  iClosed;                              //no more files will be queued
+  int  iFreeEntries;                         //entries are freed once converted (watch mode)
+  int  iConverted;
+  int  iFailed;
+  int  iJobs;
+  pthread_t Threads[MAX_THREADS];
+  SCHEMACACHEENTRY *Schemas;
+  int  iSchemas;
+  pthread_mutex_t mutex;
+  pthread_cond_t condQueued;
+} BATCH;
+
+//stages timed by the benchmark
+enum { BENCH_READ, BENCH_TRANSLATE, BENCH_TRIM, BENCH_DATE, BENCH_DECIMAL, BENCH_CONVERT, BENCH_WRITE, BENCH_STAGES };
+
+//time spent in a benchmark stage and bytes of input (output for write) it processed
+typedef struct tag_benchstage {
+  const char *sName;
+  double dSeconds;
+  long lBytes;
+} BENCHSTAGE;
+
+//metrics of the process, updated with atomic adds while the converting threads run
+typedef struct tag_metrics {
+  long lFiles;
+  long lFilesFailed;
+  long lRecords;
+  long lInputBytes;
+  long lOutputBytes;
+  long lPlanRecords;                         //records converted by the record plan (text output)
+  long lSampledRecords;                      //records of these timed field by field
+  long lFieldValues[METRIC_TYPES];
+  long lFieldBytes[METRIC_TYPES];
+  long lFieldTicks[METRIC_TYPES];            //ticks spent in the fields of the sampled records
+  long lRejected;
+  long lFiltered;                            //records skipped by --where
+  long lInputWaitNanos;                      //conversion waiting for decompressed input
+  long lOutputWaitNanos;                     //conversion waiting for a free output block
+  unsigned long lStartTicks;
+  double dStartSeconds;
+  const char *sJsonFile;
+  const char *sPrometheusFile;
+  pthread_mutex_t mutex;                     //one report written at a time
+} METRICS;
+
+//counts of a converting thread not yet added to the process metrics
+typedef struct tag_threadmetrics {
+  long lRecords;                             //records read, filtered ones included
+  long lFiltered;
+  long lPlanRecords;
+  long lSampledRecords;
+  long lFieldTicks[METRIC_TYPES];
+} THREADMETRICS;
+
+#ifdef E2A_COUNT_ALLOCATIONS
+//build with -DE2A_COUNT_ALLOCATIONS to count heap allocations, the conversion loops must not do any:
+//a converting thread counts into the converter of its file once it is done with its first record or chunk,
+//a Parquet output once it has written its first row group, its buffers are grown to size then, opening the next part
+//of a sharded output and the row group metadata are not counted, a file with any allocation counted fails
+extern void *__libc_malloc(size_t);
+extern void *__libc_calloc(size_t, size_t);
+extern void *__libc_realloc(void *, size_t);
+static __thread long *pSteadyStateAllocations;
+
+#define COUNT_ALLOCATIONS(cv, iSteadyState) (pSteadyStateAllocations = (iSteadyState) ? &(cv)->lSteadyStateAllocations : NULL)
+#define STOP_COUNTING_ALLOCATIONS() (pSteadyStateAllocations = NULL)
+
+void *malloc(size_t size)
+{
+  if (pSteadyStateAllocations != NULL) {
+    __sync_fetch_and_add(pSteadyStateAllocations, 1);
+  }
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+  if (pSteadyStateAllocations != NULL) {
+    __sync_fetch_and_add(pSteadyStateAllocations, 1);
+  }
+  return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+  if (pSteadyStateAllocations != NULL) {
+    __sync_fetch_and_add(pSteadyStateAllocations, 1);
+  }
+  return __libc_realloc(ptr, size);
+}
+#else
+#define COUNT_ALLOCATIONS(cv, iSteadyState)
+#define STOP_COUNTING_ALLOCATIONS()
+#endif
+
+//global buffers (easier to deallocate), every thread logs into its own datetime buffer
+static __thread char pDateTimeBuffer[100];
+static __thread time_t tDateTimeBuffer = -1;
 char *sUUID;
 
+//datatypes in the order of the metrics
+static const char sMetricTypes[METRIC_TYPES + 1] = "ATLPSBFH";
+static METRICS Metrics = { .mutex = PTHREAD_MUTEX_INITIALIZER };
+
+//reason a field of the record being converted can't be decoded, set by the decoding functions and
+//picked up by the record plan, which then gives up the record
+static __thread const char *sDecodeError;
+static __thread int iDecodeErrorField;
+
+//rejected records of all files converted by the process, one line each: input file|record|field|reason|record in hex
+static FILE *fpRejectFile;
+static pthread_mutex_t RejectMutex = PTHREAD_MUTEX_INITIALIZER;
+
 //forward declarations
-void convert(unsigned char *, size_t);
+void convert(unsigned char *, const unsigned char *, size_t, const unsigned char *, TEXTSCAN *);
+void TranslateScalar(unsigned char *, const unsigned char *, size_t, const unsigned char *, TEXTSCAN *);
+void InitTranslation(void);
+int TestTranslationKernel(TRANSLATEKERNEL, const char *);
+int TestDecimalFormatting(void);
+int TestDecimalDecoding(void);
+int TestTextConditions(void);
+int ExecuteSelfTest(void);
+int FindCodePage(const char *);
+int ExpandUtf8(char *, int, unsigned char);
+int NarrowUtf8(unsigned char *, const char *, unsigned char);
 char *GetDateTime(void);
-long unpack(char *, size_t);
-long unzone(char *, size_t);
+long unpack(const char *, size_t);
+__int128 unzone128(const char *, size_t);
+__int128 unpack128(const char *, size_t);
+int FormatDecimal(char *, long, int);
+int FormatDecimal128(char *, __int128, int);
+int FormatDecimalDigits(char *, const char *, size_t, int, int);
+long unzone(const char *, size_t);
+long unbinary(const char *, size_t);
+unsigned long unbinaryu(const char *, size_t);
+double unfloat(const char *, size_t);
+double unhexfloat(const char *, size_t);
+const char *CheckDecimalNibbles(const unsigned char *, size_t, int);
 int LoadMetadata(CONVERTER *);
+int IsCopybook(const char *);
+int CopybookUsage(const char *);
+int LoadCopybook(CONVERTER *);
+int CompileRecordPlan(CONVERTER *);
+int CompileColumns(CONVERTER *);
+int CompileFilters(CONVERTER *);
+int CompileSelectors(CONVERTER *);
+int FilterRecord(const CONVERTER *, const unsigned char *);
+int HandleText(const FIELDPLAN *, const unsigned char *, char *);
+int HandleTextRun(const FIELDPLAN *, const unsigned char *, char *);
+int HandleTextUtf8(const FIELDPLAN *, const unsigned char *, char *);
+int HandleTextRunUtf8(const FIELDPLAN *, const unsigned char *, char *);
+int HandleDate(const FIELDPLAN *, const unsigned char *, char *);
+int HandlePackedDate(const FIELDPLAN *, const unsigned char *, char *);
+int HandlePacked(const FIELDPLAN *, const unsigned char *, char *);
+int HandleZoned(const FIELDPLAN *, const unsigned char *, char *);
+int HandlePacked128(const FIELDPLAN *, const unsigned char *, char *);
+int HandleZoned128(const FIELDPLAN *, const unsigned char *, char *);
+int HandlePackedDigits(const FIELDPLAN *, const unsigned char *, char *);
+int HandleZonedDigits(const FIELDPLAN *, const unsigned char *, char *);
+int HandleBinary2(const FIELDPLAN *, const unsigned char *, char *);
+int HandleBinary4(const FIELDPLAN *, const unsigned char *, char *);
+int HandleBinary8(const FIELDPLAN *, const unsigned char *, char *);
+int HandleBinaryUnsigned(const FIELDPLAN *, const unsigned char *, char *);
+int HandleFloat(const FIELDPLAN *, const unsigned char *, char *);
+int HandleHexFloat(const FIELDPLAN *, const unsigned char *, char *);
 int ExecuteCSVConversion(CONVERTER *);
-int trim(char *, int, TRIMBUFFER *);
+int ExecuteParallelConversion(CONVERTER *);
+int OpenSinks(CONVERTER *);
+void *SinkWorker(void *);
+int ExecuteFanOutConversion(CONVERTER *);
+int ConvertRecord(CONVERTER *, const unsigned char *, unsigned char *);
+int RejectRecord(CONVERTER *, long, const unsigned char *);
+int ConvertRecordMetered(CONVERTER *, const unsigned char *, unsigned char *, THREADMETRICS *);
+int MetricType(char);
+void FlushThreadMetrics(const CONVERTER *, THREADMETRICS *);
+void WriteMetricsReports(void);
+int MapInputFile(CONVERTER *);
+int OpenInputStream(CONVERTER *);
+void *InputStreamReader(void *);
+int CloseInputStream(CONVERTER *);
+const unsigned char *ReadRecords(CONVERTER *, unsigned char *, int, int *);
+int OpenOutputFile(CONVERTER *);
+int StartOutput(CONVERTER *);
+void *OutputFlusher(void *);
+void *OutputCompressor(void *);
+unsigned char *ReserveOutput(OUTPUTWRITER *);
+void CommitOutput(OUTPUTWRITER *, size_t);
+void CheckpointOutput(CONVERTER *, long, off_t);
+int LoadCheckpoint(CONVERTER *);
+void WriteOutput(OUTPUTWRITER *, const unsigned char *, size_t);
+int CloseOutput(CONVERTER *);
+int OpenShards(CONVERTER *);
+int WriteManifest(CONVERTER *);
+int OpenParquet(CONVERTER *);
+int ParquetAddRecord(CONVERTER *, const unsigned char *);
+int CloseParquet(CONVERTER *);
+int ExecuteParquetConversion(CONVERTER *);
+int FindDateFormat(const char *);
+int ParseDate(const char *, int, int, int *, int *, int *);
+int ParsePackedDate(const unsigned char *, int *, int *, int *);
+int trim(char *, char *, int, TRIMBUFFER *, const TEXTSCAN *);
 int CreateIngestionMetadataFile(CONVERTER *cv);
 
 //Codepage 273 (for German and Austrian encodings)
@@ -142,669 +913,7848 @@ static  unsigned char ebc2asc[256] =
   0x38, 0x39, 0xB3, 0xDB, 0x5D, 0xD9, 0xDA, 0x9F
 };
 
-//in-situ converter
-void convert(unsigned char *pBuffer, size_t count)
+//Codepage 1141 (Codepage 273 with the euro sign at 0x9F, written as 0xA4 like in ISO-8859-15)
+static const unsigned char ebc2asc1141[256] =
 {
-  int i;
+  0x00, 0x01, 0x02, 0x03, 0x9C, 0x09, 0x86, 0x7F,
+  0x97, 0x8D, 0x8E, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
+  0x10, 0x11, 0x12, 0x13, 0x9D, 0x85, 0x08, 0x87,
+  0x18, 0x19, 0x92, 0x8F, 0x1C, 0x1D, 0x1E, 0x1F,
+  0x80, 0x81, 0x82, 0x83, 0x84, 0x0A, 0x17, 0x1B,
+  0x88, 0x89, 0x8A, 0x8B, 0x8C, 0x05, 0x06, 0x07,
+  0x90, 0x91, 0x16, 0x93, 0x94, 0x95, 0x96, 0x04,
+  0x98, 0x99, 0x9A, 0x9B, 0x14, 0x15, 0x9E, 0x1A,
+  0x20, 0xA0, 0xE2, 0x7B, 0xE0, 0xE1, 0xE3, 0xE5,
+  0xE7, 0xF1, 0xC4, 0x2E, 0x3C, 0x28, 0x2B, 0x21,
+  0x26, 0xE9, 0xEA, 0xEB, 0xE8, 0xED, 0xEE, 0xEF,
+  0xEC, 0x7E, 0xDC, 0x24, 0x2A, 0x29, 0x3B, 0x5E,
+  0x2D, 0x2F, 0xC2, 0x5B, 0xC0, 0xC1, 0xC3, 0xC5,
+  0xC7, 0xD1, 0xF6, 0x2C, 0x25, 0x5F, 0x3E, 0x3F,
+  0xF8, 0xC9, 0xCA, 0xCB, 0xC8, 0xCD, 0xCE, 0xCF,
+  0xCC, 0x60, 0x3A, 0x23, 0xA7, 0x27, 0x3D, 0x22,
+  0xD8, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67,
+  0x68, 0x69, 0xAB, 0xBB, 0xF0, 0xFD, 0xFE, 0xB1,
+  0xB0, 0x6A, 0x6B, 0x6C, 0x6D, 0x6E, 0x6F, 0x70,
+  0x71, 0x72, 0xAA, 0xBA, 0xE6, 0xB8, 0xC6, 0xA4,
+  0xB5, 0xDF, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78,
+  0x79, 0x7A, 0xA1, 0xBF, 0xD0, 0xDD, 0xDE, 0xAE,
+  0xA2, 0xA3, 0xA5, 0xB7, 0xA9, 0x40, 0xB6, 0xBC,
+  0xBD, 0xBE, 0xAC, 0x7C, 0xAF, 0xA8, 0xB4, 0xD7,
+  0xE4, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47,
+  0x48, 0x49, 0xAD, 0xF4, 0xA6, 0xF2, 0xF3, 0xF5,
+  0xFC, 0x4A, 0x4B, 0x4C, 0x4D, 0x4E, 0x4F, 0x50,
+  0x51, 0x52, 0xB9, 0xFB, 0x7D, 0xF9, 0xFA, 0xFF,
+  0xD6, 0xF7, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58,
+  0x59, 0x5A, 0xB2, 0xD4, 0x5C, 0xD2, 0xD3, 0xD5,
+  0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37,
+  0x38, 0x39, 0xB3, 0xDB, 0x5D, 0xD9, 0xDA, 0x9F
+};
 
-  for (i = 0; i < count; i++) {
-    pBuffer[i] = ebc2asc[pBuffer[i]];
-  }
-}
+//Codepage 037 (USA, Canada, Netherlands, Portugal, Brazil)
+static const unsigned char ebc2asc037[256] =
+{
+  0x00, 0x01, 0x02, 0x03, 0x9C, 0x09, 0x86, 0x7F,
+  0x97, 0x8D, 0x8E, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
+  0x10, 0x11, 0x12, 0x13, 0x9D, 0x85, 0x08, 0x87,
+  0x18, 0x19, 0x92, 0x8F, 0x1C, 0x1D, 0x1E, 0x1F,
+  0x80, 0x81, 0x82, 0x83, 0x84, 0x0A, 0x17, 0x1B,
+  0x88, 0x89, 0x8A, 0x8B, 0x8C, 0x05, 0x06, 0x07,
+  0x90, 0x91, 0x16, 0x93, 0x94, 0x95, 0x96, 0x04,
+  0x98, 0x99, 0x9A, 0x9B, 0x14, 0x15, 0x9E, 0x1A,
+  0x20, 0xA0, 0xE2, 0xE4, 0xE0, 0xE1, 0xE3, 0xE5,
+  0xE7, 0xF1, 0xA2, 0x2E, 0x3C, 0x28, 0x2B, 0x7C,
+  0x26, 0xE9, 0xEA, 0xEB, 0xE8, 0xED, 0xEE, 0xEF,
+  0xEC, 0xDF, 0x21, 0x24, 0x2A, 0x29, 0x3B, 0xAC,
+  0x2D, 0x2F, 0xC2, 0xC4, 0xC0, 0xC1, 0xC3, 0xC5,
+  0xC7, 0xD1, 0xA6, 0x2C, 0x25, 0x5F, 0x3E, 0x3F,
+  0xF8, 0xC9, 0xCA, 0xCB, 0xC8, 0xCD, 0xCE, 0xCF,
+  0xCC, 0x60, 0x3A, 0x23, 0x40, 0x27, 0x3D, 0x22,
+  0xD8, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67,
+  0x68, 0x69, 0xAB, 0xBB, 0xF0, 0xFD, 0xFE, 0xB1,
+  0xB0, 0x6A, 0x6B, 0x6C, 0x6D, 0x6E, 0x6F, 0x70,
+  0x71, 0x72, 0xAA, 0xBA, 0xE6, 0xB8, 0xC6, 0xA4,
+  0xB5, 0x7E, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78,
+  0x79, 0x7A, 0xA1, 0xBF, 0xD0, 0xDD, 0xDE, 0xAE,
+  0x5E, 0xA3, 0xA5, 0xB7, 0xA9, 0xA7, 0xB6, 0xBC,
+  0xBD, 0xBE, 0x5B, 0x5D, 0xAF, 0xA8, 0xB4, 0xD7,
+  0x7B, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47,
+  0x48, 0x49, 0xAD, 0xF4, 0xF6, 0xF2, 0xF3, 0xF5,
+  0x7D, 0x4A, 0x4B, 0x4C, 0x4D, 0x4E, 0x4F, 0x50,
+  0x51, 0x52, 0xB9, 0xFB, 0xFC, 0xF9, 0xFA, 0xFF,
+  0x5C, 0xF7, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58,
+  0x59, 0x5A, 0xB2, 0xD4, 0xD6, 0xD2, 0xD3, 0xD5,
+  0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37,
+  0x38, 0x39, 0xB3, 0xDB, 0xDC, 0xD9, 0xDA, 0x9F
+};
 
-//for logging
-char *GetDateTime(void)
+//Codepage 500 (International Latin-1, Belgium, Switzerland)
+static const unsigned char ebc2asc500[256] =
 {
-  time_t now = time(0);
-  strftime (pDateTimeBuffer, 100, "%Y-%m-%d %H:%M:%S.000", localtime (&now));
-  return pDateTimeBuffer;
-}
+  0x00, 0x01, 0x02, 0x03, 0x9C, 0x09, 0x86, 0x7F,
+  0x97, 0x8D, 0x8E, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
+  0x10, 0x11, 0x12, 0x13, 0x9D, 0x85, 0x08, 0x87,
+  0x18, 0x19, 0x92, 0x8F, 0x1C, 0x1D, 0x1E, 0x1F,
+  0x80, 0x81, 0x82, 0x83, 0x84, 0x0A, 0x17, 0x1B,
+  0x88, 0x89, 0x8A, 0x8B, 0x8C, 0x05, 0x06, 0x07,
+  0x90, 0x91, 0x16, 0x93, 0x94, 0x95, 0x96, 0x04,
+  0x98, 0x99, 0x9A, 0x9B, 0x14, 0x15, 0x9E, 0x1A,
+  0x20, 0xA0, 0xE2, 0xE4, 0xE0, 0xE1, 0xE3, 0xE5,
+  0xE7, 0xF1, 0x5B, 0x2E, 0x3C, 0x28, 0x2B, 0x21,
+  0x26, 0xE9, 0xEA, 0xEB, 0xE8, 0xED, 0xEE, 0xEF,
+  0xEC, 0xDF, 0x5D, 0x24, 0x2A, 0x29, 0x3B, 0x5E,
+  0x2D, 0x2F, 0xC2, 0xC4, 0xC0, 0xC1, 0xC3, 0xC5,
+  0xC7, 0xD1, 0xA6, 0x2C, 0x25, 0x5F, 0x3E, 0x3F,
+  0xF8, 0xC9, 0xCA, 0xCB, 0xC8, 0xCD, 0xCE, 0xCF,
+  0xCC, 0x60, 0x3A, 0x23, 0x40, 0x27, 0x3D, 0x22,
+  0xD8, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67,
+  0x68, 0x69, 0xAB, 0xBB, 0xF0, 0xFD, 0xFE, 0xB1,
+  0xB0, 0x6A, 0x6B, 0x6C, 0x6D, 0x6E, 0x6F, 0x70,
+  0x71, 0x72, 0xAA, 0xBA, 0xE6, 0xB8, 0xC6, 0xA4,
+  0xB5, 0x7E, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78,
+  0x79, 0x7A, 0xA1, 0xBF, 0xD0, 0xDD, 0xDE, 0xAE,
+  0xA2, 0xA3, 0xA5, 0xB7, 0xA9, 0xA7, 0xB6, 0xBC,
+  0xBD, 0xBE, 0xAC, 0x7C, 0xAF, 0xA8, 0xB4, 0xD7,
+  0x7B, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47,
+  0x48, 0x49, 0xAD, 0xF4, 0xF6, 0xF2, 0xF3, 0xF5,
+  0x7D, 0x4A, 0x4B, 0x4C, 0x4D, 0x4E, 0x4F, 0x50,
+  0x51, 0x52, 0xB9, 0xFB, 0xFC, 0xF9, 0xFA, 0xFF,
+  0x5C, 0xF7, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58,
+  0x59, 0x5A, 0xB2, 0xD4, 0xD6, 0xD2, 0xD3, 0xD5,
+  0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37,
+  0x38, 0x39, 0xB3, 0xDB, 0xDC, 0xD9, 0xDA, 0x9F
+};
 
-//trim leading/tailing blanks and filter unvalid characters
-int trim(char *str, int iLength, TRIMBUFFER *tb)
+//value of a packed decimal byte holding two digits, high nibble first, 255 if a nibble is above 9:
+//no pair of digits has bit 7 set, so ORing the values of all bytes tells whether one was invalid
+static const unsigned char BcdPairs[256] =
 {
+    0,   1,   2,   3,   4,   5,   6,   7,
+    8,   9, 255, 255, 255, 255, 255, 255,
+   10,  11,  12,  13,  14,  15,  16,  17,
+   18,  19, 255, 255, 255, 255, 255, 255,
+   20,  21,  22,  23,  24,  25,  26,  27,
+   28,  29, 255, 255, 255, 255, 255, 255,
+   30,  31,  32,  33,  34,  35,  36,  37,
+   38,  39, 255, 255, 255, 255, 255, 255,
+   40,  41,  42,  43,  44,  45,  46,  47,
+   48,  49, 255, 255, 255, 255, 255, 255,
+   50,  51,  52,  53,  54,  55,  56,  57,
+   58,  59, 255, 255, 255, 255, 255, 255,
+   60,  61,  62,  63,  64,  65,  66,  67,
+   68,  69, 255, 255, 255, 255, 255, 255,
+   70,  71,  72,  73,  74,  75,  76,  77,
+   78,  79, 255, 255, 255, 255, 255, 255,
+   80,  81,  82,  83,  84,  85,  86,  87,
+   88,  89, 255, 255, 255, 255, 255, 255,
+   90,  91,  92,  93,  94,  95,  96,  97,
+   98,  99, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255,
+  255, 255, 255, 255, 255, 255, 255, 255
+};
 
-  int i, j;
-  int iBegin = 0;
-  int iEnd = iLength -1;
-  char *pTempBuffer;
-
-  //count leading and trailing blanks
-  while (isspace((unsigned char) str[iBegin]) && (iBegin < iEnd))
-    iBegin++;
-  while (isspace((unsigned char) str[iEnd]) && (iEnd > iBegin))
-    iEnd--;
-
-  //copy to the temporary tempBuffer.
-  if ((pTempBuffer = (char *) malloc(iEnd - iBegin + 1)) != NULL) {
-    for (i = iBegin, j = 0; i <= iEnd;) {
-      switch (str[i]) {
-        //possibly to fix that. Break, or do something different? Meant to be skipped " characters?
-        case '"':
-        case '|':
-          i++;
-          break;
-        default:
-          pTempBuffer[j] = str[i];
-          j++;
-          i++;
-          break;
-      }
-    }
-  }
-  else {
-    fprintf(stdout, "%s %s [ERROR]: Could not allocate temporary trim buffer!\n", GetDateTime(), sUUID);
-    exit(-1);
-  }
+//two ASCII digits for every value 0..99
+static const char DigitPairs[201] =
+  "0001020304050607080910111213141516171819"
+  "2021222324252627282930313233343536373839"
+  "4041424344454647484950515253545556575859"
+  "6061626364656667686970717273747576777879"
+  "8081828384858687888990919293949596979899";
+
+//code pages available for translation, terminated by an entry without name
+static const CODEPAGE CodePages[] = {
+  {"273", ebc2asc, 0},
+  {"1141", ebc2asc1141, 0xA4},
+  {"037", ebc2asc037, 0},
+  {"500", ebc2asc500, 0},
+  {NULL, NULL, 0}
+};
 
-  //indexes trimmed at the moment
-  //copying proper values
-  if ((tb->pBuffer = (char *) malloc(j)) != NULL) {
-    memcpy(tb->pBuffer, pTempBuffer, j);
-    tb->iLength = j;
-    if (pTempBuffer != NULL) {
-      free(pTempBuffer);
+//the kernel selected at startup by InitTranslation()
+static TRANSLATEKERNEL TranslateKernel = TranslateScalar;
+static const char *sTranslateKernel = "scalar";
+
+//translate and scan the bytes iFrom..count-1 one at a time, continues a scan started by a vector kernel
+static void TranslateBytes(unsigned char *pDest, const unsigned char *pSource, size_t iFrom, size_t count, const unsigned char *pTable, TEXTSCAN *ts)
+{
+  size_t i;
+  unsigned char c;
+
+  if (ts == NULL) {
+    for (i = iFrom; i < count; i++) {
+      pDest[i] = pTable[pSource[i]];
     }
+    return;
   }
-  else {
-    fprintf(stdout, "%s %s [ERROR]: Could not allocate trim buffer!\n", GetDateTime(), sUUID);
-    if (pTempBuffer != NULL) {
-      free(pTempBuffer);
+  for (i = iFrom; i < count; i++) {
+    c = pTable[pSource[i]];
+    pDest[i] = c;
+    if (!IS_BLANK(c)) {
+      if (ts->iFirst < 0) {
+        ts->iFirst = i;
+      }
+      ts->iLast = i;
     }
-    exit(-1);
+    if (c == '"' || c == '|' || c == '\n' || c == '\r') {
+      ts->iSpecial = 1;
+    }
+    ts->iHigh |= c >> 7;
   }
-  return 0;
 }
 
-//convert zoned decimal to long
-long unzone(char* pdIn, size_t length)
+void TranslateScalar(unsigned char *pDest, const unsigned char *pSource, size_t count, const unsigned char *pTable, TEXTSCAN *ts)
 {
+  if (ts != NULL) {
+    ts->iFirst = ts->iLast = -1;
+    ts->iSpecial = ts->iHigh = 0;
+  }
+  TranslateBytes(pDest, pSource, 0, count, pTable, ts);
+}
 
-  const int DropHO = 0xFF;             // AND mask to drop HO sign bits
-  const int PlusSign = 0x0F;           // Plus sign
-  const int OtherNegativeSign = 0x0B;  // another minuts sign
-  const int MinusSign = 0x0D;          // Minus
-  const int GetLO  = 0x0F;             // Get only LO digit
-
-  long val = 0;                        // Value to return
-  int i, aByte, digit, sign;
-
-  for (i = 0; i < length; i++) {
+#if defined(__x86_64__) || defined(__i386__)
+//a 256 entry table lookup is done as 16 shuffles of 16 entries each (one per high nibble),
+//every shuffle result is kept only for the bytes whose high nibble selects that row
+__attribute__((target("avx2")))
+void TranslateAVX2(unsigned char *pDest, const unsigned char *pSource, size_t count, const unsigned char *pTable, TEXTSCAN *ts)
+{
 
-    aByte = pdIn[i] & DropHO;            // Get next 2 digits & drop sign bits
-    val = val * 10 + (aByte & GetLO);
+  int h;
+  size_t i = 0;
+  size_t iRemaining;
+  unsigned int iNonBlank;
+  unsigned char sTail[32];
+  __m256i Rows[16];
+  __m256i In, Lo, Hi, Out, Tmp;
+  const __m256i LowNibble = _mm256_set1_epi8(0x0F);
 
-    if (i == length - 1) {      // last digit?
-      sign = aByte >> 4;        // First get digit
-      if (sign == MinusSign || sign == OtherNegativeSign) {
-        val = -val;
-      } else {
-        if (sign != PlusSign) {
-          fprintf(stdout, "%s %s [ERROR]: Invalid Sign nibble in Zoned Decimal! %d, %d\n", GetDateTime(), sUUID, sign, val);
-          exit(-1);
+  if (ts != NULL) {
+    ts->iFirst = ts->iLast = -1;
+    ts->iSpecial = ts->iHigh = 0;
+  }
+  for (h = 0; h < 16; h++) {
+    Rows[h] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) &pTable[16 * h]));
+  }
+  while (i < count) {
+    iRemaining = count - i;
+    //short tails are cheaper one at a time
+    if (iRemaining < 8) {
+      TranslateBytes(pDest, pSource, i, count, pTable, ts);
+      break;
+    }
+    if (iRemaining >= 32) {
+      In = _mm256_loadu_si256((const __m256i *) &pSource[i]);
+    }
+    else {
+      memset(sTail, 0x40, sizeof(sTail));
+      memcpy(sTail, &pSource[i], iRemaining);
+      In = _mm256_loadu_si256((const __m256i *) sTail);
+    }
+    Lo = _mm256_and_si256(In, LowNibble);
+    Hi = _mm256_and_si256(_mm256_srli_epi16(In, 4), LowNibble);
+    Out = _mm256_setzero_si256();
+    for (h = 0; h < 16; h++) {
+      Out = _mm256_blendv_epi8(Out, _mm256_shuffle_epi8(Rows[h], Lo), _mm256_cmpeq_epi8(Hi, _mm256_set1_epi8(h)));
+    }
+    if (iRemaining >= 32) {
+      _mm256_storeu_si256((__m256i *) &pDest[i], Out);
+    }
+    else {
+      _mm256_storeu_si256((__m256i *) sTail, Out);
+      memcpy(&pDest[i], sTail, iRemaining);
+    }
+    if (ts != NULL) {
+      //blank: ' ' or '\t'..'\r', the same set isspace() has in the C locale
+      Tmp = _mm256_sub_epi8(Out, _mm256_set1_epi8('\t'));
+      iNonBlank = ~(unsigned int) _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(Out, _mm256_set1_epi8(' ')),
+                                                                     _mm256_cmpeq_epi8(_mm256_min_epu8(Tmp, _mm256_set1_epi8(4)), Tmp)));
+      if (iRemaining < 32) {
+        iNonBlank &= (1u << iRemaining) - 1;
+      }
+      if (iNonBlank != 0) {
+        if (ts->iFirst < 0) {
+          ts->iFirst = i + __builtin_ctz(iNonBlank);
         }
+        ts->iLast = i + 31 - __builtin_clz(iNonBlank);
+      }
+      Tmp = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(Out, _mm256_set1_epi8('"')), _mm256_cmpeq_epi8(Out, _mm256_set1_epi8('|'))),
+                            _mm256_or_si256(_mm256_cmpeq_epi8(Out, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(Out, _mm256_set1_epi8('\r'))));
+      if (_mm256_movemask_epi8(Tmp) != 0) {
+        ts->iSpecial = 1;
+      }
+      //the blanks a short tail is padded with stay below 0x80
+      if (_mm256_movemask_epi8(Out) != 0) {
+        ts->iHigh = 1;
       }
     }
+    i += (iRemaining >= 32) ? 32 : iRemaining;
   }
-  return val;
 }
 
-//convert packed decimal to long
-long unpack(char* pdIn, size_t length)
+//same as TranslateAVX2() on 16 bytes at a time
+__attribute__((target("sse4.1")))
+void TranslateSSE41(unsigned char *pDest, const unsigned char *pSource, size_t count, const unsigned char *pTable, TEXTSCAN *ts)
 {
 
-  const int PlusSign = 0x0C;       // Plus sign
-  const int MinusSign = 0x0D;      // Minus
-  const int NoSign = 0x0F;         // Unsigned
-  const int DropHO = 0xFF;         // AND mask to drop HO sign bits
-  const int GetLO  = 0x0F;         // Get only LO digit
-
-  long val = 0;                    // Value to return
-  int i, aByte, digit, sign;
+  int h;
+  size_t i = 0;
+  size_t iRemaining;
+  unsigned int iNonBlank;
+  unsigned char sTail[16];
+  __m128i Rows[16];
+  __m128i In, Lo, Hi, Out, Tmp;
+  const __m128i LowNibble = _mm_set1_epi8(0x0F);
 
-  for (i = 0; i < length; i++) {
-    aByte = pdIn[i] & DropHO;      // Get next 2 digits & drop sign bits
-    if (i == length - 1) {         // last digit?
-      digit = aByte >> 4;          // First get digit
-      val = val*10 + digit;
-      sign = aByte & GetLO;        // now get sign
-      if (sign == MinusSign) {
-        val = -val;
-      }
-      else {
-        if (sign != PlusSign && sign != NoSign) {
-          fprintf(stdout, "%s %s [ERROR]: Invalid Sign nibble in Packed Decimal!\n", GetDateTime(), sUUID);
-          exit(-1);
-        }
-      }
+  if (ts != NULL) {
+    ts->iFirst = ts->iLast = -1;
+    ts->iSpecial = ts->iHigh = 0;
+  }
+  for (h = 0; h < 16; h++) {
+    Rows[h] = _mm_loadu_si128((const __m128i *) &pTable[16 * h]);
+  }
+  while (i < count) {
+    iRemaining = count - i;
+    if (iRemaining < 8) {
+      TranslateBytes(pDest, pSource, i, count, pTable, ts);
+      break;
+    }
+    if (iRemaining >= 16) {
+      In = _mm_loadu_si128((const __m128i *) &pSource[i]);
+    }
+    else {
+      memset(sTail, 0x40, sizeof(sTail));
+      memcpy(sTail, &pSource[i], iRemaining);
+      In = _mm_loadu_si128((const __m128i *) sTail);
+    }
+    Lo = _mm_and_si128(In, LowNibble);
+    Hi = _mm_and_si128(_mm_srli_epi16(In, 4), LowNibble);
+    Out = _mm_setzero_si128();
+    for (h = 0; h < 16; h++) {
+      Out = _mm_blendv_epi8(Out, _mm_shuffle_epi8(Rows[h], Lo), _mm_cmpeq_epi8(Hi, _mm_set1_epi8(h)));
+    }
+    if (iRemaining >= 16) {
+      _mm_storeu_si128((__m128i *) &pDest[i], Out);
     }
     else {
-      digit = aByte >> 4;          // HO first
-      val = val*10 + digit;
-      digit = aByte & GetLO;       // now LO
-      val = val*10 + digit;
+      _mm_storeu_si128((__m128i *) sTail, Out);
+      memcpy(&pDest[i], sTail, iRemaining);
     }
+    if (ts != NULL) {
+      Tmp = _mm_sub_epi8(Out, _mm_set1_epi8('\t'));
+      iNonBlank = ~(unsigned int) _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(Out, _mm_set1_epi8(' ')),
+                                                                 _mm_cmpeq_epi8(_mm_min_epu8(Tmp, _mm_set1_epi8(4)), Tmp)));
+      iNonBlank &= (iRemaining < 16) ? (1u << iRemaining) - 1 : 0xFFFF;
+      if (iNonBlank != 0) {
+        if (ts->iFirst < 0) {
+          ts->iFirst = i + __builtin_ctz(iNonBlank);
+        }
+        ts->iLast = i + 31 - __builtin_clz(iNonBlank);
+      }
+      Tmp = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(Out, _mm_set1_epi8('"')), _mm_cmpeq_epi8(Out, _mm_set1_epi8('|'))),
+                         _mm_or_si128(_mm_cmpeq_epi8(Out, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(Out, _mm_set1_epi8('\r'))));
+      if (_mm_movemask_epi8(Tmp) != 0) {
+        ts->iSpecial = 1;
+      }
+      if (_mm_movemask_epi8(Out) != 0) {
+        ts->iHigh = 1;
+      }
+    }
+    i += (iRemaining >= 16) ? 16 : iRemaining;
   }
-  return val;
 }
+#endif
 
-int LoadMetadata(CONVERTER *cv)
+//select the fastest translation kernel of this cpu and check it against the scalar table lookup
+void InitTranslation(void)
 {
 
-  int i, j, k;
-  char sBuffer[255];
-  char *pToken;
-  FILE *fpMetadataFile;
+  int i, iLength;
+  unsigned char sSource[256];
+  unsigned char sExpected[256];
+  unsigned char sResult[256];
+  TEXTSCAN tsExpected, tsResult;
 
-  //open the file
-  if ((fpMetadataFile = fopen(cv->sSchema, "r")) != NULL) {
-    i = j = 0;
-    cv->iInputRecordLength = 0;
-    cv->iOutputRecordLength = 0;
-    cv->iNumberOfAttributes = 0;
-    fprintf(stdout, "%s %s [INFO]: Reading metadata file %s\n", GetDateTime(), sUUID, cv->sSchema );
-    //go through all the records
-    while(!feof(fpMetadataFile)) {
-      if (fgets(sBuffer, sizeof(sBuffer), fpMetadataFile) != NULL) {
-        //allocate required structure pointers
-        if ((cv->Metadata = (METADATARECORD **) realloc(cv->Metadata, (i+1) * sizeof (METADATARECORD *))) != NULL) {
-          if((cv->Metadata[i] = (METADATARECORD *) malloc(sizeof (METADATARECORD))) != NULL) {
-            j = 1;
-            //tokenize each line and store data in corresponding structure fields
-            pToken = strtok(sBuffer, "\t");
-            while(pToken != NULL) {
-              switch(j) {
-                case 1:
-                  strcpy(cv->Metadata[i]->sFieldname, pToken);
-                  break;
-                case 2:
-                  strcpy(cv->Metadata[i]->sSize, pToken);
-                  if (strstr(cv->Metadata[i]->sSize, ",") != NULL) {
-                    for (k = 0; k < strlen(cv->Metadata[i]->sSize); k++) {
-                      if (cv->Metadata[i]->sSize[k] == ',') {
-                        cv->Metadata[i]->sSize[k] = '\0';
-                        cv->Metadata[i]->iPrecision = atoi(&(cv->Metadata[i]->sSize[k + 1]));
-                      }
-                    }
-                  }
-                  else {
-                    cv->Metadata[i]->iPrecision = 0;
-                  }
-                  cv->Metadata[i]->iOutputFieldLength = atoi(cv->Metadata[i]->sSize);
-                  cv->Metadata[i]->iOutputPosition = (i == 0) ? 0 : cv->Metadata[i-1]->iOutputPosition + cv->Metadata[i-1]->iOutputFieldLength;
-                  cv->iOutputRecordLength += cv->Metadata[i]->iOutputFieldLength;
-                  break;
-                case 3: cv->Metadata[i]->cDatatype=(char) pToken[0]; break;
-                case 4: cv->Metadata[i]->iFrom=atoi(pToken); break;
-                case 5: cv->Metadata[i]->iTo=atoi(pToken); break;
-                case 6: strcpy(cv->Metadata[i]->sDescription, pToken); break;
-                case 7: strcpy(cv->Metadata[i]->sTranslation, pToken); break;
-                default: break;
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    TranslateKernel = TranslateAVX2;
+    sTranslateKernel = "avx2";
+  }
+  else if (__builtin_cpu_supports("sse4.1")) {
+    TranslateKernel = TranslateSSE41;
+    sTranslateKernel = "sse4.1";
+  }
+#endif
+  //all 256 values of every code page, and the blank scan on every field length up to 256
+  for (i = 0; i < 256; i++) {
+    sSource[i] = (unsigned char) i;
+  }
+  for (i = 0; CodePages[i].sName != NULL && TranslateKernel != TranslateScalar; i++) {
+    for (iLength = 1; iLength <= 256; iLength++) {
+      TranslateScalar(sExpected, &sSource[256 - iLength], iLength, CodePages[i].pTable, &tsExpected);
+      TranslateKernel(sResult, &sSource[256 - iLength], iLength, CodePages[i].pTable, &tsResult);
+      if (memcmp(sExpected, sResult, iLength) != 0 || memcmp(&tsExpected, &tsResult, sizeof(TEXTSCAN)) != 0) {
+        break;
+      }
+    }
+    if (iLength <= 256) {
+      fprintf(stdout, "%s %s [ERROR]: Translation kernel %s differs from codepage %s table, using scalar kernel.\n", GetDateTime(), sUUID, sTranslateKernel, CodePages[i].sName);
+      TranslateKernel = TranslateScalar;
+      sTranslateKernel = "scalar";
+    }
+  }
+  fprintf(stdout, "%s %s [INFO]: Translation kernel: %s\n", GetDateTime(), sUUID, sTranslateKernel);
+}
+
+//compare a kernel with the table lookup of every code page: every byte value at every position of up to two full
+//vectors and every tail length 0-63 behind them, single non-blanks for the blank scan, translated into another
+//buffer and in place, nothing may be written behind the field, returns the number of differences
+int TestTranslationKernel(TRANSLATEKERNEL Kernel, const char *sKernel)
+{
+
+  int i, iCodePage, iShift, iLength, iPattern, iInPlace;
+  int iErrors = 0;
+  unsigned char sSource[TEST_KERNEL_LENGTH];
+  unsigned char sExpected[TEST_KERNEL_LENGTH];
+  unsigned char sResult[TEST_KERNEL_LENGTH + 32];
+  TEXTSCAN tsExpected, tsResult;
+  const unsigned char *pTable;
+
+  for (iCodePage = 0; CodePages[iCodePage].sName != NULL; iCodePage++) {
+    pTable = CodePages[iCodePage].pTable;
+    for (iLength = 0; iLength <= TEST_KERNEL_LENGTH; iLength++) {
+      for (iShift = 0; iShift < 256; iShift++) {
+        for (iPattern = 0; iPattern < 2; iPattern++) {
+          //all byte values rotated through the positions, or EBCDIC blanks with one byte that may not be one
+          for (i = 0; i < iLength; i++) {
+            sSource[i] = (iPattern == 0) ? (unsigned char) (i + iShift) : 0x40;
+          }
+          if (iPattern == 1 && iLength > 0) {
+            sSource[iShift % iLength] = (unsigned char) iShift;
+          }
+          for (i = 0; i < iLength; i++) {
+            sExpected[i] = pTable[sSource[i]];
+          }
+          TranslateScalar(sResult, sSource, iLength, pTable, &tsExpected);
+          for (iInPlace = 0; iInPlace < 2; iInPlace++) {
+            memset(sResult, 0xAA, sizeof(sResult));
+            if (iInPlace) {
+              memcpy(sResult, sSource, iLength);
+            }
+            Kernel(sResult, iInPlace ? sResult : sSource, iLength, pTable, &tsResult);
+            for (i = iLength; i < (int) sizeof(sResult) && sResult[i] == 0xAA; i++)
+              ;
+            if (memcmp(sExpected, sResult, iLength) != 0 || i < (int) sizeof(sResult) || memcmp(&tsExpected, &tsResult, sizeof(TEXTSCAN)) != 0) {
+              if (iErrors++ < TEST_LOGGED_ERRORS) {
+                fprintf(stdout, "%s %s [ERROR]: Translation kernel %s differs from codepage %s table: length %d, first byte %02X%s\n", GetDateTime(), sUUID,
+                        sKernel, CodePages[iCodePage].sName, iLength, (iLength > 0) ? sSource[0] : 0, iInPlace ? ", in place" : "");
               }
-              pToken = strtok(NULL, "\t");
-              j++;
             }
-            cv->Metadata[i]->iInputPosition = (cv->Metadata[i]->iFrom) - 1;
-            cv->Metadata[i]->iInputFieldLength = (cv->Metadata[i]->iTo - cv->Metadata[i]->iFrom) + 1;
-            cv->iInputRecordLength += cv->Metadata[i]->iInputFieldLength;
-          }
-          else {
-            fprintf(stdout, "%s %s [ERROR]: Unable to allocate metadata record!\n", GetDateTime(), sUUID);
-            exit(-1);
           }
         }
+      }
+    }
+  }
+  fprintf(stdout, "%s %s [INFO]: Self-test translation kernel %s: %d differences\n", GetDateTime(), sUUID, sKernel, iErrors);
+  return iErrors;
+}
+
+//converter, pDest and pSource may be the same buffer
+//if ts is given, the translated bytes are scanned for trim() in the same pass
+void convert(unsigned char *pDest, const unsigned char *pSource, size_t count, const unsigned char *pTable, TEXTSCAN *ts)
+{
+  TranslateKernel(pDest, pSource, count, pTable, ts);
+}
+
+//index in CodePages of a code page given as 273, CP273 or IBM-273, -1 if there is no such code page
+int FindCodePage(const char *sName)
+{
+
+  int i;
+
+  if (strncasecmp(sName, "CP", 2) == 0) {
+    sName += 2;
+  }
+  else if (strncasecmp(sName, "IBM-", 4) == 0) {
+    sName += 4;
+  }
+  if (*sName == '\0' || sName[strspn(sName, "0123456789")] != '\0') {
+    return -1;
+  }
+  for (i = 0; CodePages[i].sName != NULL && atoi(CodePages[i].sName) != atoi(sName); i++);
+  return (CodePages[i].sName != NULL) ? i : -1;
+}
+
+//code page of a field, the one of the file unless the metadata gives it its own
+static inline const CODEPAGE *FieldCodePage(const CONVERTER *cv, const METADATARECORD *pField)
+{
+  return (pField->iCodePage > 0) ? &CodePages[pField->iCodePage - 1] : cv->pCodePage;
+}
+
+//expand the iLength ISO-8859 characters of pText into UTF-8 in place, from the back so that nothing is overwritten
+//before it is read, there must be room for two bytes per character (three for cEuro), returns the new length
+int ExpandUtf8(char *pText, int iLength, unsigned char cEuro)
+{
+
+  int i;
+  int iExtra = 0;
+  unsigned char c;
+  unsigned char *pDest;
+
+  for (i = 0; i < iLength; i++) {
+    c = (unsigned char) pText[i];
+    iExtra += (c >> 7) << (c == cEuro);
+  }
+  pDest = (unsigned char *) &pText[iLength + iExtra];
+  //the characters in front of the last one outside of ASCII stay where they are
+  for (i = iLength - 1; pDest > (unsigned char *) &pText[i + 1]; i--) {
+    c = (unsigned char) pText[i];
+    if (c < 0x80) {
+      *--pDest = c;
+    }
+    else if (c == cEuro) {
+      *--pDest = 0xAC;
+      *--pDest = 0x82;
+      *--pDest = 0xE2;
+    }
+    else {
+      *--pDest = 0x80 | (c & 0x3F);
+      *--pDest = 0xC0 | (c >> 6);
+    }
+  }
+  return iLength + iExtra;
+}
+
+//the ISO-8859 characters of a code page for a UTF-8 text, as given in conditions when the output is UTF-8,
+//returns the number of characters or -1 if the text has characters the code page doesn't have
+int NarrowUtf8(unsigned char *pDest, const char *sText, unsigned char cEuro)
+{
+
+  int iLength = 0;
+  const unsigned char *p = (const unsigned char *) sText;
+
+  while (*p != '\0') {
+    if (*p < 0x80) {
+      pDest[iLength++] = *p++;
+    }
+    else if ((*p == 0xC2 || *p == 0xC3) && (p[1] & 0xC0) == 0x80 && (cEuro == 0 || ((*p & 0x03) << 6 | (p[1] & 0x3F)) != cEuro)) {
+      pDest[iLength++] = (*p & 0x03) << 6 | (p[1] & 0x3F);
+      p += 2;
+    }
+    else if (cEuro != 0 && p[0] == 0xE2 && p[1] == 0x82 && p[2] == 0xAC) {
+      pDest[iLength++] = cEuro;
+      p += 3;
+    }
+    else {
+      return -1;
+    }
+  }
+  return iLength;
+}
+
+//for logging, the text is formatted again only when the second changes
+char *GetDateTime(void)
+{
+  time_t now = time(0);
+  struct tm tmNow;
+  if (now != tDateTimeBuffer) {
+    strftime (pDateTimeBuffer, sizeof(pDateTimeBuffer), "%Y-%m-%d %H:%M:%S.000", localtime_r (&now, &tmNow));
+    tDateTimeBuffer = now;
+  }
+  return pDateTimeBuffer;
+}
+
+//tick counter of the metrics, the TSC where available, read twice per field of a sampled record
+static inline unsigned long ReadTicks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+#endif
+}
+
+static double MonotonicSeconds(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//trim leading/tailing blanks and filter unvalid characters
+//the result is moved to pDest, which is either str or lies before it, tb describes it (no allocation)
+//ts is the scan done by convert(), NULL if str has not been scanned
+int trim(char *pDest, char *str, int iLength, TRIMBUFFER *tb, const TEXTSCAN *ts)
+{
+
+  int i, j;
+  int iBegin = 0;
+  int iEnd = iLength -1;
+
+  //count leading and trailing blanks, a blank field keeps its last blank
+  if (ts != NULL) {
+    iBegin = (ts->iFirst >= 0) ? ts->iFirst : iEnd;
+    iEnd = (ts->iFirst >= 0) ? ts->iLast : iEnd;
+  }
+  else {
+    while (isspace((unsigned char) str[iBegin]) && (iBegin < iEnd))
+      iBegin++;
+    while (isspace((unsigned char) str[iEnd]) && (iEnd > iBegin))
+      iEnd--;
+  }
+
+  //nothing to filter out
+  if (ts != NULL && !ts->iSpecial) {
+    j = iEnd - iBegin + 1;
+    memmove(pDest, &str[iBegin], j);
+  }
+  else for (i = iBegin, j = 0; i <= iEnd;) {
+    switch (str[i]) {
+      //possibly to fix that. Break, or do something different? Meant to be skipped " characters?
+      case '"':
+      case '|':
+        i++;
+        break;
+      //replace CR/LF characters by some character (~) to avoid line breaks in the output
+      case '\n':
+      case '\r':
+        pDest[j] = '~';
+        j++;
+        i++;
+        break;
+      default:
+        pDest[j] = str[i];
+        j++;
+        i++;
+        break;
+    }
+  }
+  tb->pBuffer = pDest;
+  tb->iLength = j;
+  return 0;
+}
+
+//convert zoned decimal to long
+long unzone(const char* pdIn, size_t length)
+{
+
+  const int DropHO = 0xFF;             // AND mask to drop HO sign bits
+  const int LowestSign = 0x0A;         // A to F are signs, A, C, E and F (unsigned) are plus
+  const int OtherNegativeSign = 0x0B;  // another minuts sign
+  const int MinusSign = 0x0D;          // Minus
+  const int GetLO  = 0x0F;             // Get only LO digit
+
+  long val = 0;                        // Value to return
+  int i, aByte, digit, sign;
+
+  for (i = 0; i < length; i++) {
+
+    aByte = pdIn[i] & DropHO;            // Get next 2 digits & drop sign bits
+    digit = aByte & GetLO;
+    if (digit > 9) {
+      sDecodeError = "invalid digit nibble in zoned decimal";
+      return 0;
+    }
+    val = val * 10 + digit;
+
+    if (i == length - 1) {      // last digit?
+      sign = aByte >> 4;        // First get digit
+      if (sign == MinusSign || sign == OtherNegativeSign) {
+        val = -val;
+      } else {
+        if (sign < LowestSign) {
+          sDecodeError = "invalid sign nibble in zoned decimal";
+          return 0;
+        }
+      }
+    }
+  }
+  return val;
+}
+
+//convert packed decimal to long
+long unpack(const char* pdIn, size_t length)
+{
+
+  const int PlusSign = 0x0C;       // Plus sign
+  const int MinusSign = 0x0D;      // Minus
+  const int NoSign = 0x0F;         // Unsigned
+  const int DropHO = 0xFF;         // AND mask to drop HO sign bits
+  const int GetLO  = 0x0F;         // Get only LO digit
+
+  unsigned long val = 0;           // Value to return, unsigned until the digits are known to be valid
+  int i, aByte, digit, sign;
+  int pairs = 0;                   // values of all pairs ORed, 255 marks an invalid one
+
+  //two digits per byte up to the last one
+  for (i = 0; i < length - 1; i++) {
+    pairs |= BcdPairs[pdIn[i] & DropHO];
+    val = val*100 + BcdPairs[pdIn[i] & DropHO];
+  }
+  aByte = pdIn[length - 1] & DropHO;
+  digit = aByte >> 4;              // last digit
+  if ((pairs & 0x80) || digit > 9) {
+    sDecodeError = "invalid digit nibble in packed decimal";
+    return 0;
+  }
+  val = val*10 + digit;
+  sign = aByte & GetLO;            // now get sign
+  if (sign == MinusSign) {
+    val = -val;
+  }
+  else {
+    if (sign != PlusSign && sign != NoSign) {
+      sDecodeError = "invalid sign nibble in packed decimal";
+      return 0;
+    }
+  }
+  return (long) val;
+}
+
+//convert zoned decimal of up to 38 digits to a 128 bit integer
+__int128 unzone128(const char* pdIn, size_t length)
+{
+
+  const int DropHO = 0xFF;             // AND mask to drop HO sign bits
+  const int LowestSign = 0x0A;         // A to F are signs, A, C, E and F (unsigned) are plus
+  const int OtherNegativeSign = 0x0B;  // another minuts sign
+  const int MinusSign = 0x0D;          // Minus
+  const int GetLO  = 0x0F;             // Get only LO digit
+
+  __int128 val = 0;                    // Value to return
+  int i, sign;
+
+  for (i = 0; i < length; i++) {
+    if ((pdIn[i] & GetLO) > 9) {
+      sDecodeError = "invalid digit nibble in zoned decimal";
+      return 0;
+    }
+    val = val * 10 + (pdIn[i] & GetLO);
+  }
+  sign = (pdIn[length - 1] & DropHO) >> 4;
+  if (sign == MinusSign || sign == OtherNegativeSign) {
+    val = -val;
+  }
+  else if (sign < LowestSign) {
+    sDecodeError = "invalid sign nibble in zoned decimal";
+    return 0;
+  }
+  return val;
+}
+
+//convert packed decimal of up to 38 digits to a 128 bit integer
+__int128 unpack128(const char* pdIn, size_t length)
+{
+
+  const int PlusSign = 0x0C;       // Plus sign
+  const int MinusSign = 0x0D;      // Minus
+  const int NoSign = 0x0F;         // Unsigned
+  const int DropHO = 0xFF;         // AND mask to drop HO sign bits
+  const int GetLO  = 0x0F;         // Get only LO digit
+
+  unsigned __int128 val = 0;       // Value to return, unsigned until the digits are known to be valid
+  long part = 0;
+  int i, aByte, sign;
+  int pairs = 0;                   // values of all pairs ORed, 255 marks an invalid one
+
+  //18 digits at a time in 64 bit, then shifted into the 128 bit value
+  for (i = 0; i < length - 1; i++) {
+    pairs |= BcdPairs[pdIn[i] & DropHO];
+    part = part*100 + BcdPairs[pdIn[i] & DropHO];
+    if (i % 9 == 8) {
+      val = val * 1000000000000000000L + part;
+      part = 0;
+    }
+  }
+  aByte = pdIn[length - 1] & DropHO;
+  if ((pairs & 0x80) || (aByte >> 4) > 9) {
+    sDecodeError = "invalid digit nibble in packed decimal";
+    return 0;
+  }
+  for (i = (length - 1) % 9; i > 0; i--) {
+    val *= 100;
+  }
+  val = (val + part) * 10 + (aByte >> 4);
+  sign = aByte & GetLO;
+  if (sign == MinusSign) {
+    val = -val;
+  }
+  else if (sign != PlusSign && sign != NoSign) {
+    sDecodeError = "invalid sign nibble in packed decimal";
+    return 0;
+  }
+  return (__int128) val;
+}
+
+//the error the decoding of a packed or zoned decimal would report, NULL if its digit and sign nibbles are valid,
+//for checking a record before any of its fields is decoded
+const char *CheckDecimalNibbles(const unsigned char *pIn, size_t length, int iZoned)
+{
+
+  size_t i;
+  int pairs = 0;
+  int sign;
+
+  if (iZoned) {
+    for (i = 0; i < length; i++) {
+      if ((pIn[i] & 0x0F) > 9) {
+        return "invalid digit nibble in zoned decimal";
+      }
+    }
+    return ((pIn[length - 1] >> 4) < 0x0A) ? "invalid sign nibble in zoned decimal" : NULL;
+  }
+  for (i = 0; i < length - 1; i++) {
+    pairs |= BcdPairs[pIn[i]];
+  }
+  if ((pairs & 0x80) || (pIn[length - 1] >> 4) > 9) {
+    return "invalid digit nibble in packed decimal";
+  }
+  sign = pIn[length - 1] & 0x0F;
+  return (sign != 0x0C && sign != 0x0D && sign != 0x0F) ? "invalid sign nibble in packed decimal" : NULL;
+}
+
+//binary fields are big-endian, loaded at their width and swapped on little-endian hosts
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define BIG_ENDIAN_16(x) (x)
+#define BIG_ENDIAN_32(x) (x)
+#define BIG_ENDIAN_64(x) (x)
+#else
+#define BIG_ENDIAN_16(x) __builtin_bswap16(x)
+#define BIG_ENDIAN_32(x) __builtin_bswap32(x)
+#define BIG_ENDIAN_64(x) __builtin_bswap64(x)
+#endif
+
+//convert a big-endian two's complement binary integer of 2, 4 or 8 bytes to long
+long unbinary(const char *pIn, size_t length)
+{
+
+  unsigned short sValue;
+  unsigned int iValue;
+  unsigned long lValue;
+
+  if (length == 2) {
+    memcpy(&sValue, pIn, 2);
+    return (short) BIG_ENDIAN_16(sValue);
+  }
+  if (length == 4) {
+    memcpy(&iValue, pIn, 4);
+    return (int) BIG_ENDIAN_32(iValue);
+  }
+  memcpy(&lValue, pIn, 8);
+  return (long) BIG_ENDIAN_64(lValue);
+}
+
+//same as unbinary() for binary integers without sign
+unsigned long unbinaryu(const char *pIn, size_t length)
+{
+
+  unsigned short sValue;
+  unsigned int iValue;
+  unsigned long lValue;
+
+  if (length == 2) {
+    memcpy(&sValue, pIn, 2);
+    return BIG_ENDIAN_16(sValue);
+  }
+  if (length == 4) {
+    memcpy(&iValue, pIn, 4);
+    return BIG_ENDIAN_32(iValue);
+  }
+  memcpy(&lValue, pIn, 8);
+  return BIG_ENDIAN_64(lValue);
+}
+
+//convert a big-endian IEEE 754 float of 4 or 8 bytes (AS400 float) to double, NaN and infinity can't be delivered
+double unfloat(const char *pIn, size_t length)
+{
+
+  unsigned int iValue;
+  unsigned long lValue;
+  float fValue;
+  double dValue;
+
+  if (length == 4) {
+    memcpy(&iValue, pIn, 4);
+    iValue = BIG_ENDIAN_32(iValue);
+    memcpy(&fValue, &iValue, 4);
+    dValue = fValue;
+  }
+  else {
+    memcpy(&lValue, pIn, 8);
+    lValue = BIG_ENDIAN_64(lValue);
+    memcpy(&dValue, &lValue, 8);
+  }
+  if (!isfinite(dValue)) {
+    sDecodeError = "float is not a number or infinite";
+    return 0;
+  }
+  return dValue;
+}
+
+//convert an IBM hexadecimal float of 4 or 8 bytes (COMP-1, COMP-2) to double: sign bit, 7 bit exponent of 16 in excess 64
+//and a 24 or 56 bit fraction, the long form keeps the 53 most significant bits
+double unhexfloat(const char *pIn, size_t length)
+{
+
+  unsigned int iValue;
+  unsigned long lValue;
+  double dValue;
+
+  if (length == 4) {
+    memcpy(&iValue, pIn, 4);
+    lValue = (unsigned long) BIG_ENDIAN_32(iValue) << 32;
+  }
+  else {
+    memcpy(&lValue, pIn, 8);
+    lValue = BIG_ENDIAN_64(lValue);
+  }
+  dValue = ldexp((double) (lValue & 0x00FFFFFFFFFFFFFFUL), 4 * ((int) ((lValue >> 56) & 0x7F) - 64) - 56);
+  return (lValue >> 63) ? -dValue : dValue;
+}
+
+//write the digits of ulValue right-aligned to pEnd (exclusive), two at a time,
+//padded with zeros to iMinDigits, returns the number of digits written
+static int WriteDigits(char *pEnd, unsigned long ulValue, int iMinDigits)
+{
+
+  int iDigits = 0;
+
+  while (ulValue >= 100) {
+    iDigits += 2;
+    memcpy(pEnd - iDigits, &DigitPairs[2 * (ulValue % 100)], 2);
+    ulValue /= 100;
+  }
+  if (ulValue >= 10) {
+    iDigits += 2;
+    memcpy(pEnd - iDigits, &DigitPairs[2 * ulValue], 2);
+  }
+  else {
+    iDigits++;
+    *(pEnd - iDigits) = '0' + ulValue;
+  }
+  while (iDigits < iMinDigits) {
+    iDigits++;
+    *(pEnd - iDigits) = '0';
+  }
+  return iDigits;
+}
+
+//write sign, the significant digits sDigits and the decimal point iPrecision digits from the right
+//returns the number of characters written to pDest (no terminating NULL)
+static int PlaceDecimalPoint(char *pDest, const char *sDigits, int iDigits, int iNegative, int iPrecision)
+{
+
+  int iLength = 0;
+
+  if (iNegative) {
+    pDest[iLength++] = '-';
+  }
+  if (iPrecision <= 0) {
+    memcpy(&pDest[iLength], sDigits, iDigits);
+    return iLength + iDigits;
+  }
+  if (iDigits > iPrecision) {
+    memcpy(&pDest[iLength], sDigits, iDigits - iPrecision);
+    iLength += iDigits - iPrecision;
+    pDest[iLength++] = '.';
+    memcpy(&pDest[iLength], &sDigits[iDigits - iPrecision], iPrecision);
+    return iLength + iPrecision;
+  }
+  //less digits than decimals: 0.00ddd
+  pDest[iLength++] = '0';
+  pDest[iLength++] = '.';
+  memset(&pDest[iLength], '0', iPrecision - iDigits);
+  iLength += iPrecision - iDigits;
+  memcpy(&pDest[iLength], sDigits, iDigits);
+  return iLength + iDigits;
+}
+
+//format a scaled integer as decimal number with iPrecision decimals ("%.*f" of value / 10^iPrecision)
+//in integer arithmetic, returns the number of characters written to pDest (no terminating NULL)
+int FormatDecimal(char *pDest, long lValue, int iPrecision)
+{
+
+  char sDigits[24];
+  int iDigits;
+
+  //a zero is never negative
+  iDigits = WriteDigits(&sDigits[sizeof(sDigits)], (lValue < 0) ? -(unsigned long) lValue : (unsigned long) lValue, 1);
+  return PlaceDecimalPoint(pDest, &sDigits[sizeof(sDigits) - iDigits], iDigits, lValue < 0, iPrecision);
+}
+
+//same as FormatDecimal() for values of up to 38 digits, 18 digits are formatted at a time
+int FormatDecimal128(char *pDest, __int128 llValue, int iPrecision)
+{
+
+  const unsigned long Giga18 = 1000000000000000000UL;
+
+  char sDigits[48];
+  unsigned __int128 ullValue;
+  int iDigits = 0;
+
+  ullValue = (llValue < 0) ? -(unsigned __int128) llValue : (unsigned __int128) llValue;
+  while (ullValue >= Giga18) {
+    iDigits += WriteDigits(&sDigits[sizeof(sDigits) - iDigits], (unsigned long) (ullValue % Giga18), 18);
+    ullValue /= Giga18;
+  }
+  if (ullValue > 0 || iDigits == 0) {
+    iDigits += WriteDigits(&sDigits[sizeof(sDigits) - iDigits], (unsigned long) ullValue, 1);
+  }
+  return PlaceDecimalPoint(pDest, &sDigits[sizeof(sDigits) - iDigits], iDigits, llValue < 0, iPrecision);
+}
+
+//reference of the self-test for FormatDecimal128(): the digits of |llValue| printed by snprintf() in parts of 18,
+//at least iPrecision + 1 of them, the decimal point put in front of the last iPrecision
+static int FormatDecimalReference(char *pDest, size_t lSize, __int128 llValue, int iPrecision)
+{
+
+  const unsigned long Giga18 = 1000000000000000000UL;
+
+  char sDigits[48];
+  int iDigits;
+  unsigned __int128 ullValue = (llValue < 0) ? -(unsigned __int128) llValue : (unsigned __int128) llValue;
+
+  if (ullValue >= (unsigned __int128) Giga18 * Giga18) {
+    iDigits = snprintf(sDigits, sizeof(sDigits), "%0*lu%018lu%018lu", (iPrecision > 36) ? iPrecision - 35 : 1, (unsigned long) (ullValue / Giga18 / Giga18),
+                       (unsigned long) (ullValue / Giga18 % Giga18), (unsigned long) (ullValue % Giga18));
+  }
+  else if (ullValue >= Giga18) {
+    iDigits = snprintf(sDigits, sizeof(sDigits), "%0*lu%018lu", (iPrecision > 18) ? iPrecision - 17 : 1, (unsigned long) (ullValue / Giga18),
+                       (unsigned long) (ullValue % Giga18));
+  }
+  else {
+    iDigits = snprintf(sDigits, sizeof(sDigits), "%0*lu", iPrecision + 1, (unsigned long) ullValue);
+  }
+  return snprintf(pDest, lSize, "%s%.*s%s%s", (llValue < 0) ? "-" : "", iDigits - iPrecision, sDigits, (iPrecision > 0) ? "." : "", &sDigits[iDigits - iPrecision]);
+}
+
+//--self-test: FormatDecimal() against the "%.*Lf" of value / 10^precision it replaced (exact for every long),
+//FormatDecimal128() against snprintf() of its digits, on 0, +-1, 10^k-1, 10^k and 10^k+1 of every width and
+//the ends of the ranges with every precision up to 18, returns the number of differences
+int TestDecimalFormatting(void)
+{
+
+  int i, k, iPrecision, iLength, iExpected;
+  int iErrors = 0;
+  int iValues = 0;
+  char sResult[64];
+  char sExpected[64];
+  __int128 llValue;
+  __int128 llPower = 1;
+  __int128 Values[4 * 39 + 8];
+
+  Values[iValues++] = 0;
+  Values[iValues++] = 1;
+  Values[iValues++] = LONG_MAX;
+  Values[iValues++] = -LONG_MAX;
+  Values[iValues++] = 123456789012345678L;
+  for (k = 1; k <= 38; k++) {
+    llPower *= 10;
+    Values[iValues++] = llPower - 1;
+    Values[iValues++] = llPower;
+    Values[iValues++] = llPower + 1;
+    Values[iValues++] = llPower / 9;
+  }
+  for (iPrecision = 0; iPrecision <= 18; iPrecision++) {
+    for (i = 0; i < 2 * iValues; i++) {
+      llValue = (i < iValues) ? Values[i] : -Values[i - iValues];
+      if (llValue >= -LONG_MAX && llValue <= LONG_MAX) {
+        iLength = FormatDecimal(sResult, (long) llValue, iPrecision);
+        iExpected = snprintf(sExpected, sizeof(sExpected), "%.*Lf", iPrecision, (long double) (long) llValue / pow(10, iPrecision));
+        if (iLength != iExpected || memcmp(sResult, sExpected, iLength) != 0) {
+          if (iErrors++ < TEST_LOGGED_ERRORS) {
+            fprintf(stdout, "%s %s [ERROR]: FormatDecimal() wrote %.*s instead of %s\n", GetDateTime(), sUUID, iLength, sResult, sExpected);
+          }
+        }
+      }
+      iLength = FormatDecimal128(sResult, llValue, iPrecision);
+      iExpected = FormatDecimalReference(sExpected, sizeof(sExpected), llValue, iPrecision);
+      if (iLength != iExpected || memcmp(sResult, sExpected, iLength) != 0) {
+        if (iErrors++ < TEST_LOGGED_ERRORS) {
+          fprintf(stdout, "%s %s [ERROR]: FormatDecimal128() wrote %.*s instead of %s\n", GetDateTime(), sUUID, iLength, sResult, sExpected);
+        }
+      }
+    }
+  }
+  fprintf(stdout, "%s %s [INFO]: Self-test decimal formatting: %d values, %d differences\n", GetDateTime(), sUUID, 2 * iValues * 19, iErrors);
+  return iErrors;
+}
+
+//self-test encoding of |llValue| as a packed (sign nibble) or zoned (sign zone) decimal of length bytes
+static void EncodeTestDecimal(unsigned char *pOut, size_t length, unsigned __int128 ullValue, int iZoned, int sign)
+{
+
+  int i;
+
+  if (iZoned) {
+    for (i = length - 1; i >= 0; i--) {
+      pOut[i] = 0xF0 | (int) (ullValue % 10);
+      ullValue /= 10;
+    }
+    pOut[length - 1] = (sign << 4) | (pOut[length - 1] & 0x0F);
+    return;
+  }
+  pOut[length - 1] = ((int) (ullValue % 10) << 4) | sign;
+  ullValue /= 10;
+  for (i = length - 2; i >= 0; i--) {
+    pOut[i] = (int) (ullValue % 10);
+    ullValue /= 10;
+    pOut[i] |= (int) (ullValue % 10) << 4;
+    ullValue /= 10;
+  }
+}
+
+//self-test reference decoding: digit by digit like unpack() and unzone() did before the pair table and the 128 bit paths
+static __int128 DecodeTestDecimal(const unsigned char *pIn, size_t length, int iZoned)
+{
+
+  size_t i;
+  int sign;
+  __int128 llValue = 0;
+
+  if (iZoned) {
+    for (i = 0; i < length; i++) {
+      llValue = llValue * 10 + (pIn[i] & 0x0F);
+    }
+    sign = pIn[length - 1] >> 4;
+    return (sign == 0x0D || sign == 0x0B) ? -llValue : llValue;
+  }
+  for (i = 0; i < length; i++) {
+    llValue = llValue * 10 + (pIn[i] >> 4);
+    if (i < length - 1) {
+      llValue = llValue * 10 + (pIn[i] & 0x0F);
+    }
+  }
+  return ((pIn[length - 1] & 0x0F) == 0x0D) ? -llValue : llValue;
+}
+
+//expected text of the self-test for a decoded value: "%.*Lf" of value / 10^precision like the converter printed
+//before (up to 18 digits) or snprintf() of its digits
+static int ExpectedDecimal(char *pDest, size_t lSize, __int128 llValue, int iLong, int iPrecision)
+{
+
+  static const long double Powers[] = {1e0L, 1e1L, 1e2L, 1e3L, 1e4L, 1e5L, 1e6L, 1e7L, 1e8L, 1e9L, 1e10L, 1e11L, 1e12L, 1e13L, 1e14L,
+                                       1e15L, 1e16L, 1e17L, 1e18L};
+
+  //"%.*Lf" writes -0.00 for a negative zero, the converter never does
+  if (iLong && llValue != 0) {
+    return snprintf(pDest, lSize, "%.*Lf", iPrecision, (long double) (long) llValue / Powers[iPrecision]);
+  }
+  return FormatDecimalReference(pDest, lSize, llValue, iPrecision);
+}
+
+//one field of the self-test: the bytes decoded and formatted by the converter like HandlePacked() and HandleZoned()
+//(up to 18 digits) or their 128 bit variants and FormatDecimalDigits() as well, compared with the expected text
+static int TestDecimalValue(const unsigned char *pIn, size_t length, int iZoned, int iPrecision, const char *pExpected, int iExpected)
+{
+
+  int iLength;
+  int iDigitsLength = -1;
+  char sResult[64];
+  char sDigits[64];
+
+  sDecodeError = NULL;
+  if ((iZoned ? length : 2 * length - 1) <= MAX_DIGITS_LONG) {
+    iLength = FormatDecimal(sResult, iZoned ? unzone((const char *) pIn, length) : unpack((const char *) pIn, length), iPrecision);
+  }
+  else {
+    iLength = FormatDecimal128(sResult, iZoned ? unzone128((const char *) pIn, length) : unpack128((const char *) pIn, length), iPrecision);
+    iDigitsLength = FormatDecimalDigits(sDigits, (const char *) pIn, length, iZoned, iPrecision);
+  }
+  if (sDecodeError == NULL && iLength == iExpected && memcmp(sResult, pExpected, iLength) == 0
+      && (iDigitsLength < 0 || (iDigitsLength == iExpected && memcmp(sDigits, pExpected, iLength) == 0))) {
+    return 0;
+  }
+  fprintf(stdout, "%s %s [ERROR]: %s decimal of %d bytes, precision %d: %.*s (%s) instead of %s\n", GetDateTime(), sUUID, iZoned ? "zoned" : "packed",
+          (int) length, iPrecision, iLength, sResult, (sDecodeError != NULL) ? sDecodeError : "decoded", pExpected);
+  sDecodeError = NULL;
+  return 1;
+}
+
+//one packed or zoned field of the self-test against the digit by digit decoding of its bytes
+static int TestDecimalField(const unsigned char *pIn, size_t length, int iZoned, int iPrecision)
+{
+
+  int iExpected;
+  char sExpected[64];
+
+  iExpected = ExpectedDecimal(sExpected, sizeof(sExpected), DecodeTestDecimal(pIn, length, iZoned),
+                              (iZoned ? length : 2 * length - 1) <= MAX_DIGITS_LONG, iPrecision);
+  return TestDecimalValue(pIn, length, iZoned, iPrecision, sExpected, iExpected);
+}
+
+//--self-test: packed and zoned decimals through unpack()/unzone() and FormatDecimal(), or unpack128()/unzone128()
+//and FormatDecimal128(): every value up to +-2000000 with every precision up to 8, random values of 17 digits packed,
+//18 digits zoned and 38 digits both with random precisions and signs, returns the number of differences
+int TestDecimalDecoding(void)
+{
+
+  //plus and minus signs of packed decimals, zones of zoned ones
+  static const int PackedSigns[] = {0x0C, 0x0F, 0x0D};
+  static const int ZonedSigns[] = {0x0F, 0x0C, 0x0A, 0x0E, 0x0D, 0x0B};
+  const unsigned long Giga19 = 10000000000000000000UL;
+
+  long i;
+  long lValues = 0;
+  int iPrecision;
+  int iExpected;
+  int iErrors = 0;
+  int iNegative;
+  char sExpected[64];
+  unsigned long lRandom = 0x9E3779B97F4A7C15UL;
+  unsigned long lHigh;
+  unsigned __int128 ullValue;
+  unsigned char sPacked[20];
+  unsigned char sZoned[38];
+
+#define NEXT_RANDOM() (lRandom ^= lRandom << 13, lRandom ^= lRandom >> 7, lRandom ^= lRandom << 17)
+  //every value of a 4 byte packed and a 7 byte zoned field with every precision up to 8, both decoded by the
+  //reference and printed once
+  for (i = -TEST_SWEEP_VALUE; i <= TEST_SWEEP_VALUE && iErrors < TEST_LOGGED_ERRORS; i++) {
+    iNegative = (i < 0);
+    EncodeTestDecimal(sPacked, 4, iNegative ? -i : i, 0, iNegative ? 0x0D : PackedSigns[i & 1]);
+    EncodeTestDecimal(sZoned, 7, iNegative ? -i : i, 1, iNegative ? ZonedSigns[4 + (i & 1)] : ZonedSigns[i & 3]);
+    if (DecodeTestDecimal(sPacked, 4, 0) != i || DecodeTestDecimal(sZoned, 7, 1) != i) {
+      fprintf(stdout, "%s %s [ERROR]: Self-test reference decoding of %ld differs\n", GetDateTime(), sUUID, i);
+      iErrors++;
+    }
+    for (iPrecision = 0; iPrecision <= TEST_SWEEP_PRECISION; iPrecision++) {
+      iExpected = ExpectedDecimal(sExpected, sizeof(sExpected), i, 1, iPrecision);
+      iErrors += TestDecimalValue(sPacked, 4, 0, iPrecision, sExpected, iExpected);
+      iErrors += TestDecimalValue(sZoned, 7, 1, iPrecision, sExpected, iExpected);
+      lValues += 2;
+    }
+  }
+  //random values filling the widest fields of the 64 and the 128 bit paths, with random precisions and signs
+  for (i = 0; i < TEST_RANDOM_VALUES && iErrors < TEST_LOGGED_ERRORS; i++) {
+    iNegative = NEXT_RANDOM() & 1;
+    ullValue = NEXT_RANDOM() % 100000000000000000UL;
+    iPrecision = NEXT_RANDOM() % (MAX_DIGITS_LONG + 1);
+    EncodeTestDecimal(sPacked, 9, ullValue, 0, iNegative ? 0x0D : PackedSigns[lRandom % 2]);
+    iErrors += TestDecimalField(sPacked, 9, 0, iPrecision);
+    ullValue = NEXT_RANDOM() % 1000000000000000000UL;
+    EncodeTestDecimal(sZoned, 18, ullValue, 1, ZonedSigns[lRandom % 6]);
+    iErrors += TestDecimalField(sZoned, 18, 1, iPrecision);
+    lHigh = NEXT_RANDOM() % Giga19;
+    ullValue = (unsigned __int128) lHigh * Giga19 + NEXT_RANDOM() % Giga19;
+    iPrecision = NEXT_RANDOM() % (MAX_DIGITS_INT128 + 1);
+    EncodeTestDecimal(sPacked, 20, ullValue / 10, 0, PackedSigns[lRandom % 3]);
+    iErrors += TestDecimalField(sPacked, 20, 0, iPrecision);
+    EncodeTestDecimal(sZoned, 38, ullValue, 1, ZonedSigns[lRandom % 6]);
+    iErrors += TestDecimalField(sZoned, 38, 1, iPrecision);
+    lValues += 4;
+  }
+#undef NEXT_RANDOM
+  fprintf(stdout, "%s %s [INFO]: Self-test decimal decoding: %ld values, %d differences\n", GetDateTime(), sUUID, lValues, iErrors);
+  return iErrors;
+}
+
+//format a packed or zoned decimal of any length straight from its digits, without integer conversion
+int FormatDecimalDigits(char *pDest, const char *pdIn, size_t length, int iZoned, int iPrecision)
+{
+
+  const unsigned char *pIn = (const unsigned char *) pdIn;
+  int i, iLength, iDigits, iFirst, sign, iNegative;
+  int iDecimalPoint;
+
+  //digits and sign nibble
+  if (iZoned) {
+    iDigits = length;
+    sign = pIn[length - 1] >> 4;
+    if (sign < 0x0A) {
+      sDecodeError = "invalid sign nibble in zoned decimal";
+      return 0;
+    }
+    iNegative = (sign == 0x0D || sign == 0x0B);
+  }
+  else {
+    iDigits = 2 * length - 1;
+    sign = pIn[length - 1] & 0x0F;
+    if (sign != 0x0C && sign != 0x0D && sign != 0x0F) {
+      sDecodeError = "invalid sign nibble in packed decimal";
+      return 0;
+    }
+    iNegative = (sign == 0x0D);
+  }
+#define DIGIT_AT(k) (iZoned ? (pIn[k] & 0x0F) : (((k) % 2 == 0) ? (pIn[(k) / 2] >> 4) : (pIn[(k) / 2] & 0x0F)))
+  //leading zeros are dropped, a zero is never negative
+  for (iFirst = 0; iFirst < iDigits - 1 && DIGIT_AT(iFirst) == 0; iFirst++)
+    ;
+  if (iFirst == iDigits - 1 && DIGIT_AT(iFirst) == 0) {
+    iNegative = 0;
+  }
+  iLength = 0;
+  if (iNegative) {
+    pDest[iLength++] = '-';
+  }
+  //less digits than decimals: 0.00ddd
+  if (iPrecision > 0 && iDigits - iFirst <= iPrecision) {
+    pDest[iLength++] = '0';
+    pDest[iLength++] = '.';
+    memset(&pDest[iLength], '0', iPrecision - (iDigits - iFirst));
+    iLength += iPrecision - (iDigits - iFirst);
+    iDecimalPoint = -1;
+  }
+  else {
+    iDecimalPoint = (iPrecision > 0) ? iDigits - iPrecision : -1;
+  }
+  for (i = iFirst; i < iDigits; i++) {
+    if (i == iDecimalPoint) {
+      pDest[iLength++] = '.';
+    }
+    if (DIGIT_AT(i) > 9) {
+      sDecodeError = iZoned ? "invalid digit nibble in zoned decimal" : "invalid digit nibble in packed decimal";
+      return 0;
+    }
+    pDest[iLength++] = '0' + DIGIT_AT(i);
+  }
+#undef DIGIT_AT
+  return iLength;
+}
+
+//derived values of metadata field i once its size, datatype and bytes are known: positions, record lengths,
+//the decoding path of decimals and the room the field takes in the write buffer
+static void CompleteMetadataField(CONVERTER *cv, int i)
+{
+
+  int iDigits;
+  METADATARECORD *pField = cv->Metadata[i];
+
+  pField->iOutputPosition = (i == 0) ? 0 : cv->Metadata[i-1]->iOutputPosition + cv->Metadata[i-1]->iOutputFieldLength;
+  cv->iOutputRecordLength += pField->iOutputFieldLength;
+  pField->iInputPosition = (pField->iFrom) - 1;
+  pField->iInputFieldLength = (pField->iTo - pField->iFrom) + 1;
+  cv->iInputRecordLength += pField->iInputFieldLength;
+  //text fields are translated into the write buffer before they are trimmed, so they need their input length there,
+  //decimals need their digits plus sign, decimal point and leading zeros
+  if (pField->cDatatype == 'P' || pField->cDatatype == 'S') {
+    iDigits = (pField->cDatatype == 'P') ? 2 * pField->iInputFieldLength - 1 : pField->iInputFieldLength;
+    pField->iDigits = iDigits;
+    //fields wider than a long are decoded in 128 bit, wider than that digit by digit
+    if (iDigits <= MAX_DIGITS_LONG) {
+      pField->iDecimalPath = DECIMAL_LONG;
+    }
+    else if (iDigits <= MAX_DIGITS_INT128) {
+      pField->iDecimalPath = DECIMAL_INT128;
+    }
+    else {
+      pField->iDecimalPath = DECIMAL_DIGITS;
+    }
+    cv->iWriteRecordSize += iDigits + 2 + ((pField->iPrecision >= iDigits) ? pField->iPrecision - iDigits + 1 : 0);
+  }
+  //binary integers take the digits their width holds, scaled like decimals
+  else if (pField->cDatatype == 'B') {
+    iDigits = (pField->iInputFieldLength <= 2) ? 5 : (pField->iInputFieldLength <= 4) ? 10 : pField->iUnsigned ? MAX_DIGITS_UNSIGNED_LONG : MAX_DIGITS_LONG + 1;
+    pField->iDigits = iDigits;
+    pField->iDecimalPath = DECIMAL_LONG;
+    cv->iWriteRecordSize += iDigits + 2 + ((pField->iPrecision >= iDigits) ? pField->iPrecision - iDigits + 1 : 0);
+  }
+  else if (pField->cDatatype == 'F' || pField->cDatatype == 'H') {
+    cv->iWriteRecordSize += FLOAT_TEXT_LENGTH;
+  }
+  //dates are translated in place and written as YYYY-MM-DD
+  else if (pField->cDatatype == 'L') {
+    cv->iWriteRecordSize += (pField->iInputFieldLength > DATE_TEXT_LENGTH) ? pField->iInputFieldLength : DATE_TEXT_LENGTH;
+  }
+  else {
+    cv->iWriteRecordSize += (pField->iInputFieldLength > pField->iOutputFieldLength) ? pField->iInputFieldLength : pField->iOutputFieldLength;
+  }
+  cv->iWriteRecordSize++;
+}
+
+int LoadMetadata(CONVERTER *cv)
+{
+
+  int i, j, k;
+  int iFailed = 0;
+  char sBuffer[255];
+  char *pToken;
+  char *pSave;
+  FILE *fpMetadataFile;
+
+  //a COBOL copybook is compiled into the same metadata
+  if (IsCopybook(cv->sSchema)) {
+    return (LoadCopybook(cv) == 0) ? CompileRecordPlan(cv) : -1;
+  }
+  //open the file
+  if ((fpMetadataFile = fopen(cv->sSchema, "r")) != NULL) {
+    i = j = 0;
+    cv->iInputRecordLength = 0;
+    cv->iOutputRecordLength = 0;
+    cv->iNumberOfAttributes = 0;
+    cv->iWriteRecordSize = 0;
+    fprintf(stdout, "%s %s [INFO]: Reading metadata file %s\n", GetDateTime(), sUUID, cv->sSchema );
+    //go through all the records
+    while(!feof(fpMetadataFile)) {
+      if (fgets(sBuffer, sizeof(sBuffer), fpMetadataFile) != NULL) {
+        //allocate required structure pointers
+        if ((cv->Metadata = (METADATARECORD **) realloc(cv->Metadata, (i+1) * sizeof (METADATARECORD *))) != NULL) {
+          if((cv->Metadata[i] = (METADATARECORD *) calloc(1, sizeof (METADATARECORD))) != NULL) {
+            j = 1;
+            //tokenize each line and store data in corresponding structure fields
+            pToken = strtok_r(sBuffer, "\t", &pSave);
+            while(pToken != NULL) {
+              switch(j) {
+                case 1:
+                  strcpy(cv->Metadata[i]->sFieldname, pToken);
+                  break;
+                case 2:
+                  strcpy(cv->Metadata[i]->sSize, pToken);
+                  if (strstr(cv->Metadata[i]->sSize, ",") != NULL) {
+                    for (k = 0; k < strlen(cv->Metadata[i]->sSize); k++) {
+                      if (cv->Metadata[i]->sSize[k] == ',') {
+                        cv->Metadata[i]->sSize[k] = '\0';
+                        cv->Metadata[i]->iPrecision = atoi(&(cv->Metadata[i]->sSize[k + 1]));
+                      }
+                    }
+                  }
+                  else {
+                    cv->Metadata[i]->iPrecision = 0;
+                  }
+                  cv->Metadata[i]->iOutputFieldLength = atoi(cv->Metadata[i]->sSize);
+                  break;
+                case 3:
+                  cv->Metadata[i]->cDatatype=(char) pToken[0];
+                  //a date may give the format of its input, L:YYYY-MM-DD
+                  if (pToken[0] == 'L' && pToken[1] == ':' && (cv->Metadata[i]->iDateFormat = FindDateFormat(&pToken[2])) < 0) {
+                    fprintf(stdout, "%s %s [ERROR]: Unknown date format %s of field %s!\n", GetDateTime(), sUUID, &pToken[2], cv->Metadata[i]->sFieldname);
+                    iFailed = 1;
+                  }
+                  break;
+                case 4: cv->Metadata[i]->iFrom=atoi(pToken); break;
+                case 5: cv->Metadata[i]->iTo=atoi(pToken); break;
+                case 6: strcpy(cv->Metadata[i]->sDescription, pToken); break;
+                case 7: strcpy(cv->Metadata[i]->sTranslation, pToken); break;
+                //code page of a text or date field if it isn't the one of the file
+                case 8:
+                  pToken[strcspn(pToken, "\r\n")] = '\0';
+                  if (*pToken != '\0' && (cv->Metadata[i]->iCodePage = FindCodePage(pToken) + 1) == 0) {
+                    fprintf(stdout, "%s %s [ERROR]: Unknown code page %s of field %s!\n", GetDateTime(), sUUID, pToken, cv->Metadata[i]->sFieldname);
+                    iFailed = 1;
+                  }
+                  break;
+                default: break;
+              }
+              pToken = strtok_r(NULL, "\t", &pSave);
+              j++;
+            }
+            CompleteMetadataField(cv, i);
+          }
+          else {
+            fprintf(stdout, "%s %s [ERROR]: Unable to allocate metadata record!\n", GetDateTime(), sUUID);
+            exit(-1);
+          }
+        }
+        else {
+          fprintf(stdout, "%s %s [ERROR]: Unable to allocate metadata table!\n", GetDateTime(), sUUID);
+          exit(-1);
+        }
+        cv->iNumberOfAttributes++;
+        i++;
+      }
+    }
+    fclose(fpMetadataFile);
+  }
+  else {
+    fprintf(stdout, "%s %s [ERROR]: Unable to open metadata file %s!\n", GetDateTime(), sUUID, cv->sSchema);
+    return -1;
+  }
+  if (iFailed) {
+    return -1;
+  }
+  fprintf(stdout, "%s %s [INFO]: Metadata file %s successfully processed.\n", GetDateTime(), sUUID, cv->sSchema);
+  return CompileRecordPlan(cv);
+}
+
+//a copybook is metadata input with the extension .cpy, .cbl, .cob or .copy
+int IsCopybook(const char *sSchema)
+{
+
+  const char *pExtension = strrchr(sSchema, '.');
+
+  return pExtension != NULL && strchr(pExtension, '/') == NULL
+         && (strcasecmp(pExtension, ".cpy") == 0 || strcasecmp(pExtension, ".cbl") == 0 || strcasecmp(pExtension, ".cob") == 0 || strcasecmp(pExtension, ".copy") == 0);
+}
+
+//words that start a clause of a data description entry, they end the names and literals of the clause before
+static int IsCopybookClause(const char *sToken)
+{
+
+  static const char *Clauses[] = { "REDEFINES", "PIC", "PICTURE", "USAGE", "OCCURS", "VALUE", "VALUES", "SIGN", "LEADING", "TRAILING",
+                                   "SYNC", "SYNCHRONIZED", "JUST", "JUSTIFIED", "BLANK", "INDEXED", "ASCENDING", "DESCENDING",
+                                   "GLOBAL", "EXTERNAL", NULL };
+  int i;
+
+  for (i = 0; Clauses[i] != NULL; i++) {
+    if (strcmp(sToken, Clauses[i]) == 0) {
+      return 1;
+    }
+  }
+  return CopybookUsage(sToken) != USAGE_NONE;
+}
+
+int CopybookUsage(const char *sToken)
+{
+  if (strcmp(sToken, "DISPLAY") == 0) {
+    return USAGE_DISPLAY;
+  }
+  if (strcmp(sToken, "COMP-3") == 0 || strcmp(sToken, "COMPUTATIONAL-3") == 0 || strcmp(sToken, "PACKED-DECIMAL") == 0) {
+    return USAGE_PACKED;
+  }
+  if (strcmp(sToken, "COMP") == 0 || strcmp(sToken, "COMPUTATIONAL") == 0 || strcmp(sToken, "COMP-4") == 0 || strcmp(sToken, "COMPUTATIONAL-4") == 0
+      || strcmp(sToken, "COMP-5") == 0 || strcmp(sToken, "COMPUTATIONAL-5") == 0 || strcmp(sToken, "BINARY") == 0) {
+    return USAGE_BINARY;
+  }
+  if (strcmp(sToken, "COMP-1") == 0 || strcmp(sToken, "COMPUTATIONAL-1") == 0) {
+    return USAGE_FLOAT;
+  }
+  if (strcmp(sToken, "COMP-2") == 0 || strcmp(sToken, "COMPUTATIONAL-2") == 0) {
+    return USAGE_DOUBLE;
+  }
+  return USAGE_NONE;
+}
+
+//the source text of a copybook without sequence numbers, indicator area, comments and compiler directives, one line per line,
+//reference format (text in columns 8-72) unless the copybook starts with >>SOURCE FORMAT FREE
+static char *CopybookText(const char *pSource, size_t lSize)
+{
+
+  int iFree = 0;
+  int iFirst = 1;
+  size_t lLine;
+  size_t lLength = 0;
+  const char *pLine;
+  const char *pEnd = pSource + lSize;
+  const char *pNext;
+  char *pText;
+  char *pComment;
+
+  if ((pText = (char *) malloc(lSize + 1)) == NULL) {
+    fprintf(stdout, "%s %s [ERROR]: Unable to allocate copybook!\n", GetDateTime(), sUUID);
+    exit(-1);
+  }
+  for (pLine = pSource; pLine < pEnd; pLine = pNext) {
+    if ((pNext = memchr(pLine, '\n', pEnd - pLine)) == NULL) {
+      pNext = pEnd;
+    }
+    lLine = pNext - pLine;
+    if (pNext < pEnd) {
+      pNext++;
+    }
+    if (lLine > 0 && pLine[lLine - 1] == '\r') {
+      lLine--;
+    }
+    if (iFirst && lLine > 0 && strspn(pLine, " \t") < lLine) {
+      iFirst = 0;
+      iFree = (strncasecmp(&pLine[strspn(pLine, " \t")], ">>SOURCE", 8) == 0 && memmem(pLine, lLine, "FREE", 4) != NULL);
+    }
+    if (!iFree) {
+      //column 7: * and / comment lines, D debugging lines
+      if (lLine < 7 || pLine[6] == '*' || pLine[6] == '/' || pLine[6] == 'D' || pLine[6] == 'd') {
+        lLine = 0;
+      }
+      else {
+        lLine = ((lLine > 72) ? 72 : lLine) - 7;
+        pLine += 7;
+      }
+    }
+    memcpy(&pText[lLength], pLine, lLine);
+    pText[lLength + lLine] = '\0';
+    if ((pComment = strstr(&pText[lLength], "*>")) != NULL) {
+      *pComment = '\0';
+    }
+    if (strncmp(&pText[lLength + strspn(&pText[lLength], " \t")], ">>", 2) == 0) {
+      pText[lLength] = '\0';
+    }
+    lLength += strlen(&pText[lLength]);
+    pText[lLength++] = '\n';
+  }
+  pText[lLength] = '\0';
+  return pText;
+}
+
+//the next data description entry of the copybook text: its tokens up to the separator period, literals as they are,
+//words in upper case, returns the number of tokens, 0 at the end of the text
+static int NextCopybookEntry(const char **ppText, int *piLine, char Tokens[][MAX_COPYBOOK_TOKEN + 1], int *piFirstLine)
+{
+
+  int i;
+  int iTokens = 0;
+  int iLength;
+  char cQuote;
+  const char *p = *ppText;
+  const char *pStart;
+
+  for (;;) {
+    while (*p == ' ' || *p == '\t' || *p == '\n' || *p == ',' || *p == ';') {
+      *piLine += (*p++ == '\n');
+    }
+    if (*p == '\0') {
+      break;
+    }
+    if (*p == '.' && (p[1] == '\0' || isspace((unsigned char) p[1]))) {
+      p++;
+      if (iTokens > 0) {
+        break;
+      }
+      continue;
+    }
+    if (iTokens == 0) {
+      *piFirstLine = *piLine;
+    }
+    pStart = p;
+    if (*p == '\'' || *p == '"') {
+      for (cQuote = *p++; *p != '\0' && *p != '\n' && (*p != cQuote || p[1] == cQuote); p += (*p == cQuote) ? 2 : 1);
+      if (*p == cQuote) {
+        p++;
+      }
+    }
+    else {
+      while (*p != '\0' && !isspace((unsigned char) *p) && !(*p == '.' && (p[1] == '\0' || isspace((unsigned char) p[1])))
+             && !((*p == ',' || *p == ';') && (p[1] == '\0' || isspace((unsigned char) p[1])))) {
+        p++;
+      }
+    }
+    //tokens past the limit are counted but not kept, only VALUE lists of condition names get that long
+    if (iTokens < MAX_COPYBOOK_TOKENS) {
+      iLength = (p - pStart > MAX_COPYBOOK_TOKEN) ? MAX_COPYBOOK_TOKEN : (int) (p - pStart);
+      memcpy(Tokens[iTokens], pStart, iLength);
+      Tokens[iTokens][iLength] = '\0';
+      for (i = 0; *pStart != '\'' && *pStart != '"' && i < iLength; i++) {
+        Tokens[iTokens][i] = toupper((unsigned char) Tokens[iTokens][i]);
+      }
+    }
+    iTokens++;
+  }
+  *ppText = p;
+  return iTokens;
+}
+
+//parse a data description entry into pItem, returns 1 for an item, 0 for an entry that describes no bytes (levels 66 and 88,
+//EJECT and SKIP) and -1 with the reason in sError
+static int ParseCopybookEntry(char Tokens[][MAX_COPYBOOK_TOKEN + 1], int iTokens, COPYBOOKITEM *pItem, const char **psError)
+{
+
+  int k = 0;
+  const char *sToken;
+
+  memset(pItem, 0, sizeof(COPYBOOKITEM));
+  pItem->iRedefined = -1;
+  while (k < iTokens && (strcmp(Tokens[k], "EJECT") == 0 || strncmp(Tokens[k], "SKIP", 4) == 0)) {
+    k++;
+  }
+  if (k == iTokens) {
+    return 0;
+  }
+  if (strspn(Tokens[k], "0123456789") != strlen(Tokens[k])) {
+    *psError = "level number expected";
+    return -1;
+  }
+  pItem->iLevel = atoi(Tokens[k++]);
+  if (pItem->iLevel == 66 || pItem->iLevel == 88) {
+    return 0;
+  }
+  if (pItem->iLevel == 77) {
+    pItem->iLevel = 1;
+  }
+  if (pItem->iLevel < 1 || pItem->iLevel > 49) {
+    *psError = "invalid level number";
+    return -1;
+  }
+  if (iTokens > MAX_COPYBOOK_TOKENS) {
+    *psError = "too many words";
+    return -1;
+  }
+  if (k < iTokens && !IsCopybookClause(Tokens[k])) {
+    if (strlen(Tokens[k]) > MAX_COBOL_NAME) {
+      *psError = "name longer than 30 characters";
+      return -1;
+    }
+    if (strcmp(Tokens[k], "FILLER") != 0) {
+      strcpy(pItem->sName, Tokens[k]);
+    }
+    k++;
+  }
+  while (k < iTokens) {
+    sToken = Tokens[k++];
+    if (strcmp(sToken, "REDEFINES") == 0 && k < iTokens && strlen(Tokens[k]) <= MAX_COBOL_NAME) {
+      strcpy(pItem->sRedefines, Tokens[k++]);
+    }
+    else if ((strcmp(sToken, "PIC") == 0 || strcmp(sToken, "PICTURE") == 0) && k < iTokens) {
+      k += (strcmp(Tokens[k], "IS") == 0);
+      if (k == iTokens || strlen(Tokens[k]) > MAX_PICTURE) {
+        *psError = "invalid PICTURE";
+        return -1;
+      }
+      strcpy(pItem->sPicture, Tokens[k++]);
+    }
+    else if (strcmp(sToken, "USAGE") == 0 || CopybookUsage(sToken) != USAGE_NONE) {
+      if (strcmp(sToken, "USAGE") == 0) {
+        k += (k < iTokens && strcmp(Tokens[k], "IS") == 0);
+        sToken = (k < iTokens) ? Tokens[k++] : "";
+      }
+      if ((pItem->iUsage = CopybookUsage(sToken)) == USAGE_NONE) {
+        *psError = "unsupported USAGE";
+        return -1;
+      }
+    }
+    else if (strcmp(sToken, "OCCURS") == 0) {
+      //OCCURS n TO m is laid out with m occurrences
+      pItem->iOccurs = (k < iTokens) ? atoi(Tokens[k++]) : 0;
+      if (k + 1 < iTokens && strcmp(Tokens[k], "TO") == 0) {
+        pItem->iOccurs = atoi(Tokens[k + 1]);
+        k += 2;
+      }
+      if (pItem->iOccurs < 1) {
+        *psError = "invalid OCCURS";
+        return -1;
+      }
+      k += (k < iTokens && strcmp(Tokens[k], "TIMES") == 0);
+      if (k < iTokens && strcmp(Tokens[k], "DEPENDING") == 0) {
+        k++;
+        k += (k < iTokens && strcmp(Tokens[k], "ON") == 0);
+        if (k == iTokens || strlen(Tokens[k]) > MAX_COBOL_NAME) {
+          *psError = "invalid DEPENDING ON";
+          return -1;
+        }
+        strcpy(pItem->sDependingOn, Tokens[k++]);
+      }
+    }
+    else if (strcmp(sToken, "SIGN") == 0 || strcmp(sToken, "LEADING") == 0 || strcmp(sToken, "TRAILING") == 0) {
+      if (strcmp(sToken, "SIGN") == 0) {
+        k += (k < iTokens && strcmp(Tokens[k], "IS") == 0);
+        sToken = (k < iTokens) ? Tokens[k++] : "";
+      }
+      //the sign in the zone of the last digit is what zoned fields are decoded with
+      if (strcmp(sToken, "TRAILING") != 0 || (k < iTokens && strcmp(Tokens[k], "SEPARATE") == 0)) {
+        *psError = "only SIGN TRAILING without SEPARATE is supported";
+        return -1;
+      }
+    }
+    else if (strcmp(sToken, "VALUE") == 0 || strcmp(sToken, "VALUES") == 0 || strcmp(sToken, "INDEXED") == 0
+             || strcmp(sToken, "ASCENDING") == 0 || strcmp(sToken, "DESCENDING") == 0) {
+      //literals and names that don't change the layout
+      while (k < iTokens && !IsCopybookClause(Tokens[k])) {
+        k++;
+      }
+    }
+    else if (strcmp(sToken, "SYNC") == 0 || strcmp(sToken, "SYNCHRONIZED") == 0 || strcmp(sToken, "JUST") == 0 || strcmp(sToken, "JUSTIFIED") == 0) {
+      k += (k < iTokens && (strcmp(Tokens[k], "LEFT") == 0 || strcmp(Tokens[k], "RIGHT") == 0));
+    }
+    else if (strcmp(sToken, "BLANK") == 0) {
+      k += (k < iTokens && strcmp(Tokens[k], "WHEN") == 0);
+      k += (k < iTokens && strncmp(Tokens[k], "ZERO", 4) == 0);
+    }
+    else if (strcmp(sToken, "GLOBAL") != 0 && strcmp(sToken, "EXTERNAL") != 0) {
+      *psError = "unsupported clause";
+      return -1;
+    }
+  }
+  return 1;
+}
+
+//datatype and bytes of an elementary item from its PICTURE and USAGE: alphanumeric and edited pictures are text,
+//numeric DISPLAY zoned, COMP-3 packed, COMP/COMP-4/COMP-5 binary and COMP-1/COMP-2 hexadecimal floats, returns the reason it can't be
+static const char *CopybookFieldType(COPYBOOKITEM *pItem, int iUsage)
+{
+
+  int iCount;
+  int iAlphanumeric = 0;
+  int iEdited = 0;
+  int iDecimals = -1;
+  const char *p;
+
+  pItem->iDigits = 0;
+  if (iUsage == USAGE_FLOAT || iUsage == USAGE_DOUBLE) {
+    if (pItem->sPicture[0] != '\0') {
+      return "COMP-1 and COMP-2 take no PICTURE";
+    }
+    pItem->cDatatype = 'H';
+    pItem->iLength = (iUsage == USAGE_FLOAT) ? 4 : 8;
+    return NULL;
+  }
+  if (pItem->sPicture[0] == '\0') {
+    return "elementary item without PICTURE";
+  }
+  for (p = pItem->sPicture; *p != '\0'; p++) {
+    iCount = 1;
+    if (p[1] == '(') {
+      iCount = atoi(&p[2]);
+      if (iCount < 1 || strchr(&p[2], ')') == NULL) {
+        return "invalid repetition in PICTURE";
+      }
+    }
+    switch (toupper((unsigned char) *p)) {
+      case 'X':
+      case 'A':
+        iAlphanumeric += iCount;
+        break;
+      case '9':
+        pItem->iDigits += iCount;
+        iDecimals += (iDecimals >= 0) ? iCount : 0;
+        break;
+      case 'S':
+        pItem->iSigned = 1;
+        break;
+      case 'V':
+        iDecimals = 0;
+        break;
+      case 'C':
+      case 'D':
+        if (toupper((unsigned char) p[1]) != ((toupper((unsigned char) *p) == 'C') ? 'R' : 'B')) {
+          return "invalid PICTURE";
+        }
+        p++;
+        iEdited += 2;
+        break;
+      case 'Z':
+      case '*':
+      case '+':
+      case '-':
+      case ',':
+      case '.':
+      case 'B':
+      case '0':
+      case '/':
+      case '$':
+        iEdited += iCount;
+        break;
+      default:
+        return "unsupported PICTURE symbol";
+    }
+    if (p[1] == '(') {
+      p = strchr(p, ')');
+    }
+  }
+  pItem->iPrecision = (iDecimals > 0) ? iDecimals : 0;
+  //edited pictures are delivered as the text they hold
+  if (iAlphanumeric > 0 || iEdited > 0 || pItem->iDigits == 0) {
+    if (iUsage != USAGE_DISPLAY) {
+      return "alphanumeric or edited PICTURE with a USAGE other than DISPLAY";
+    }
+    pItem->cDatatype = 'A';
+    pItem->iLength = iAlphanumeric + iEdited + pItem->iDigits;
+    return NULL;
+  }
+  switch (iUsage) {
+    case USAGE_PACKED:
+      pItem->cDatatype = 'P';
+      pItem->iLength = pItem->iDigits / 2 + 1;
+      break;
+    case USAGE_BINARY:
+      if (pItem->iDigits > MAX_DIGITS_LONG) {
+        return "binary item with more than 18 digits";
+      }
+      pItem->cDatatype = 'B';
+      pItem->iLength = (pItem->iDigits <= 4) ? 2 : (pItem->iDigits <= 9) ? 4 : 8;
+      break;
+    case USAGE_FLOAT:
+    case USAGE_DOUBLE:
+      return "COMP-1 and COMP-2 take no PICTURE";
+    default:
+      pItem->cDatatype = 'S';
+      pItem->iLength = pItem->iDigits;
+      break;
+  }
+  return NULL;
+}
+
+//bytes of one occurrence of an item: groups lay out their children one after the other, a REDEFINES child starts where
+//the item it redefines starts and a group is as long as its longest alternative, offsets are relative to the group
+static int LayoutCopybookItem(COPYBOOKITEM *Items, int iItems, int iItem)
+{
+
+  int j;
+  int iStart;
+  int iEnd = 0;
+
+  if (iItem >= 0 && (iItem + 1 == iItems || Items[iItem + 1].iParent != iItem)) {
+    return Items[iItem].iLength;
+  }
+  for (j = iItem + 1; j < iItems; j++) {
+    if (Items[j].iParent != iItem) {
+      continue;
+    }
+    Items[j].iLength = LayoutCopybookItem(Items, iItems, j);
+    iStart = (Items[j].iRedefined >= 0) ? Items[Items[j].iRedefined].iOffset : iEnd;
+    Items[j].iOffset = iStart;
+    iStart += Items[j].iLength * ((Items[j].iOccurs > 0) ? Items[j].iOccurs : 1);
+    iEnd = (iStart > iEnd) ? iStart : iEnd;
+  }
+  return iEnd;
+}
+
+//add the elementary items below iItem, every occurrence of an OCCURS as fields of their own named _1, _2, ...
+static int EmitCopybookItem(CONVERTER *cv, const COPYBOOKITEM *Items, int iItems, int iItem, int iBase, const char *sSuffix, int iAlternative,
+                            int iInOccurs, int *piLine, const char **psError)
+{
+
+  int i, j, k;
+  int iStart;
+  char sName[MAX_FIELD_NAME + 1];
+  char sOccurrence[MAX_FIELD_NAME + 1];
+  const COPYBOOKITEM *pItem = &Items[iItem];
+  METADATARECORD *pField;
+
+  *piLine = pItem->iLine;
+  if (pItem->iAlternative > 0) {
+    iAlternative = pItem->iAlternative;
+  }
+  //occurrences beyond the DEPENDING ON counter are left empty, so they must be the end of the record
+  if (pItem->sDependingOn[0] != '\0') {
+    if (iInOccurs || cv->iOccursMax > 0) {
+      *psError = "only one OCCURS DEPENDING ON, not inside another OCCURS, is supported";
+      return -1;
+    }
+    for (i = cv->iNumberOfAttributes - 1; i >= 0 && strcmp(cv->Metadata[i]->sDescription, pItem->sDependingOn) != 0; i--);
+    if (i < 0 || (cv->Metadata[i]->cDatatype != 'S' && cv->Metadata[i]->cDatatype != 'P' && cv->Metadata[i]->cDatatype != 'B') || cv->Metadata[i]->iPrecision > 0
+        || cv->Metadata[i]->iDecimalPath != DECIMAL_LONG) {
+      *psError = "DEPENDING ON needs an integer numeric item in front of the OCCURS";
+      return -1;
+    }
+    cv->iDependingField = i;
+    cv->iOccursPosition = iBase + pItem->iOffset;
+    cv->iOccursLength = pItem->iLength;
+    cv->iOccursMax = pItem->iOccurs;
+  }
+  for (k = 0; k < ((pItem->iOccurs > 0) ? pItem->iOccurs : 1); k++) {
+    iStart = iBase + pItem->iOffset + k * pItem->iLength;
+    if (pItem->iOccurs > 0) {
+      if (snprintf(sOccurrence, sizeof(sOccurrence), "%s_%d", sSuffix, k + 1) >= (int) sizeof(sOccurrence)) {
+        *psError = "field name too long";
+        return -1;
+      }
+    }
+    else {
+      strcpy(sOccurrence, sSuffix);
+    }
+    if (iItem + 1 < iItems && Items[iItem + 1].iParent == iItem) {
+      for (j = iItem + 1; j < iItems; j++) {
+        if (Items[j].iParent == iItem
+            && EmitCopybookItem(cv, Items, iItems, j, iStart, sOccurrence, iAlternative, iInOccurs || pItem->iOccurs > 0, piLine, psError) != 0) {
+          return -1;
+        }
+      }
+      continue;
+    }
+    if (pItem->sName[0] == '\0') {
+      continue;
+    }
+    //the same name in two groups: the later one is qualified with the name of its group
+    if (snprintf(sName, sizeof(sName), "%s%s", pItem->sName, sOccurrence) >= (int) sizeof(sName)) {
+      *psError = "field name too long";
+      return -1;
+    }
+    for (i = 0; i < cv->iNumberOfAttributes && strcmp(cv->Metadata[i]->sFieldname, sName) != 0; i++);
+    if (i < cv->iNumberOfAttributes) {
+      for (j = pItem->iParent; j >= 0 && Items[j].sName[0] == '\0'; j = Items[j].iParent);
+      if (j < 0 || snprintf(sName, sizeof(sName), "%s_%s%s", Items[j].sName, pItem->sName, sOccurrence) >= (int) sizeof(sName)) {
+        *psError = "duplicate field name";
+        return -1;
+      }
+      for (i = 0; i < cv->iNumberOfAttributes && strcmp(cv->Metadata[i]->sFieldname, sName) != 0; i++);
+      if (i < cv->iNumberOfAttributes) {
+        *psError = "duplicate field name";
+        return -1;
+      }
+    }
+    if ((cv->Metadata = (METADATARECORD **) realloc(cv->Metadata, (cv->iNumberOfAttributes + 1) * sizeof(METADATARECORD *))) == NULL
+        || (pField = (METADATARECORD *) calloc(1, sizeof(METADATARECORD))) == NULL) {
+      fprintf(stdout, "%s %s [ERROR]: Unable to allocate metadata record!\n", GetDateTime(), sUUID);
+      exit(-1);
+    }
+    cv->Metadata[cv->iNumberOfAttributes] = pField;
+    for (i = 0; sName[i] != '\0'; i++) {
+      pField->sFieldname[i] = (sName[i] == '-') ? '_' : sName[i];
+    }
+    pField->cDatatype = pItem->cDatatype;
+    pField->iPrecision = pItem->iPrecision;
+    pField->iOutputFieldLength = (pItem->cDatatype == 'A' || pItem->cDatatype == 'H') ? pItem->iLength : pItem->iDigits;
+    pField->iUnsigned = (pItem->cDatatype == 'B' && !pItem->iSigned);
+    if (pItem->cDatatype == 'A' || pItem->cDatatype == 'H') {
+      snprintf(pField->sSize, sizeof(pField->sSize), "%d", pField->iOutputFieldLength);
+    }
+    else {
+      snprintf(pField->sSize, sizeof(pField->sSize), "%d,%d", pField->iOutputFieldLength, pField->iPrecision);
+    }
+    pField->iFrom = iStart + 1;
+    pField->iTo = iStart + pItem->iLength;
+    strcpy(pField->sDescription, pItem->sName);
+    pField->iAlternative = iAlternative;
+    CompleteMetadataField(cv, cv->iNumberOfAttributes);
+    cv->iNumberOfAttributes++;
+  }
+  return 0;
+}
+
+//parse and lay out the copybook text into the metadata of the converter
+static int CompileCopybook(CONVERTER *cv, const char *sText)
+{
+
+  int i, j;
+  int iItems = 0;
+  int iTokens;
+  int iLine = 1;
+  int iFirstLine = 0;
+  int iUsage;
+  int iExtent;
+  int *Stack = NULL;
+  int iStack = 0;
+  char (*Tokens)[MAX_COPYBOOK_TOKEN + 1];
+  const char *sError = NULL;
+  COPYBOOKITEM *Items = NULL;
+  COPYBOOKITEM *pItem;
+
+  if ((Tokens = malloc(MAX_COPYBOOK_TOKENS * sizeof(*Tokens))) == NULL) {
+    fprintf(stdout, "%s %s [ERROR]: Unable to allocate copybook!\n", GetDateTime(), sUUID);
+    exit(-1);
+  }
+  //the entries and their place in the hierarchy of levels, later records redefine the first one
+  while ((iTokens = NextCopybookEntry(&sText, &iLine, Tokens, &iFirstLine)) > 0) {
+    if ((Items = (COPYBOOKITEM *) realloc(Items, (iItems + 1) * sizeof(COPYBOOKITEM))) == NULL
+        || (Stack = (int *) realloc(Stack, (iItems + 1) * sizeof(int))) == NULL) {
+      fprintf(stdout, "%s %s [ERROR]: Unable to allocate copybook!\n", GetDateTime(), sUUID);
+      exit(-1);
+    }
+    pItem = &Items[iItems];
+    if ((i = ParseCopybookEntry(Tokens, iTokens, pItem, &sError)) <= 0) {
+      if (i < 0) {
+        break;
+      }
+      continue;
+    }
+    pItem->iLine = iFirstLine;
+    while (iStack > 0 && Items[Stack[iStack - 1]].iLevel >= pItem->iLevel) {
+      iStack--;
+    }
+    pItem->iParent = (iStack > 0) ? Stack[iStack - 1] : -1;
+    if (pItem->sRedefines[0] != '\0') {
+      for (j = iItems - 1; j >= 0 && (Items[j].iParent != pItem->iParent || strcmp(Items[j].sName, pItem->sRedefines) != 0); j--);
+      if (j < 0) {
+        sError = "REDEFINES of no item in front of it on the same level";
+        break;
+      }
+      pItem->iRedefined = (Items[j].iRedefined >= 0) ? Items[j].iRedefined : j;
+    }
+    else if (pItem->iParent < 0) {
+      for (j = 0; j < iItems && Items[j].iParent >= 0; j++);
+      pItem->iRedefined = (j < iItems) ? j : -1;
+    }
+    Stack[iStack++] = iItems++;
+  }
+  free(Tokens);
+  free(Stack);
+  if (sError == NULL && iItems == 0) {
+    sError = "no data description entries";
+  }
+  //datatypes of the elementary items, USAGE is inherited from the groups
+  for (i = 0; i < iItems && sError == NULL; i++) {
+    iFirstLine = Items[i].iLine;
+    if (i + 1 < iItems && Items[i + 1].iParent == i) {
+      if (Items[i].sPicture[0] != '\0') {
+        sError = "group item with PICTURE";
+      }
+      continue;
+    }
+    for (j = i; j >= 0 && Items[j].iUsage == USAGE_NONE; j = Items[j].iParent);
+    iUsage = (j >= 0) ? Items[j].iUsage : USAGE_DISPLAY;
+    sError = CopybookFieldType(&Items[i], iUsage);
+  }
+  //REDEFINES alternatives in the order of the copybook, so an alternative inside another one comes after it
+  for (i = 0; i < iItems && sError == NULL; i++) {
+    if (Items[i].iRedefined >= 0 && Items[Items[i].iRedefined].iAlternative == 0) {
+      Items[Items[i].iRedefined].iAlternative = -1;
+    }
+  }
+  //alternatives are numbered from 1, entry 0 stands for the fields outside of any
+  if ((cv->AlternativeNames = calloc(1, sizeof(*cv->AlternativeNames))) == NULL || (cv->AlternativeParents = (int *) calloc(1, sizeof(int))) == NULL) {
+    fprintf(stdout, "%s %s [ERROR]: Unable to allocate copybook!\n", GetDateTime(), sUUID);
+    exit(-1);
+  }
+  cv->iAlternatives = 0;
+  for (i = 0; i < iItems && sError == NULL; i++) {
+    if (Items[i].iRedefined < 0 && Items[i].iAlternative == 0) {
+      continue;
+    }
+    iFirstLine = Items[i].iLine;
+    if (cv->iAlternatives == MAX_ALTERNATIVES) {
+      sError = "more than 64 REDEFINES alternatives";
+      break;
+    }
+    if ((cv->AlternativeNames = realloc(cv->AlternativeNames, (cv->iAlternatives + 2) * sizeof(*cv->AlternativeNames))) == NULL
+        || (cv->AlternativeParents = (int *) realloc(cv->AlternativeParents, (cv->iAlternatives + 2) * sizeof(int))) == NULL) {
+      fprintf(stdout, "%s %s [ERROR]: Unable to allocate copybook!\n", GetDateTime(), sUUID);
+      exit(-1);
+    }
+    Items[i].iAlternative = ++cv->iAlternatives;
+    for (j = 0; Items[i].sName[j] != '\0'; j++) {
+      cv->AlternativeNames[cv->iAlternatives][j] = (Items[i].sName[j] == '-') ? '_' : Items[i].sName[j];
+    }
+    cv->AlternativeNames[cv->iAlternatives][j] = '\0';
+    for (j = Items[i].iParent; j >= 0 && Items[j].iAlternative == 0; j = Items[j].iParent);
+    cv->AlternativeParents[cv->iAlternatives] = (j >= 0) ? Items[j].iAlternative : 0;
+  }
+  if (sError == NULL) {
+    iExtent = LayoutCopybookItem(Items, iItems, -1);
+    cv->iOccursMax = 0;
+    for (i = 0; i < iItems && sError == NULL; i++) {
+      if (Items[i].iParent < 0) {
+        EmitCopybookItem(cv, Items, iItems, i, 0, "", 0, 0, &iFirstLine, &sError);
+      }
+    }
+    if (sError == NULL && cv->iOccursMax > 0 && cv->iOccursPosition + cv->iOccursLength * cv->iOccursMax != iExtent) {
+      sError = "OCCURS DEPENDING ON must end the record";
+    }
+    //the record is as long as the copybook lays it out, FILLER included
+    cv->iInputRecordLength = iExtent;
+  }
+  free(Items);
+  if (sError == NULL && cv->iNumberOfAttributes == 0) {
+    sError = "no elementary items";
+  }
+  if (sError != NULL) {
+    fprintf(stdout, "%s %s [ERROR]: Copybook %s, line %d: %s!\n", GetDateTime(), sUUID, cv->sSchema, iFirstLine, sError);
+    return -1;
+  }
+  return 0;
+}
+
+//the path of the compiled form of a copybook
+static int CopybookCacheName(const CONVERTER *cv, char *sCache, size_t lSize)
+{
+  return (snprintf(sCache, lSize, "%s.e2ac", cv->sSchema) < (int) lSize) ? 0 : -1;
+}
+
+//load the compiled copybook if it was compiled from the same text by the same version, returns -1 if it must be compiled
+static int LoadCopybookCache(CONVERTER *cv, unsigned long lHash)
+{
+
+  int i;
+  char sCache[PATH_MAX + 8];
+  COPYBOOKCACHE cc;
+  FILE *fpCache;
+
+  if (CopybookCacheName(cv, sCache, sizeof(sCache)) != 0 || (fpCache = fopen(sCache, "rb")) == NULL) {
+    return -1;
+  }
+  if (fread(&cc, sizeof(cc), 1, fpCache) != 1 || memcmp(cc.sMagic, COPYBOOK_MAGIC, sizeof(cc.sMagic)) != 0 || cc.lHash != lHash
+      || cc.iRecordSize != (int) sizeof(METADATARECORD) || cc.iNumberOfAttributes < 1 || cc.iAlternatives < 0 || cc.iAlternatives > MAX_ALTERNATIVES) {
+    fclose(fpCache);
+    return -1;
+  }
+  if ((cv->AlternativeNames = calloc(cc.iAlternatives + 1, sizeof(*cv->AlternativeNames))) == NULL
+      || (cv->AlternativeParents = (int *) calloc(cc.iAlternatives + 1, sizeof(int))) == NULL
+      || (cv->Metadata = (METADATARECORD **) calloc(cc.iNumberOfAttributes, sizeof(METADATARECORD *))) == NULL) {
+    fprintf(stdout, "%s %s [ERROR]: Unable to allocate metadata table!\n", GetDateTime(), sUUID);
+    exit(-1);
+  }
+  cv->iNumberOfAttributes = cc.iNumberOfAttributes;
+  if (fread(cv->AlternativeNames, sizeof(*cv->AlternativeNames), cc.iAlternatives + 1, fpCache) != (size_t) cc.iAlternatives + 1
+      || fread(cv->AlternativeParents, sizeof(int), cc.iAlternatives + 1, fpCache) != (size_t) cc.iAlternatives + 1) {
+    fclose(fpCache);
+    return -1;
+  }
+  for (i = 0; i < cc.iNumberOfAttributes; i++) {
+    if ((cv->Metadata[i] = (METADATARECORD *) malloc(sizeof(METADATARECORD))) == NULL) {
+      fprintf(stdout, "%s %s [ERROR]: Unable to allocate metadata record!\n", GetDateTime(), sUUID);
+      exit(-1);
+    }
+    if (fread(cv->Metadata[i], sizeof(METADATARECORD), 1, fpCache) != 1) {
+      fclose(fpCache);
+      return -1;
+    }
+  }
+  fclose(fpCache);
+  cv->iInputRecordLength = cc.iInputRecordLength;
+  cv->iOutputRecordLength = cc.iOutputRecordLength;
+  cv->iWriteRecordSize = cc.iWriteRecordSize;
+  cv->iAlternatives = cc.iAlternatives;
+  cv->iDependingField = cc.iDependingField;
+  cv->iOccursPosition = cc.iOccursPosition;
+  cv->iOccursLength = cc.iOccursLength;
+  cv->iOccursMax = cc.iOccursMax;
+  fprintf(stdout, "%s %s [INFO]: Compiled copybook %s loaded.\n", GetDateTime(), sUUID, sCache);
+  return 0;
+}
+
+//keep the compiled copybook next to it for the next run, written under another name and renamed so that no run
+//reads half of it, a directory that can't be written only costs the next run the compile
+static void SaveCopybookCache(const CONVERTER *cv, unsigned long lHash)
+{
+
+  int i;
+  int iFailed;
+  char sCache[PATH_MAX + 8];
+  char sTemp[PATH_MAX + 32];
+  COPYBOOKCACHE cc;
+  FILE *fpCache;
+
+  if (CopybookCacheName(cv, sCache, sizeof(sCache)) != 0) {
+    return;
+  }
+  snprintf(sTemp, sizeof(sTemp), "%s.%d.tmp", sCache, (int) getpid());
+  if ((fpCache = fopen(sTemp, "wb")) == NULL) {
+    fprintf(stdout, "%s %s [INFO]: Unable to write compiled copybook %s, it is compiled again next time.\n", GetDateTime(), sUUID, sCache);
+    return;
+  }
+  memset(&cc, 0, sizeof(cc));
+  memcpy(cc.sMagic, COPYBOOK_MAGIC, sizeof(cc.sMagic));
+  cc.iRecordSize = sizeof(METADATARECORD);
+  cc.lHash = lHash;
+  cc.iNumberOfAttributes = cv->iNumberOfAttributes;
+  cc.iInputRecordLength = cv->iInputRecordLength;
+  cc.iOutputRecordLength = cv->iOutputRecordLength;
+  cc.iWriteRecordSize = cv->iWriteRecordSize;
+  cc.iAlternatives = cv->iAlternatives;
+  cc.iDependingField = cv->iDependingField;
+  cc.iOccursPosition = cv->iOccursPosition;
+  cc.iOccursLength = cv->iOccursLength;
+  cc.iOccursMax = cv->iOccursMax;
+  iFailed = (fwrite(&cc, sizeof(cc), 1, fpCache) != 1);
+  iFailed |= (fwrite(cv->AlternativeNames, sizeof(*cv->AlternativeNames), cv->iAlternatives + 1, fpCache) != (size_t) cv->iAlternatives + 1);
+  iFailed |= (fwrite(cv->AlternativeParents, sizeof(int), cv->iAlternatives + 1, fpCache) != (size_t) cv->iAlternatives + 1);
+  for (i = 0; i < cv->iNumberOfAttributes; i++) {
+    iFailed |= (fwrite(cv->Metadata[i], sizeof(METADATARECORD), 1, fpCache) != 1);
+  }
+  iFailed |= (fclose(fpCache) != 0);
+  if (iFailed || rename(sTemp, sCache) != 0) {
+    fprintf(stdout, "%s %s [INFO]: Unable to write compiled copybook %s, it is compiled again next time.\n", GetDateTime(), sUUID, sCache);
+    unlink(sTemp);
+  }
+}
+
+//drop what a failed load of a compiled copybook left in the converter
+static void ResetCopybook(CONVERTER *cv)
+{
+
+  int i;
+
+  for (i = 0; i < cv->iNumberOfAttributes && cv->Metadata != NULL; i++) {
+    free(cv->Metadata[i]);
+  }
+  free(cv->Metadata);
+  free(cv->AlternativeNames);
+  free(cv->AlternativeParents);
+  cv->Metadata = NULL;
+  cv->AlternativeNames = NULL;
+  cv->AlternativeParents = NULL;
+  cv->iNumberOfAttributes = 0;
+  cv->iAlternatives = 0;
+  cv->iOccursMax = 0;
+}
+
+//a COBOL copybook as metadata input: its compiled form is used as long as the copybook and the version are the same,
+//otherwise the copybook is parsed, laid out into the metadata table and compiled for the next run
+int LoadCopybook(CONVERTER *cv)
+{
+
+  int iFailed;
+  unsigned long lHash = 14695981039346656037UL;
+  const char *p;
+  char *pSource;
+  char *sText;
+  struct stat st;
+  FILE *fpCopybook;
+
+  cv->Metadata = NULL;
+  cv->AlternativeNames = NULL;
+  cv->AlternativeParents = NULL;
+  cv->iNumberOfAttributes = 0;
+  cv->iInputRecordLength = 0;
+  cv->iOutputRecordLength = 0;
+  cv->iWriteRecordSize = 0;
+  cv->iAlternatives = 0;
+  cv->iOccursMax = 0;
+  if ((fpCopybook = fopen(cv->sSchema, "rb")) == NULL || fstat(fileno(fpCopybook), &st) != 0) {
+    fprintf(stdout, "%s %s [ERROR]: Unable to open metadata file %s!\n", GetDateTime(), sUUID, cv->sSchema);
+    if (fpCopybook != NULL) {
+      fclose(fpCopybook);
+    }
+    return -1;
+  }
+  if ((pSource = (char *) malloc(st.st_size + 1)) == NULL) {
+    fprintf(stdout, "%s %s [ERROR]: Unable to allocate copybook!\n", GetDateTime(), sUUID);
+    exit(-1);
+  }
+  iFailed = (fread(pSource, 1, st.st_size, fpCopybook) != (size_t) st.st_size);
+  fclose(fpCopybook);
+  if (iFailed) {
+    fprintf(stdout, "%s %s [ERROR]: Unable to read metadata file %s!\n", GetDateTime(), sUUID, cv->sSchema);
+    free(pSource);
+    return -1;
+  }
+  pSource[st.st_size] = '\0';
+  //FNV-1a of the version and the copybook, a new version may lay out the metadata differently
+  for (p = E2A_VERSION; *p != '\0'; p++) {
+    lHash = (lHash ^ (unsigned char) *p) * 1099511628211UL;
+  }
+  for (p = pSource; p < pSource + st.st_size; p++) {
+    lHash = (lHash ^ (unsigned char) *p) * 1099511628211UL;
+  }
+  if (LoadCopybookCache(cv, lHash) == 0) {
+    free(pSource);
+    return 0;
+  }
+  ResetCopybook(cv);
+  fprintf(stdout, "%s %s [INFO]: Compiling copybook %s\n", GetDateTime(), sUUID, cv->sSchema);
+  sText = CopybookText(pSource, st.st_size);
+  free(pSource);
+  iFailed = CompileCopybook(cv, sText);
+  free(sText);
+  if (iFailed) {
+    ResetCopybook(cv);
+    return -1;
+  }
+  fprintf(stdout, "%s %s [INFO]: Copybook %s: %d fields, record length %d, %d REDEFINES alternatives%s\n", GetDateTime(), sUUID, cv->sSchema,
+          cv->iNumberOfAttributes, cv->iInputRecordLength, cv->iAlternatives, (cv->iOccursMax > 0) ? ", OCCURS DEPENDING ON" : "");
+  SaveCopybookCache(cv, lHash);
+  return 0;
+}
+
+//compile the metadata into the record plan: one step per output column with its handler chosen once,
+//adjacent text fields are merged into runs that are translated in a single pass
+int CompileRecordPlan(CONVERTER *cv)
+{
+
+  int i;
+  int iGrowth = 0;
+  FIELDPLAN *pStep;
+  METADATARECORD *pField;
+  const CODEPAGE *pCodePage;
+
+  if (cv->iNumberOfAttributes == 0) {
+    fprintf(stdout, "%s %s [ERROR]: No attributes in metadata file %s!\n", GetDateTime(), sUUID, cv->sSchema);
+    return -1;
+  }
+  if (CompileColumns(cv) != 0 || CompileFilters(cv) != 0 || CompileSelectors(cv) != 0) {
+    return -1;
+  }
+  //Parquet columns have no empty values for the fields a record leaves out
+  if ((cv->iSelectors > 0 || cv->iOccursMax > 0) && cv->iOutputFormat == FORMAT_PARQUET) {
+    fprintf(stdout, "%s %s [ERROR]: --when and OCCURS DEPENDING ON can't be written as Parquet!\n", GetDateTime(), sUUID);
+    return -1;
+  }
+  cv->iSelectFields = (cv->iSelectors > 0 || cv->iOccursMax > 0);
+  cv->Plan = (FIELDPLAN *) calloc(cv->iNumberOfAttributes, sizeof(FIELDPLAN));
+  cv->PlanFieldLengths = (int *) calloc(cv->iNumberOfAttributes, sizeof(int));
+  if (cv->Plan == NULL || cv->PlanFieldLengths == NULL) {
+    fprintf(stdout, "%s %s [ERROR]: Unable to allocate record plan!\n", GetDateTime(), sUUID);
+    exit(-1);
+  }
+  //UTF-8 text takes up to two bytes per character, three with a euro sign, the write buffer grows by the difference
+  //(the metadata, a compiled copybook too, leaves room for one byte per character whatever the encoding)
+  if (cv->iEncoding == ENCODING_UTF8) {
+    for (i = 0; i < cv->iNumberOfAttributes; i++) {
+      pField = cv->Metadata[i];
+      if (pField->cDatatype == 'A' || pField->cDatatype == 'T') {
+        iGrowth += (FieldCodePage(cv, pField)->cEuro ? UTF8_EURO_LENGTH - 1 : 1)
+                   * ((pField->iInputFieldLength > pField->iOutputFieldLength) ? pField->iInputFieldLength : pField->iOutputFieldLength);
+      }
+    }
+  }
+  cv->iWriteRecordSize += iGrowth - cv->iWriteRecordGrowth;
+  cv->iWriteRecordGrowth = iGrowth;
+  cv->iPlanSteps = 0;
+  pStep = NULL;
+  for (i = 0; i < cv->iNumberOfColumns; i++) {
+    pField = cv->Metadata[cv->Columns[i]];
+    pCodePage = FieldCodePage(cv, pField);
+    cv->PlanFieldLengths[i] = pField->iInputFieldLength;
+    //a text field right behind the previous text field extends its run
+    //fixed-width output pads every field on its own, runs don't cross REDEFINES alternatives, DEPENDING ON occurrences
+    //and code pages
+    if ((pField->cDatatype == 'A' || pField->cDatatype == 'T') && pStep != NULL && cv->iOutputFormat != FORMAT_FIXED
+        && (pStep->Handler == HandleText || pStep->Handler == HandleTextRun || pStep->Handler == HandleTextUtf8 || pStep->Handler == HandleTextRunUtf8)
+        && pStep->iInputPosition + pStep->iInputFieldLength == pField->iInputPosition && pStep->iAlternative == pField->iAlternative
+        && pStep->pTable == pCodePage->pTable
+        && (cv->iOccursMax == 0 || pField->iInputPosition < cv->iOccursPosition || (pField->iInputPosition - cv->iOccursPosition) % cv->iOccursLength != 0)) {
+      pStep->Handler = (cv->iEncoding == ENCODING_UTF8) ? HandleTextRunUtf8 : HandleTextRun;
+      pStep->iInputFieldLength += pField->iInputFieldLength;
+      pStep->iFields++;
+      continue;
+    }
+    pStep = &cv->Plan[cv->iPlanSteps++];
+    pStep->iInputPosition = pField->iInputPosition;
+    pStep->iInputFieldLength = pField->iInputFieldLength;
+    pStep->iPrecision = pField->iPrecision;
+    pStep->cDatatype = pField->cDatatype;
+    pStep->iFields = 1;
+    pStep->pFieldLengths = &cv->PlanFieldLengths[i];
+    pStep->pTable = pCodePage->pTable;
+    pStep->cEuro = pCodePage->cEuro;
+    pStep->iMetricType = MetricType(pField->cDatatype);
+    pStep->iField = cv->Columns[i];
+    pStep->iAlternative = pField->iAlternative;
+    //decimals take their digits, sign, decimal point and leading zeros like in the write buffer
+    if (pField->cDatatype == 'P' || pField->cDatatype == 'S' || pField->cDatatype == 'B') {
+      pStep->iWidth = pField->iDigits + 2 + ((pField->iPrecision >= pField->iDigits) ? pField->iPrecision - pField->iDigits + 1 : 0);
+    }
+    else if (pField->cDatatype == 'F' || pField->cDatatype == 'H') {
+      pStep->iWidth = FLOAT_TEXT_LENGTH;
+    }
+    else if (pField->cDatatype == 'L') {
+      pStep->iWidth = (pField->iOutputFieldLength > DATE_TEXT_LENGTH) ? pField->iOutputFieldLength : DATE_TEXT_LENGTH;
+    }
+    else {
+      pStep->iWidth = pField->iOutputFieldLength;
+    }
+    switch (pField->cDatatype) {
+      case 'A':
+      case 'T':
+        pStep->Handler = (cv->iEncoding == ENCODING_UTF8) ? HandleTextUtf8 : HandleText;
+        break;
+      case 'L':
+        pStep->iDateFormat = pField->iDateFormat;
+        pStep->iRejectDates = cv->iRejectDates;
+        pStep->Handler = IS_PACKED_DATE(pField) ? HandlePackedDate : HandleDate;
+        break;
+      case 'P':
+        pStep->Handler = (pField->iDecimalPath == DECIMAL_LONG) ? HandlePacked : (pField->iDecimalPath == DECIMAL_INT128) ? HandlePacked128 : HandlePackedDigits;
+        break;
+      case 'S':
+        pStep->Handler = (pField->iDecimalPath == DECIMAL_LONG) ? HandleZoned : (pField->iDecimalPath == DECIMAL_INT128) ? HandleZoned128 : HandleZonedDigits;
+        break;
+      case 'B':
+        if (pField->iInputFieldLength != 2 && pField->iInputFieldLength != 4 && pField->iInputFieldLength != 8) {
+          fprintf(stdout, "%s %s [ERROR]: Binary field %s must be 2, 4 or 8 bytes long!\n", GetDateTime(), sUUID, pField->sFieldname);
+          return -1;
+        }
+        pStep->Handler = pField->iUnsigned ? HandleBinaryUnsigned : (pField->iInputFieldLength == 2) ? HandleBinary2 : (pField->iInputFieldLength == 4) ? HandleBinary4 : HandleBinary8;
+        break;
+      case 'F':
+      case 'H':
+        if (pField->iInputFieldLength != 4 && pField->iInputFieldLength != 8) {
+          fprintf(stdout, "%s %s [ERROR]: Float field %s must be 4 or 8 bytes long!\n", GetDateTime(), sUUID, pField->sFieldname);
+          return -1;
+        }
+        pStep->Handler = (pField->cDatatype == 'F') ? HandleFloat : HandleHexFloat;
+        break;
+      default:
+        fprintf(stdout, "%s %s [Error]: Unmanaged Datatype %c in field %s!\n", GetDateTime(), sUUID, pField->cDatatype, pField->sFieldname);
+        return -1;
+    }
+  }
+  fprintf(stdout, "%s %s [INFO]: Record plan: %d steps for %d attributes, code page %s, text in %s\n", GetDateTime(), sUUID, cv->iPlanSteps,
+          cv->iNumberOfColumns, cv->pCodePage->sName, (cv->iEncoding == ENCODING_UTF8) ? "UTF-8" : "ISO-8859");
+  return 0;
+}
+
+//the fields named by --columns in the order of the metadata, all fields without it
+int CompileColumns(CONVERTER *cv)
+{
+
+  int i;
+  char *sColumns;
+  char *pToken;
+  char *pSave;
+  unsigned char *pSelected;
+
+  if ((cv->Columns = (int *) malloc(cv->iNumberOfAttributes * sizeof(int))) == NULL
+      || (pSelected = (unsigned char *) calloc(cv->iNumberOfAttributes, 1)) == NULL) {
+    fprintf(stdout, "%s %s [ERROR]: Unable to allocate column list!\n", GetDateTime(), sUUID);
+    exit(-1);
+  }
+  if (cv->sColumns == NULL) {
+    memset(pSelected, 1, cv->iNumberOfAttributes);
+  }
+  else {
+    if ((sColumns = strdup(cv->sColumns)) == NULL) {
+      fprintf(stdout, "%s %s [ERROR]: Unable to allocate column list!\n", GetDateTime(), sUUID);
+      exit(-1);
+    }
+    for (pToken = strtok_r(sColumns, ",", &pSave); pToken != NULL; pToken = strtok_r(NULL, ",", &pSave)) {
+      for (i = 0; i < cv->iNumberOfAttributes && strcmp(cv->Metadata[i]->sFieldname, pToken) != 0; i++);
+      if (i == cv->iNumberOfAttributes) {
+        fprintf(stdout, "%s %s [ERROR]: Column %s not in metadata file %s!\n", GetDateTime(), sUUID, pToken, cv->sSchema);
+        free(sColumns);
+        free(pSelected);
+        return -1;
+      }
+      pSelected[i] = 1;
+    }
+    free(sColumns);
+  }
+  cv->iNumberOfColumns = 0;
+  for (i = 0; i < cv->iNumberOfAttributes; i++) {
+    if (pSelected[i]) {
+      cv->Columns[cv->iNumberOfColumns++] = i;
+    }
+  }
+  free(pSelected);
+  if (cv->iNumberOfColumns < cv->iNumberOfAttributes) {
+    fprintf(stdout, "%s %s [INFO]: Columns: %d of %d attributes\n", GetDateTime(), sUUID, cv->iNumberOfColumns, cv->iNumberOfAttributes);
+  }
+  return 0;
+}
+
+//the constant of a condition on a packed or zoned field as an integer scaled to the precision of the field
+static int ParseFilterDecimal(const char *s, int iPrecision, __int128 *pllValue)
+{
+
+  int iNegative = 0;
+  int iDigits = 0;
+  int iFraction = -1;
+  __int128 llValue = 0;
+
+  if (*s == '-' || *s == '+') {
+    iNegative = (*s++ == '-');
+  }
+  for (; *s != '\0'; s++) {
+    if (*s == '.' && iFraction < 0) {
+      iFraction = 0;
+    }
+    else if (*s >= '0' && *s <= '9') {
+      llValue = llValue * 10 + (*s - '0');
+      iDigits++;
+      if (iFraction >= 0) {
+        iFraction++;
+      }
+    }
+    else {
+      return -1;
+    }
+  }
+  if (iFraction < 0) {
+    iFraction = 0;
+  }
+  if (iDigits == 0 || iFraction > iPrecision || iDigits - iFraction + iPrecision > MAX_DIGITS_INT128) {
+    return -1;
+  }
+  for (; iFraction < iPrecision; iFraction++) {
+    llValue *= 10;
+  }
+  *pllValue = iNegative ? -llValue : llValue;
+  return 0;
+}
+
+//compile a condition FIELD=VALUE, with != < <= > >= instead of = as well, into pFilter, sOption names it in messages
+static int CompileCondition(const CONVERTER *cv, const char *sCondition, FILTER *pFilter, const char *sOption)
+{
+
+  int i;
+  int iLength;
+  const char *pOperator;
+  const char *sValue;
+  const METADATARECORD *pField;
+
+  pOperator = &sCondition[strcspn(sCondition, "!<>=")];
+  iLength = pOperator - sCondition;
+  for (i = 0; i < cv->iNumberOfAttributes; i++) {
+    if (strncmp(cv->Metadata[i]->sFieldname, sCondition, iLength) == 0 && cv->Metadata[i]->sFieldname[iLength] == '\0') {
+      break;
+    }
+  }
+  if (*pOperator == '\0' || i == cv->iNumberOfAttributes) {
+    fprintf(stdout, "%s %s [ERROR]: %s %s: no field of metadata file %s!\n", GetDateTime(), sUUID, sOption, sCondition, cv->sSchema);
+    return -1;
+  }
+  pField = cv->Metadata[i];
+  pFilter->iField = i;
+  pFilter->iInputPosition = pField->iInputPosition;
+  pFilter->iInputFieldLength = pField->iInputFieldLength;
+  pFilter->cDatatype = pField->cDatatype;
+  pFilter->iDecimalPath = pField->iDecimalPath;
+  pFilter->iUnsigned = pField->iUnsigned;
+  pFilter->pTable = FieldCodePage(cv, pField)->pTable;
+  if (strncmp(pOperator, "!=", 2) == 0) {
+    pFilter->iAccept = FILTER_LT | FILTER_GT;
+  }
+  else if (strncmp(pOperator, "<=", 2) == 0) {
+    pFilter->iAccept = FILTER_LT | FILTER_EQ;
+  }
+  else if (strncmp(pOperator, ">=", 2) == 0) {
+    pFilter->iAccept = FILTER_GT | FILTER_EQ;
+  }
+  else {
+    pFilter->iAccept = (*pOperator == '<') ? FILTER_LT : (*pOperator == '>') ? FILTER_GT : (*pOperator == '=') ? FILTER_EQ : 0;
+  }
+  sValue = &pOperator[(pFilter->iAccept == FILTER_LT || pFilter->iAccept == FILTER_GT || pFilter->iAccept == FILTER_EQ) ? 1 : 2];
+  switch (pField->cDatatype) {
+    case 'A':
+    case 'T':
+      if ((pFilter->pText = (unsigned char *) malloc(strlen(sValue) + 1)) == NULL) {
+        fprintf(stdout, "%s %s [ERROR]: Unable to allocate condition!\n", GetDateTime(), sUUID);
+        exit(-1);
+      }
+      //the value is given in the encoding of the output, compared in the characters of the code page
+      if (cv->iEncoding == ENCODING_UTF8) {
+        iLength = NarrowUtf8(pFilter->pText, sValue, FieldCodePage(cv, pField)->cEuro);
+      }
+      else {
+        iLength = strlen(sValue);
+        memcpy(pFilter->pText, sValue, iLength);
+      }
+      //the field is compared trimmed, so is the value
+      for (i = 0; i < iLength && IS_BLANK(pFilter->pText[i]); i++);
+      for (; iLength > i && IS_BLANK(pFilter->pText[iLength - 1]); iLength--);
+      memmove(pFilter->pText, &pFilter->pText[i], (iLength > i) ? iLength - i : 0);
+      iLength = (iLength > i) ? iLength - i : 0;
+      if (pFilter->iAccept == 0 || iLength > pField->iInputFieldLength) {
+        fprintf(stdout, "%s %s [ERROR]: %s %s: invalid condition!\n", GetDateTime(), sUUID, sOption, sCondition);
+        return -1;
+      }
+      pFilter->iTextLength = iLength;
+      break;
+    case 'P':
+    case 'S':
+    case 'B':
+      if (pFilter->iAccept == 0 || pField->iDecimalPath == DECIMAL_DIGITS || ParseFilterDecimal(sValue, pField->iPrecision, &pFilter->llValue) != 0) {
+        fprintf(stdout, "%s %s [ERROR]: %s %s: invalid condition!\n", GetDateTime(), sUUID, sOption, sCondition);
+        return -1;
+      }
+      break;
+    default:
+      fprintf(stdout, "%s %s [ERROR]: %s %s: only A, T, P, S and B fields can be filtered!\n", GetDateTime(), sUUID, sOption, sCondition);
+      return -1;
+  }
+  return 0;
+}
+
+//compile the --where conditions
+int CompileFilters(CONVERTER *cv)
+{
+
+  int k;
+
+  cv->iFilters = 0;
+  if (cv->iWhereConditions == 0) {
+    return 0;
+  }
+  if ((cv->Filters = (FILTER *) calloc(cv->iWhereConditions, sizeof(FILTER))) == NULL) {
+    fprintf(stdout, "%s %s [ERROR]: Unable to allocate filter!\n", GetDateTime(), sUUID);
+    exit(-1);
+  }
+  for (k = 0; k < cv->iWhereConditions; k++) {
+    if (CompileCondition(cv, cv->Where[k], &cv->Filters[cv->iFilters++], "--where") != 0) {
+      return -1;
+    }
+  }
+  fprintf(stdout, "%s %s [INFO]: Filter: %d conditions\n", GetDateTime(), sUUID, cv->iFilters);
+  return 0;
+}
+
+//compile the --when conditions ALTERNATIVE:FIELD=VALUE of a copybook, an alternative with conditions is converted
+//only in the records that meet all of them
+int CompileSelectors(CONVERTER *cv)
+{
+
+  int i, k;
+  int iLength;
+  const char *sCondition;
+
+  cv->iSelectors = 0;
+  if (cv->iWhenConditions == 0) {
+    return 0;
+  }
+  if ((cv->Selectors = (FILTER *) calloc(cv->iWhenConditions, sizeof(FILTER))) == NULL) {
+    fprintf(stdout, "%s %s [ERROR]: Unable to allocate filter!\n", GetDateTime(), sUUID);
+    exit(-1);
+  }
+  for (k = 0; k < cv->iWhenConditions; k++) {
+    sCondition = cv->When[k];
+    iLength = strcspn(sCondition, ":");
+    for (i = cv->iAlternatives; i > 0; i--) {
+      if (strncmp(cv->AlternativeNames[i], sCondition, iLength) == 0 && cv->AlternativeNames[i][iLength] == '\0') {
+        break;
+      }
+    }
+    if (sCondition[iLength] != ':' || i == 0) {
+      fprintf(stdout, "%s %s [ERROR]: --when %s: no REDEFINES alternative of metadata file %s!\n", GetDateTime(), sUUID, sCondition, cv->sSchema);
+      return -1;
+    }
+    cv->Selectors[cv->iSelectors].iAlternative = i;
+    if (CompileCondition(cv, &sCondition[iLength + 1], &cv->Selectors[cv->iSelectors++], "--when") != 0) {
+      return -1;
+    }
+  }
+  fprintf(stdout, "%s %s [INFO]: Alternatives: %d conditions\n", GetDateTime(), sUUID, cv->iSelectors);
+  return 0;
+}
+
+//returns 1 if the record meets the condition, 0 if not and -1 if the field can't be decoded
+static inline int MatchCondition(const FILTER *pFilter, const unsigned char *pRecord)
+{
+
+  int i, j;
+  int iBegin, iEnd;
+  int iCompare = 0;
+  unsigned char c;
+  __int128 llValue;
+  const unsigned char *pInput = &pRecord[pFilter->iInputPosition];
+
+  if (pFilter->pText != NULL) {
+    //the text as trim() writes it: without leading and trailing blanks, " and | left out, CR and LF as ~,
+    //a blank field is empty, the first differing character decides in the order of the translated text,
+    //a text that is the start of the other one comes first
+    for (iBegin = 0; iBegin < pFilter->iInputFieldLength && IS_BLANK(pFilter->pTable[pInput[iBegin]]); iBegin++);
+    for (iEnd = pFilter->iInputFieldLength - 1; iEnd >= iBegin && IS_BLANK(pFilter->pTable[pInput[iEnd]]); iEnd--);
+    for (i = iBegin, j = 0; i <= iEnd && iCompare == 0; i++) {
+      c = pFilter->pTable[pInput[i]];
+      if (c == '"' || c == '|') {
+        continue;
+      }
+      if (c == '\n' || c == '\r') {
+        c = '~';
+      }
+      if (j == pFilter->iTextLength) {
+        iCompare = 1;
+      }
+      else if (c != pFilter->pText[j]) {
+        iCompare = (c < pFilter->pText[j]) ? -1 : 1;
+      }
+      j++;
+    }
+    if (iCompare == 0 && j < pFilter->iTextLength) {
+      iCompare = -1;
+    }
+  }
+  else {
+    if (pFilter->cDatatype == 'B') {
+      llValue = pFilter->iUnsigned ? (__int128) unbinaryu((const char *) pInput, pFilter->iInputFieldLength) : unbinary((const char *) pInput, pFilter->iInputFieldLength);
+    }
+    else if (pFilter->iDecimalPath == DECIMAL_LONG) {
+      llValue = (pFilter->cDatatype == 'P') ? unpack((const char *) pInput, pFilter->iInputFieldLength) : unzone((const char *) pInput, pFilter->iInputFieldLength);
+    }
+    else {
+      llValue = (pFilter->cDatatype == 'P') ? unpack128((const char *) pInput, pFilter->iInputFieldLength) : unzone128((const char *) pInput, pFilter->iInputFieldLength);
+    }
+    if (sDecodeError != NULL) {
+      iDecodeErrorField = pFilter->iField;
+      return -1;
+    }
+    iCompare = (llValue < pFilter->llValue) ? -1 : (llValue > pFilter->llValue) ? 1 : 0;
+  }
+  return (pFilter->iAccept & (1 << (iCompare + 1))) != 0;
+}
+
+//returns 1 if the record passes all --where conditions, 0 if it is skipped and -1 if a filtered field can't be decoded
+int FilterRecord(const CONVERTER *cv, const unsigned char *pRecord)
+{
+
+  int k;
+  int iMatch;
+
+  for (k = 0; k < cv->iFilters; k++) {
+    if ((iMatch = MatchCondition(&cv->Filters[k], pRecord)) <= 0) {
+      return iMatch;
+    }
+  }
+  return 1;
+}
+
+//--self-test: conditions on text fields of code page 273 against the text trim() writes of them, blanks around
+//the text, " and | in it, blank fields and texts that start alike, returns the number of wrong results
+int TestTextConditions(void)
+{
+
+  static const struct {
+    unsigned char Field[6];                  //EBCDIC
+    const char *sValue;                      //trimmed, as CompileCondition() leaves it
+    int iAccept;
+    int iMatch;
+  } Cases[] = {
+    {{0x40, 0xC6, 0x40, 0x40, 0x40, 0x40}, "F", FILTER_EQ, 1},
+    {{0x40, 0xC6, 0x40, 0x40, 0x40, 0x40}, "F", FILTER_LT | FILTER_GT, 0},
+    {{0x40, 0x40, 0xC6, 0xC6, 0x40, 0x40}, "FF", FILTER_EQ, 1},
+    {{0x40, 0x40, 0xC6, 0xC6, 0x40, 0x40}, "F", FILTER_GT, 1},
+    {{0x40, 0x40, 0xC6, 0xC6, 0x40, 0x40}, "FFF", FILTER_LT, 1},
+    {{0x40, 0xC6, 0x40, 0x40, 0x40, 0x40}, "G", FILTER_LT, 1},
+    {{0x40, 0xC6, 0x40, 0x40, 0x40, 0x40}, "E", FILTER_GT, 1},
+    {{0x40, 0xC6, 0x40, 0xC6, 0x40, 0x40}, "F F", FILTER_EQ, 1},
+    {{0xC6, 0x7F, 0xBB, 0x40, 0x40, 0x40}, "F", FILTER_EQ, 1},
+    {{0xC6, 0x7F, 0xC6, 0x40, 0x40, 0x40}, "FF", FILTER_EQ, 1},
+    {{0xC6, 0x25, 0xC6, 0x40, 0x40, 0x40}, "F~F", FILTER_EQ, 1},
+    {{0x40, 0x40, 0x40, 0x40, 0x40, 0x40}, "", FILTER_EQ, 1},
+    {{0x40, 0x40, 0x40, 0x40, 0x40, 0x40}, "F", FILTER_LT, 1},
+    {{0x40, 0x40, 0x40, 0x40, 0x40, 0xC6}, "", FILTER_GT, 1},
+    {{0xC6, 0xC6, 0xC6, 0xC6, 0xC6, 0xC6}, "FFFFFF", FILTER_EQ | FILTER_LT, 1},
+  };
+
+  int i, iMatch;
+  int iErrors = 0;
+  FILTER Filter;
+
+  memset(&Filter, 0, sizeof(Filter));
+  Filter.iInputFieldLength = sizeof(Cases[0].Field);
+  Filter.cDatatype = 'A';
+  Filter.pTable = ebc2asc;
+  for (i = 0; i < (int) (sizeof(Cases) / sizeof(Cases[0])); i++) {
+    Filter.pText = (unsigned char *) Cases[i].sValue;
+    Filter.iTextLength = strlen(Cases[i].sValue);
+    Filter.iAccept = Cases[i].iAccept;
+    if ((iMatch = MatchCondition(&Filter, Cases[i].Field)) != Cases[i].iMatch) {
+      fprintf(stdout, "%s %s [ERROR]: Text condition %d on value %s: %d instead of %d\n", GetDateTime(), sUUID, i, Cases[i].sValue, iMatch, Cases[i].iMatch);
+      iErrors++;
+    }
+  }
+  fprintf(stdout, "%s %s [INFO]: Self-test text conditions: %d cases, %d differences\n", GetDateTime(), sUUID, i, iErrors);
+  return iErrors;
+}
+
+//the fields of a copybook record to convert: the bits of the REDEFINES alternatives its --when conditions select,
+//an alternative inside another one only with it, a field that can't be decoded selects nothing, and the end of the
+//occurrences its DEPENDING ON counter holds, returns -1 if the counter can't be decoded or is out of range
+static int SelectFields(const CONVERTER *cv, const unsigned char *pRecord, unsigned long *plSelected, int *piEnd)
+{
+
+  int i, k;
+  long lCount;
+  unsigned long lSelected = ~0UL;
+  const METADATARECORD *pCounter;
+
+  for (k = 0; k < cv->iSelectors; k++) {
+    if (MatchCondition(&cv->Selectors[k], pRecord) <= 0) {
+      lSelected &= ~(1UL << (cv->Selectors[k].iAlternative - 1));
+      sDecodeError = NULL;
+    }
+  }
+  for (i = 1; i <= cv->iAlternatives && cv->iSelectors > 0; i++) {
+    if (cv->AlternativeParents[i] > 0 && (lSelected & (1UL << (cv->AlternativeParents[i] - 1))) == 0) {
+      lSelected &= ~(1UL << (i - 1));
+    }
+  }
+  *plSelected = lSelected;
+  *piEnd = cv->iInputRecordLength;
+  if (cv->iOccursMax > 0) {
+    pCounter = cv->Metadata[cv->iDependingField];
+    lCount = (pCounter->cDatatype == 'B') ? unbinary((const char *) &pRecord[pCounter->iInputPosition], pCounter->iInputFieldLength)
+           : (pCounter->cDatatype == 'P') ? unpack((const char *) &pRecord[pCounter->iInputPosition], pCounter->iInputFieldLength)
+                                          : unzone((const char *) &pRecord[pCounter->iInputPosition], pCounter->iInputFieldLength);
+    if (sDecodeError == NULL && (lCount < 0 || lCount > cv->iOccursMax)) {
+      sDecodeError = "OCCURS DEPENDING ON counter out of range";
+    }
+    if (sDecodeError != NULL) {
+      iDecodeErrorField = cv->iDependingField;
+      return -1;
+    }
+    *piEnd = cv->iOccursPosition + (int) lCount * cv->iOccursLength;
+  }
+  return 0;
+}
+
+//a step left empty in this record: its alternative is not selected or it lies in an occurrence beyond the counter
+#define SKIPPED_STEP(pStep, lSelected, iEnd) \
+  (((pStep)->iAlternative > 0 && ((lSelected) & (1UL << ((pStep)->iAlternative - 1))) == 0) || (pStep)->iInputPosition >= (iEnd))
+
+//input formats of dates as written in the metadata, in the order of DATE_DMY, DATE_ISO, DATE_YYYYMMDD and DATE_CYYMMDD
+static const char *DateFormats[] = { "DD.MM.YYYY", "YYYY-MM-DD", "YYYYMMDD", "CYYMMDD", NULL };
+
+//DATE_* of a date format of the metadata, -1 if there is no such format
+int FindDateFormat(const char *sFormat)
+{
+
+  int i;
+
+  for (i = 0; DateFormats[i] != NULL && strcmp(DateFormats[i], sFormat) != 0; i++);
+  return (DateFormats[i] != NULL) ? i : -1;
+}
+
+//value of iCount digits, -1 if any of them is no digit, all of them are looked at so that the constant counts
+//of the formats unroll without branches
+static inline int DateDigits(const char *s, int iCount)
+{
+
+  int i;
+  int iValue = 0;
+  unsigned int iInvalid = 0;
+
+  for (i = 0; i < iCount; i++) {
+    iInvalid |= (unsigned int) (s[i] - '0') > 9;
+    iValue = iValue * 10 + (s[i] - '0');
+  }
+  return iInvalid ? -1 : iValue;
+}
+
+//DATE_VALID if the date exists, the zero date stands for no date, digits that weren't digits are negative
+static inline int CheckDate(int iYear, int iMonth, int iDay)
+{
+
+  static const unsigned char DaysInMonth[13] = { 0, 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+  if ((iYear | iMonth | iDay) == 0) {
+    return DATE_NULL;
+  }
+  if (iYear < 1 || iMonth < 1 || iMonth > 12 || iDay < 1 || iDay > DaysInMonth[iMonth]
+      || (iMonth == 2 && iDay == 29 && !(iYear % 4 == 0 && (iYear % 100 != 0 || iYear % 400 == 0)))) {
+    return DATE_INVALID;
+  }
+  return DATE_VALID;
+}
+
+//parse the iLength characters of a date in iFormat at their fixed positions, s is the text of the field without
+//its leading and trailing blanks
+int ParseDate(const char *s, int iLength, int iFormat, int *piYear, int *piMonth, int *piDay)
+{
+
+  int iCentury;
+
+  switch (iFormat) {
+    case DATE_DMY:
+      if (iLength != DATE_TEXT_LENGTH || s[2] != '.' || s[5] != '.') {
+        return DATE_INVALID;
+      }
+      *piDay = DateDigits(s, 2);
+      *piMonth = DateDigits(&s[3], 2);
+      *piYear = DateDigits(&s[6], 4);
+      break;
+    case DATE_ISO:
+      if (iLength != DATE_TEXT_LENGTH || s[4] != '-' || s[7] != '-') {
+        return DATE_INVALID;
+      }
+      *piYear = DateDigits(s, 4);
+      *piMonth = DateDigits(&s[5], 2);
+      *piDay = DateDigits(&s[8], 2);
+      break;
+    case DATE_YYYYMMDD:
+      if (iLength != 8) {
+        return DATE_INVALID;
+      }
+      *piYear = DateDigits(s, 4);
+      *piMonth = DateDigits(&s[4], 2);
+      *piDay = DateDigits(&s[6], 2);
+      break;
+    default:
+      //the century 0 may have been left out as a leading zero
+      if (iLength != 7 && iLength != 6) {
+        return DATE_INVALID;
+      }
+      iCentury = (iLength == 7) ? DateDigits(s, 1) : 0;
+      s += iLength - 6;
+      *piYear = DateDigits(s, 2);
+      *piMonth = DateDigits(&s[2], 2);
+      *piDay = DateDigits(&s[4], 2);
+      if ((iCentury | *piYear | *piMonth | *piDay) == 0) {
+        return DATE_NULL;
+      }
+      if (iCentury < 0 || *piYear < 0) {
+        return DATE_INVALID;
+      }
+      *piYear += 1900 + 100 * iCentury;
+      break;
+  }
+  return CheckDate(*piYear, *piMonth, *piDay);
+}
+
+//AS400 CYYMMDD date packed into 4 bytes: seven digits and the sign, blank or zero bytes are no date
+int ParsePackedDate(const unsigned char *p, int *piYear, int *piMonth, int *piDay)
+{
+
+  unsigned int iPacked = (unsigned int) p[0] << 24 | (unsigned int) p[1] << 16 | (unsigned int) p[2] << 8 | p[3];
+  unsigned int iDigits = iPacked >> 4;
+
+  if (iDigits == 0 || iPacked == 0x40404040) {
+    return DATE_NULL;
+  }
+  //a digit nibble above 9 carries into the next nibble when 6 is added to every digit
+  if (((iDigits + 0x06666666) ^ iDigits ^ 0x06666666) & 0x11111110 || ((iPacked & 0x0F) != 0x0F && (iPacked & 0x0F) != 0x0C)) {
+    return DATE_INVALID;
+  }
+  *piYear = 1900 + 100 * (iDigits >> 24) + 10 * ((iDigits >> 20) & 0x0F) + ((iDigits >> 16) & 0x0F);
+  *piMonth = 10 * ((iDigits >> 12) & 0x0F) + ((iDigits >> 8) & 0x0F);
+  *piDay = 10 * ((iDigits >> 4) & 0x0F) + (iDigits & 0x0F);
+  return CheckDate(*piYear, *piMonth, *piDay);
+}
+
+//a valid date as YYYY-MM-DD
+static inline void WriteDate(char *pDest, int iYear, int iMonth, int iDay)
+{
+  memcpy(pDest, &DigitPairs[2 * (iYear / 100)], 2);
+  memcpy(&pDest[2], &DigitPairs[2 * (iYear % 100)], 2);
+  pDest[4] = '-';
+  memcpy(&pDest[5], &DigitPairs[2 * iMonth], 2);
+  pDest[7] = '-';
+  memcpy(&pDest[8], &DigitPairs[2 * iDay], 2);
+}
+
+//map a regular input file as a whole, pipes and other non-mappable inputs are read with fread()
+int MapInputFile(CONVERTER *cv)
+{
+
+  struct stat st;
+  void *pMap;
+
+  if (fstat(fileno(cv->fpInFile), &st) != 0 || !S_ISREG(st.st_mode) || st.st_size < cv->iInputRecordLength) {
+    fprintf(stdout, "%s %s [INFO]: Input file is not mappable, reading records sequentially.\n", GetDateTime(), sUUID);
+    return -1;
+  }
+  if ((pMap = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(cv->fpInFile), 0)) == MAP_FAILED) {
+    fprintf(stdout, "%s %s [INFO]: Unable to map input file, reading records sequentially.\n", GetDateTime(), sUUID);
+    return -1;
+  }
+  //hints only, the conversion works without them
+  madvise(pMap, st.st_size, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+  madvise(pMap, st.st_size, MADV_HUGEPAGE);
+#endif
+  cv->pInputMap = (unsigned char *) pMap;
+  cv->lInputMapSize = st.st_size;
+  cv->lInputOffset = 0;
+  fprintf(stdout, "%s %s [INFO]: Input file mapped: %ld bytes\n", GetDateTime(), sUUID, (long) st.st_size);
+  return 0;
+}
+
+//detect compressed input by its magic bytes and start the thread that decompresses it,
+//returns -1 if the input is read directly (mapped or with fread())
+int OpenInputStream(CONVERTER *cv)
+{
+
+  int i;
+  struct stat st;
+  INPUTSTREAM *is;
+  unsigned char sMagic[4];
+  size_t lMagicLength;
+  int iCodec = INPUT_PLAIN;
+  const char *sCodec = "plain";
+
+  lMagicLength = fread(sMagic, 1, sizeof(sMagic), cv->fpInFile);
+  //gzip: ID1, ID2 and CM 8 (deflate), the only method defined
+  if (lMagicLength >= 3 && sMagic[0] == 0x1F && sMagic[1] == 0x8B && sMagic[2] == 0x08) {
+    iCodec = INPUT_GZIP;
+    sCodec = "gzip";
+  }
+  //zstd is detected without zstd support too, the input thread then fails the file
+  else if (lMagicLength == 4 && sMagic[0] == 0x28 && sMagic[1] == 0xB5 && sMagic[2] == 0x2F && sMagic[3] == 0xFD) {
+    iCodec = INPUT_ZSTD;
+    sCodec = "zstd";
+  }
+  //uncompressed regular files are read directly, a pipe can't be rewound and is read by the thread
+  if (iCodec == INPUT_PLAIN && fstat(fileno(cv->fpInFile), &st) == 0 && S_ISREG(st.st_mode) && fseek(cv->fpInFile, 0, SEEK_SET) == 0) {
+    return -1;
+  }
+
+  if ((is = (INPUTSTREAM *) calloc(1, sizeof(INPUTSTREAM))) == NULL) {
+    fprintf(stdout, "%s %s [ERROR]: Can't allocate input stream.\n", GetDateTime(), sUUID);
+    exit(-1);
+  }
+  is->iCodec = iCodec;
+  is->fpInFile = cv->fpInFile;
+  memcpy(is->sMagic, sMagic, lMagicLength);
+  is->lMagicLength = lMagicLength;
+  is->lCapacity = (size_t) ((CHUNK_SIZE / cv->iInputRecordLength) + 1) * cv->iInputRecordLength;
+  for (i = 0; i < INPUT_BUFFERS; i++) {
+    if ((is->pBuffers[i] = (unsigned char *) malloc(is->lCapacity)) == NULL) {
+      fprintf(stdout, "%s %s [ERROR]: Can't allocate input buffers.\n", GetDateTime(), sUUID);
+      exit(-1);
+    }
+  }
+  pthread_mutex_init(&is->mutex, NULL);
+  pthread_cond_init(&is->cond, NULL);
+  if (pthread_create(&is->Thread, NULL, InputStreamReader, is) != 0) {
+    fprintf(stdout, "%s %s [ERROR]: Can't create input thread.\n", GetDateTime(), sUUID);
+    exit(-1);
+  }
+  cv->pInputStream = is;
+  fprintf(stdout, "%s %s [INFO]: Input stream: %s\n", GetDateTime(), sUUID, sCodec);
+  return 0;
+}
+
+//the raw input of the thread, starting with the bytes read for the codec detection
+static size_t ReadInputStream(INPUTSTREAM *is, unsigned char *pBuffer, size_t lLength)
+{
+
+  size_t lRead = 0;
+
+  if (is->lMagicLength > 0) {
+    lRead = (lLength < is->lMagicLength) ? lLength : is->lMagicLength;
+    memcpy(pBuffer, is->sMagic, lRead);
+    memmove(is->sMagic, &is->sMagic[lRead], is->lMagicLength - lRead);
+    is->lMagicLength -= lRead;
+  }
+  lRead += fread(&pBuffer[lRead], 1, lLength - lRead, is->fpInFile);
+  if (lRead == 0 && ferror(is->fpInFile)) {
+    fprintf(stdout, "%s %s [ERROR]: Unable to read input file.\n", GetDateTime(), sUUID);
+    is->iFailed = 1;
+  }
+  return lRead;
+}
+
+//hand the filled buffer to the converter and wait for the next free one
+static unsigned char *NextInputBuffer(INPUTSTREAM *is, size_t lLength)
+{
+
+  unsigned char *pBuffer;
+
+  pthread_mutex_lock(&is->mutex);
+  is->lLengths[is->lNextToFill % INPUT_BUFFERS] = lLength;
+  is->lNextToFill++;
+  pthread_cond_broadcast(&is->cond);
+  while (is->lNextToFill - is->lNextToRead >= INPUT_BUFFERS) {
+    pthread_cond_wait(&is->cond, &is->mutex);
+  }
+  pBuffer = is->pBuffers[is->lNextToFill % INPUT_BUFFERS];
+  pthread_mutex_unlock(&is->mutex);
+  return pBuffer;
+}
+
+//input thread: fills the ring buffers with the decompressed input
+void *InputStreamReader(void *pArg)
+{
+
+  INPUTSTREAM *is = (INPUTSTREAM *) pArg;
+  unsigned char *pIn = NULL;
+  unsigned char *pOut = is->pBuffers[0];
+  size_t lFill = 0;
+  size_t lRead;
+  int iComplete = 1;             //compressed input ended at the end of a gzip member or zstd frame
+  z_stream zs;
+#ifdef HAVE_ZSTD
+  ZSTD_DStream *zds = NULL;
+  ZSTD_inBuffer zin;
+  ZSTD_outBuffer zout;
+  size_t lResult;
+#endif
+
+  if (is->iCodec != INPUT_PLAIN && (pIn = (unsigned char *) malloc(INPUT_READ_SIZE)) == NULL) {
+    fprintf(stdout, "%s %s [ERROR]: Can't allocate decompression buffer.\n", GetDateTime(), sUUID);
+    exit(-1);
+  }
+  switch (is->iCodec) {
+    case INPUT_PLAIN:
+      while ((lRead = ReadInputStream(is, &pOut[lFill], is->lCapacity - lFill)) > 0) {
+        lFill += lRead;
+        if (lFill == is->lCapacity) {
+          pOut = NextInputBuffer(is, lFill);
+          lFill = 0;
+        }
+      }
+      break;
+    case INPUT_GZIP:
+      memset(&zs, 0, sizeof(zs));
+      //32: detect the gzip header, concatenated gzip members are decompressed one after the other
+      if (inflateInit2(&zs, 15 + 32) != Z_OK) {
+        fprintf(stdout, "%s %s [ERROR]: Can't initialize gzip decompression.\n", GetDateTime(), sUUID);
+        exit(-1);
+      }
+      for (;;) {
+        if (zs.avail_in == 0) {
+          if ((lRead = ReadInputStream(is, pIn, INPUT_READ_SIZE)) == 0) {
+            break;
+          }
+          zs.next_in = pIn;
+          zs.avail_in = lRead;
+        }
+        zs.next_out = &pOut[lFill];
+        zs.avail_out = is->lCapacity - lFill;
+        switch (inflate(&zs, Z_NO_FLUSH)) {
+          case Z_STREAM_END:
+            inflateReset(&zs);
+            iComplete = 1;
+            break;
+          case Z_OK:
+          case Z_BUF_ERROR:
+            iComplete = 0;
+            break;
+          default:
+            fprintf(stdout, "%s %s [ERROR]: Corrupt gzip input: %s\n", GetDateTime(), sUUID, zs.msg != NULL ? zs.msg : "unknown error");
+            is->iFailed = 1;
+            break;
+        }
+        if (is->iFailed) {
+          break;
+        }
+        lFill = is->lCapacity - zs.avail_out;
+        if (lFill == is->lCapacity) {
+          pOut = NextInputBuffer(is, lFill);
+          lFill = 0;
+        }
+      }
+      inflateEnd(&zs);
+      break;
+#ifdef HAVE_ZSTD
+    case INPUT_ZSTD:
+      if ((zds = ZSTD_createDStream()) == NULL) {
+        fprintf(stdout, "%s %s [ERROR]: Can't initialize zstd decompression.\n", GetDateTime(), sUUID);
+        exit(-1);
+      }
+      //frames following each other are decompressed as one stream
+      zin.src = pIn;
+      zin.size = zin.pos = 0;
+      for (;;) {
+        if (zin.pos == zin.size) {
+          if ((lRead = ReadInputStream(is, pIn, INPUT_READ_SIZE)) == 0) {
+            break;
+          }
+          zin.size = lRead;
+          zin.pos = 0;
+        }
+        zout.dst = pOut;
+        zout.size = is->lCapacity;
+        zout.pos = lFill;
+        lResult = ZSTD_decompressStream(zds, &zout, &zin);
+        if (ZSTD_isError(lResult)) {
+          fprintf(stdout, "%s %s [ERROR]: Corrupt zstd input: %s\n", GetDateTime(), sUUID, ZSTD_getErrorName(lResult));
+          is->iFailed = 1;
+          break;
+        }
+        iComplete = (lResult == 0);
+        lFill = zout.pos;
+        if (lFill == is->lCapacity) {
+          pOut = NextInputBuffer(is, lFill);
+          lFill = 0;
+        }
+      }
+      ZSTD_freeDStream(zds);
+      break;
+#else
+    case INPUT_ZSTD:
+      fprintf(stdout, "%s %s [ERROR]: Input file is zstd compressed, but e2a was built without zstd support (-DHAVE_ZSTD).\n", GetDateTime(), sUUID);
+      is->iFailed = 1;
+      break;
+#endif
+  }
+  if (!iComplete && !is->iFailed) {
+    fprintf(stdout, "%s %s [ERROR]: Compressed input file is truncated.\n", GetDateTime(), sUUID);
+    is->iFailed = 1;
+  }
+  free(pIn);
+
+  //the last buffer, a partial record at its end is ignored like a short fread()
+  pthread_mutex_lock(&is->mutex);
+  is->lLengths[is->lNextToFill % INPUT_BUFFERS] = lFill;
+  is->lNextToFill++;
+  is->iEndOfInput = 1;
+  pthread_cond_broadcast(&is->cond);
+  pthread_mutex_unlock(&is->mutex);
+  return NULL;
+}
+
+//copy up to iMaxRecords complete records out of the ring buffers, the lock is only taken to switch buffers
+static int ReadStreamRecords(INPUTSTREAM *is, unsigned char *pBuffer, int iMaxRecords, int iRecordLength)
+{
+
+  int iRecords = 0;
+  int iAvailable;
+  int iBuffer;
+  double dWait;
+
+  while (iRecords < iMaxRecords) {
+    if (is->lNextToRead == is->lNextToFill) {
+      dWait = MonotonicSeconds();
+      pthread_mutex_lock(&is->mutex);
+      while (is->lNextToRead == is->lNextToFill && !is->iEndOfInput) {
+        pthread_cond_wait(&is->cond, &is->mutex);
+      }
+      pthread_mutex_unlock(&is->mutex);
+      __atomic_fetch_add(&Metrics.lInputWaitNanos, (long) ((MonotonicSeconds() - dWait) * 1e9), __ATOMIC_RELAXED);
+      if (is->lNextToRead == is->lNextToFill) {
+        break;
+      }
+    }
+    iBuffer = is->lNextToRead % INPUT_BUFFERS;
+    iAvailable = (is->lLengths[iBuffer] - is->lReadOffset) / iRecordLength;
+    if (iAvailable > iMaxRecords - iRecords) {
+      iAvailable = iMaxRecords - iRecords;
+    }
+    memcpy(&pBuffer[(size_t) iRecords * iRecordLength], &is->pBuffers[iBuffer][is->lReadOffset], (size_t) iAvailable * iRecordLength);
+    iRecords += iAvailable;
+    is->lReadOffset += (size_t) iAvailable * iRecordLength;
+    //buffer done, give it back to the thread
+    if (is->lReadOffset + iRecordLength > is->lLengths[iBuffer]) {
+      pthread_mutex_lock(&is->mutex);
+      is->lNextToRead++;
+      is->lReadOffset = 0;
+      pthread_cond_broadcast(&is->cond);
+      pthread_mutex_unlock(&is->mutex);
+    }
+  }
+  return iRecords;
+}
+
+//wait for the input thread and release its buffers, returns -1 if the input could not be read to its end
+int CloseInputStream(CONVERTER *cv)
+{
+
+  int i;
+  int iFailed;
+  INPUTSTREAM *is = cv->pInputStream;
+
+  pthread_join(is->Thread, NULL);
+  pthread_cond_destroy(&is->cond);
+  pthread_mutex_destroy(&is->mutex);
+  for (i = 0; i < INPUT_BUFFERS; i++) {
+    free(is->pBuffers[i]);
+  }
+  iFailed = is->iFailed;
+  free(is);
+  cv->pInputStream = NULL;
+  return iFailed ? -1 : 0;
+}
+
+//variable length records are read into fixed length slots of the record length of the metadata, so that they are
+//converted like fixed length records: the bytes a short record lacks are filled by the datatype of their field,
+//blanks for text and dates, zero for packed and zoned fields, a decimal field cut in its middle gets no sign
+//and is rejected as undecodable
+int PrepareVariableRecords(CONVERTER *cv)
+{
+
+  int i;
+  int j;
+  const METADATARECORD *pField;
+
+  if ((cv->pPadRecord = (unsigned char *) malloc(cv->iInputRecordLength)) == NULL
+      || (cv->PadFieldEnds = (int *) calloc(cv->iInputRecordLength + 1, sizeof(int))) == NULL) {
+    fprintf(stdout, "%s %s [ERROR]: Can't allocate record fill.\n", GetDateTime(), sUUID);
+    exit(-1);
+  }
+  memset(cv->pPadRecord, 0x40, cv->iInputRecordLength);
+  for (i = 0; i < cv->iNumberOfAttributes; i++) {
+    pField = cv->Metadata[i];
+    //binary integers and floats are zero, cut in their middle they are filled with zero bytes, packed dates are no date
+    if (pField->cDatatype == 'B' || pField->cDatatype == 'F' || pField->cDatatype == 'H' || (pField->cDatatype == 'L' && IS_PACKED_DATE(pField))) {
+      memset(&cv->pPadRecord[pField->iInputPosition], 0x00, pField->iInputFieldLength);
+      continue;
+    }
+    if (pField->cDatatype != 'P' && pField->cDatatype != 'S') {
+      continue;
+    }
+    if (pField->cDatatype == 'P') {
+      memset(&cv->pPadRecord[pField->iInputPosition], 0x00, pField->iInputFieldLength);
+      cv->pPadRecord[pField->iInputPosition + pField->iInputFieldLength - 1] = 0x0C;
+    }
+    else {
+      memset(&cv->pPadRecord[pField->iInputPosition], 0xF0, pField->iInputFieldLength);
+    }
+    for (j = pField->iInputPosition + 1; j < pField->iInputPosition + pField->iInputFieldLength; j++) {
+      cv->PadFieldEnds[j] = pField->iInputPosition + pField->iInputFieldLength;
+    }
+  }
+  cv->lNextRecord = 0;
+  cv->lBlockRemaining = 0;
+  cv->lShortRecords = 0;
+  cv->lLongRecords = 0;
+  return 0;
+}
+
+//length in a block descriptor word, the extended form (high bit set) holds 31 bits
+static inline size_t BlockLength(const unsigned char *pBDW)
+{
+  if (pBDW[0] & 0x80) {
+    return ((size_t) (pBDW[0] & 0x7F) << 24) | ((size_t) pBDW[1] << 16) | ((size_t) pBDW[2] << 8) | pBDW[3];
+  }
+  return ((size_t) pBDW[0] << 8) | pBDW[1];
+}
+
+//fill the rest of the slot of a record of lLength bytes
+static inline void PadRecord(CONVERTER *cv, unsigned char *pSlot, size_t lLength)
+{
+
+  int iEnd;
+
+  if (lLength < (size_t) cv->iInputRecordLength) {
+    memcpy(&pSlot[lLength], &cv->pPadRecord[lLength], cv->iInputRecordLength - lLength);
+    if ((iEnd = cv->PadFieldEnds[lLength]) > 0) {
+      memset(&pSlot[lLength], 0x00, iEnd - lLength);
+    }
+    //records of a copybook with DEPENDING ON end after the occurrences they hold
+    if (cv->iOccursMax == 0 || lLength < (size_t) cv->iOccursPosition) {
+      __atomic_fetch_add(&cv->lShortRecords, 1, __ATOMIC_RELAXED);
+    }
+  }
+  else if (lLength > (size_t) cv->iInputRecordLength) {
+    __atomic_fetch_add(&cv->lLongRecords, 1, __ATOMIC_RELAXED);
+  }
+}
+
+//boundary scan of a mapped input of variable length records: one pass from descriptor word to descriptor word records
+//where every record starts, so that records can be gathered by any thread, the data itself is not touched,
+//an invalid descriptor word leaves the index empty and aborts the file
+int IndexVariableRecords(CONVERTER *cv)
+{
+
+  const unsigned char *pMap = cv->pInputMap;
+  size_t lSize = cv->lInputMapSize;
+  size_t lOffset = 0;
+  size_t lBlockEnd;
+  size_t lLength;
+  long lCapacity = 0;
+  int iBlocked = (cv->iRecordFormat == RECFM_VB || cv->iRecordFormat == RECFM_VBS);
+  int iSpanned = (cv->iRecordFormat == RECFM_VS || cv->iRecordFormat == RECFM_VBS);
+  int iSegment;
+  int iInRecord = 0;             //a spanned record is started and not ended yet
+  const char *sError = NULL;
+  double dStart = MonotonicSeconds();
+
+  cv->lIndexedRecords = 0;
+  lBlockEnd = iBlocked ? 0 : lSize;
+  while (lOffset < lSize) {
+    //a block starts with its BDW, its length includes the BDW
+    if (iBlocked && lOffset == lBlockEnd) {
+      if (lSize - lOffset < DESCRIPTOR_WORD_LENGTH || (lLength = BlockLength(&pMap[lOffset])) < DESCRIPTOR_WORD_LENGTH || lLength > lSize - lOffset) {
+        sError = "invalid block descriptor word";
+        break;
+      }
+      lBlockEnd = lOffset + lLength;
+      lOffset += DESCRIPTOR_WORD_LENGTH;
+      continue;
+    }
+    //a record or segment starts with its RDW, its length includes the RDW
+    if (lBlockEnd - lOffset < DESCRIPTOR_WORD_LENGTH || (lLength = ((size_t) pMap[lOffset] << 8) | pMap[lOffset + 1]) < DESCRIPTOR_WORD_LENGTH
+        || lLength > lBlockEnd - lOffset) {
+      sError = "invalid record descriptor word";
+      break;
+    }
+    iSegment = iSpanned ? (pMap[lOffset + 2] & 0x03) : SEGMENT_COMPLETE;
+    if ((iSegment == SEGMENT_COMPLETE || iSegment == SEGMENT_FIRST) == iInRecord) {
+      sError = "segment of a spanned record out of order";
+      break;
+    }
+    if (!iInRecord) {
+      if (cv->lIndexedRecords == lCapacity) {
+        lCapacity = (lCapacity == 0) ? RECORD_INDEX_RECORDS : 2 * lCapacity;
+        if ((cv->RecordIndex = (size_t *) realloc(cv->RecordIndex, lCapacity * sizeof(size_t))) == NULL) {
+          fprintf(stdout, "%s %s [ERROR]: Can't allocate record index.\n", GetDateTime(), sUUID);
+          exit(-1);
+        }
+      }
+      cv->RecordIndex[cv->lIndexedRecords++] = lOffset;
+    }
+    iInRecord = (iSegment == SEGMENT_FIRST || iSegment == SEGMENT_MIDDLE);
+    lOffset += lLength;
+    //a record is only split where its block is full, it goes on in the next block
+    if (iInRecord && iBlocked && lOffset != lBlockEnd) {
+      sError = "segment of a spanned record doesn't end its block";
+      break;
+    }
+  }
+  if (sError == NULL && iInRecord) {
+    sError = "input ends inside a spanned record";
+  }
+  if (sError != NULL) {
+    fprintf(stdout, "%s %s [ERROR]: Input file %s: %s at offset %lu after record %ld\n", GetDateTime(), sUUID, cv->sInputFileName, sError,
+            (unsigned long) lOffset, cv->lIndexedRecords - iInRecord);
+    cv->lIndexedRecords = 0;
+    cv->iAbort = 1;
+    return -1;
+  }
+  fprintf(stdout, "%s %s [INFO]: Record index: %ld variable length records in %.3f s\n", GetDateTime(), sUUID, cv->lIndexedRecords, MonotonicSeconds() - dStart);
+  return 0;
+}
+
+//copy a record of a mapped input out of the mapping into its slot, the segments of a spanned record one after the other,
+//the index guarantees valid descriptor words, a segment that isn't the last one is followed by the BDW of the next block
+static void GatherRecord(CONVERTER *cv, size_t lOffset, unsigned char *pSlot)
+{
+
+  const unsigned char *pMap = cv->pInputMap;
+  int iBlocked = (cv->iRecordFormat == RECFM_VB || cv->iRecordFormat == RECFM_VBS);
+  int iSpanned = (cv->iRecordFormat == RECFM_VS || cv->iRecordFormat == RECFM_VBS);
+  int iSegment;
+  size_t lLength;
+  size_t lCopy;
+  size_t lFill = 0;
+  size_t lRecordLength = 0;
+
+  for (;;) {
+    lLength = (((size_t) pMap[lOffset] << 8) | pMap[lOffset + 1]) - DESCRIPTOR_WORD_LENGTH;
+    iSegment = iSpanned ? (pMap[lOffset + 2] & 0x03) : SEGMENT_COMPLETE;
+    lCopy = (lLength < cv->iInputRecordLength - lFill) ? lLength : cv->iInputRecordLength - lFill;
+    memcpy(&pSlot[lFill], &pMap[lOffset + DESCRIPTOR_WORD_LENGTH], lCopy);
+    lFill += lCopy;
+    lRecordLength += lLength;
+    if (iSegment == SEGMENT_COMPLETE || iSegment == SEGMENT_LAST) {
+      break;
+    }
+    lOffset += DESCRIPTOR_WORD_LENGTH + lLength + (iBlocked ? DESCRIPTOR_WORD_LENGTH : 0);
+  }
+  PadRecord(cv, pSlot, lRecordLength);
+}
+
+//gather iRecords indexed records starting with record lFirst into consecutive slots
+static void GatherRecords(CONVERTER *cv, long lFirst, int iRecords, unsigned char *pBuffer)
+{
+
+  int i;
+
+  for (i = 0; i < iRecords; i++) {
+    GatherRecord(cv, cv->RecordIndex[lFirst + i], &pBuffer[(size_t) i * cv->iInputRecordLength]);
+  }
+}
+
+//input offset an indexed record ends at, after the data of its last segment
+static off_t IndexedRecordEnd(CONVERTER *cv, long lRecord)
+{
+
+  const unsigned char *pMap = cv->pInputMap;
+  int iBlocked = (cv->iRecordFormat == RECFM_VB || cv->iRecordFormat == RECFM_VBS);
+  int iSpanned = (cv->iRecordFormat == RECFM_VS || cv->iRecordFormat == RECFM_VBS);
+  int iSegment;
+  size_t lOffset = cv->RecordIndex[lRecord];
+  size_t lLength;
+
+  for (;;) {
+    lLength = ((size_t) pMap[lOffset] << 8) | pMap[lOffset + 1];
+    iSegment = iSpanned ? (pMap[lOffset + 2] & 0x03) : SEGMENT_COMPLETE;
+    if (iSegment == SEGMENT_COMPLETE || iSegment == SEGMENT_LAST) {
+      return (off_t) (lOffset + lLength);
+    }
+    lOffset += lLength + (iBlocked ? DESCRIPTOR_WORD_LENGTH : 0);
+  }
+}
+
+//lLength bytes of the input, from the input thread or the file, fewer at its end
+static size_t ReadInputBytes(CONVERTER *cv, unsigned char *pBuffer, size_t lLength)
+{
+
+  size_t lRead;
+
+  if (cv->pInputStream != NULL) {
+    lRead = ReadStreamRecords(cv->pInputStream, pBuffer, (int) lLength, 1);
+  }
+  else {
+    lRead = fread(pBuffer, 1, lLength, cv->fpInFile);
+  }
+  cv->lInputPosition += lRead;
+  return lRead;
+}
+
+//read the next variable length record of a pipe, compressed or not mapped input into its slot, the descriptor words
+//are checked as they come, returns -1 at the end of the input or at an invalid descriptor word, which aborts the file
+static int ReadVariableRecord(CONVERTER *cv, unsigned char *pSlot)
+{
+
+  unsigned char sWord[DESCRIPTOR_WORD_LENGTH];
+  unsigned char sSkip[256];
+  int iBlocked = (cv->iRecordFormat == RECFM_VB || cv->iRecordFormat == RECFM_VBS);
+  int iSpanned = (cv->iRecordFormat == RECFM_VS || cv->iRecordFormat == RECFM_VBS);
+  int iSegment;
+  int iInRecord = 0;
+  size_t lRead;
+  size_t lLength;
+  size_t lPart;
+  size_t lFill = 0;
+  size_t lRecordLength = 0;
+  const char *sError = NULL;
+
+  for (;;) {
+    //a block starts with its BDW, the input may only end in front of one
+    if (iBlocked && cv->lBlockRemaining == 0) {
+      if ((lRead = ReadInputBytes(cv, sWord, DESCRIPTOR_WORD_LENGTH)) == 0 && !iInRecord) {
+        return -1;
+      }
+      if (lRead < DESCRIPTOR_WORD_LENGTH || (lLength = BlockLength(sWord)) < DESCRIPTOR_WORD_LENGTH) {
+        sError = "invalid block descriptor word";
+        break;
+      }
+      cv->lBlockRemaining = lLength - DESCRIPTOR_WORD_LENGTH;
+      continue;
+    }
+    if ((lRead = ReadInputBytes(cv, sWord, DESCRIPTOR_WORD_LENGTH)) == 0 && !iInRecord && !iBlocked) {
+      return -1;
+    }
+    if (lRead < DESCRIPTOR_WORD_LENGTH || (lLength = ((size_t) sWord[0] << 8) | sWord[1]) < DESCRIPTOR_WORD_LENGTH
+        || (iBlocked && lLength > (size_t) cv->lBlockRemaining)) {
+      sError = "invalid record descriptor word";
+      break;
+    }
+    iSegment = iSpanned ? (sWord[2] & 0x03) : SEGMENT_COMPLETE;
+    if ((iSegment == SEGMENT_COMPLETE || iSegment == SEGMENT_FIRST) == iInRecord) {
+      sError = "segment of a spanned record out of order";
+      break;
+    }
+    if (iBlocked) {
+      cv->lBlockRemaining -= lLength;
+    }
+    //data beyond the record length of the metadata is read and dropped
+    lLength -= DESCRIPTOR_WORD_LENGTH;
+    lRecordLength += lLength;
+    lPart = (lLength < cv->iInputRecordLength - lFill) ? lLength : cv->iInputRecordLength - lFill;
+    if (ReadInputBytes(cv, &pSlot[lFill], lPart) < lPart) {
+      sError = "input ends inside a record";
+      break;
+    }
+    lFill += lPart;
+    for (lLength -= lPart; lLength > 0; lLength -= lPart) {
+      lPart = (lLength < sizeof(sSkip)) ? lLength : sizeof(sSkip);
+      if (ReadInputBytes(cv, sSkip, lPart) < lPart) {
+        sError = "input ends inside a record";
+        break;
+      }
+    }
+    if (sError != NULL) {
+      break;
+    }
+    if (iSegment == SEGMENT_COMPLETE || iSegment == SEGMENT_LAST) {
+      PadRecord(cv, pSlot, lRecordLength);
+      cv->lNextRecord++;
+      return 0;
+    }
+    iInRecord = 1;
+  }
+  fprintf(stdout, "%s %s [ERROR]: Input file %s: %s after record %ld\n", GetDateTime(), sUUID, cv->sInputFileName, sError, cv->lNextRecord);
+  cv->iAbort = 1;
+  return -1;
+}
+
+//returns up to iMaxRecords complete records and their number in piRecords, NULL at the end of the input
+//records are either taken from the mapping or read into pBuffer, variable length records are always read into pBuffer
+const unsigned char *ReadRecords(CONVERTER *cv, unsigned char *pBuffer, int iMaxRecords, int *piRecords)
+{
+
+  int i;
+  size_t lAvailable;
+  const unsigned char *pRecords;
+
+  if (cv->iRecordFormat != RECFM_F) {
+    for (i = 0; i < iMaxRecords; i++) {
+      if (cv->pInputMap != NULL) {
+        if (cv->lNextRecord == cv->lIndexedRecords) {
+          break;
+        }
+        GatherRecord(cv, cv->RecordIndex[cv->lNextRecord++], &pBuffer[(size_t) i * cv->iInputRecordLength]);
+      }
+      else if (ReadVariableRecord(cv, &pBuffer[(size_t) i * cv->iInputRecordLength]) != 0) {
+        break;
+      }
+    }
+    *piRecords = i;
+    pRecords = pBuffer;
+    //records read sequentially are counted by ReadInputBytes()
+    if (cv->pInputMap != NULL && i > 0) {
+      cv->lInputPosition = IndexedRecordEnd(cv, cv->lNextRecord - 1);
+    }
+    return (*piRecords > 0) ? pRecords : NULL;
+  }
+  else if (cv->pInputMap != NULL) {
+    lAvailable = (cv->lInputMapSize - cv->lInputOffset) / cv->iInputRecordLength;
+    *piRecords = (lAvailable < iMaxRecords) ? (int) lAvailable : iMaxRecords;
+    pRecords = &cv->pInputMap[cv->lInputOffset];
+    cv->lInputOffset += (size_t) *piRecords * cv->iInputRecordLength;
+  }
+  else if (cv->pInputStream != NULL) {
+    *piRecords = ReadStreamRecords(cv->pInputStream, pBuffer, iMaxRecords, cv->iInputRecordLength);
+    pRecords = pBuffer;
+  }
+  else {
+    *piRecords = fread(pBuffer, cv->iInputRecordLength, iMaxRecords, cv->fpInFile);
+    pRecords = pBuffer;
+  }
+  cv->lInputPosition += (off_t) *piRecords * cv->iInputRecordLength;
+  return (*piRecords > 0) ? pRecords : NULL;
+}
+
+//open the output file, with O_DIRECT if requested and supported by the file system
+//a resumed output file is cut back to its length at the checkpoint instead of being truncated
+int OpenOutputFile(CONVERTER *cv)
+{
+
+  int fd = -1;
+  int iFlags = O_WRONLY | O_CREAT | ((cv->lResumeRecords > 0) ? 0 : O_TRUNC);
+  struct stat st;
+
+  //O_DIRECT writes need an aligned file offset to start from
+  if (cv->iDirectOutput && cv->lResumeOffset % OUTPUT_ALIGNMENT == 0) {
+    if ((fd = open(cv->sOutputFileName, iFlags | O_DIRECT, 0666)) < 0) {
+      if (errno != EINVAL) {
+        return -1;
+      }
+      fprintf(stdout, "%s %s [WARNING]: O_DIRECT not supported for %s, writing through the page cache.\n", GetDateTime(), sUUID, cv->sOutputFileName);
+    }
+  }
+  cv->Output.iDirect = (fd >= 0);
+  if (fd < 0 && (fd = open(cv->sOutputFileName, iFlags, 0666)) < 0) {
+    return -1;
+  }
+  cv->Output.fd = fd;
+  if (cv->lResumeRecords > 0) {
+    if (fstat(fd, &st) != 0 || st.st_size < cv->lResumeOffset || ftruncate(fd, cv->lResumeOffset) != 0) {
+      fprintf(stdout, "%s %s [ERROR]: Output file %s is shorter than its checkpoint.\n", GetDateTime(), sUUID, cv->sOutputFileName);
+      close(fd);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+//read the checkpoint of the output file, without one the conversion starts from the beginning
+int LoadCheckpoint(CONVERTER *cv)
+{
+
+  FILE *fp;
+  int iRecordLength;
+  long lInputOffset;
+  long lOutputOffset;
+
+  cv->lResumeRecords = 0;
+  cv->lResumeOffset = 0;
+  cv->lResumeInput = 0;
+  if ((fp = fopen(cv->sCheckpointFileName, "r")) == NULL) {
+    fprintf(stdout, "%s %s [INFO]: No checkpoint for %s, converting from the start.\n", GetDateTime(), sUUID, cv->sOutputFileName);
+    return 0;
+  }
+  if (fscanf(fp, "records=%ld rejected=%ld record_length=%d input_offset=%ld output_offset=%ld",
+             &cv->lResumeRecords, &cv->lRejected, &iRecordLength, &lInputOffset, &lOutputOffset) != 5
+      || cv->lResumeRecords < 1 || lInputOffset < cv->lResumeRecords || lOutputOffset < 1) {
+    fprintf(stdout, "%s %s [ERROR]: Invalid checkpoint file: %s\n", GetDateTime(), sUUID, cv->sCheckpointFileName);
+    fclose(fp);
+    cv->lResumeRecords = 0;
+    return -1;
+  }
+  fclose(fp);
+  cv->lResumeOffset = lOutputOffset;
+  cv->lResumeInput = lInputOffset;
+  fprintf(stdout, "%s %s [INFO]: Resuming after record %ld at output offset %ld\n", GetDateTime(), sUUID, cv->lResumeRecords, lOutputOffset);
+  return iRecordLength;
+}
+
+//continue the input after the records converted before the checkpoint, the input offset they end at
+//must be the one of the checkpoint, else the input is not the one converted before
+static int SkipInputRecords(CONVERTER *cv, long lRecords)
+{
+
+  int iRecords;
+  struct stat st;
+  off_t lOffset = (off_t) lRecords * cv->iInputRecordLength;
+
+  if (cv->pInputMap != NULL && cv->iRecordFormat != RECFM_F) {
+    if (lRecords > cv->lIndexedRecords) {
+      return -1;
+    }
+    cv->lNextRecord = lRecords;
+    cv->lInputPosition = IndexedRecordEnd(cv, lRecords - 1);
+  }
+  else if (cv->pInputMap != NULL) {
+    if (lOffset > cv->lInputMapSize) {
+      return -1;
+    }
+    cv->lInputOffset = lOffset;
+    cv->lInputPosition = lOffset;
+  }
+  else if (cv->pInputStream != NULL || cv->iRecordFormat != RECFM_F) {
+    //compressed input and variable length records can't be positioned, the records are read and dropped
+    while (lRecords > 0 && ReadRecords(cv, cv->pReadBuffer, 1, &iRecords) != NULL) {
+      lRecords--;
+    }
+    if (lRecords > 0) {
+      return -1;
+    }
+  }
+  else if (fstat(fileno(cv->fpInFile), &st) != 0 || st.st_size < lOffset || fseeko(cv->fpInFile, lOffset, SEEK_SET) != 0) {
+    return -1;
+  }
+  else {
+    cv->lInputPosition = lOffset;
+  }
+  return 0;
+}
+
+//write lLength bytes at lOffset, pwrite() may write less than requested
+static void WriteBlock(OUTPUTWRITER *ow, const unsigned char *pBlock, size_t lLength, off_t lOffset)
+{
+
+  ssize_t lWritten;
+
+  while (lLength > 0 && !ow->iFailed) {
+    if ((lWritten = pwrite(ow->fd, pBlock, lLength, lOffset)) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      fprintf(stdout, "%s %s [ERROR]: Unable to write output file: %s\n", GetDateTime(), sUUID, strerror(errno));
+      ow->iFailed = 1;
+      return;
+    }
+    if (ow->iChecksum) {
+      ow->lCrc = crc32(ow->lCrc, pBlock, lWritten);
+    }
+    pBlock += lWritten;
+    lLength -= lWritten;
+    lOffset += lWritten;
+    __atomic_fetch_add(&Metrics.lOutputBytes, lWritten, __ATOMIC_RELAXED);
+  }
+}
+
+//the output written so far is synced before the checkpoint says so, the checkpoint file itself
+//is written to a temporary file renamed over the previous one
+static void WriteCheckpoint(OUTPUTWRITER *ow, const OUTPUTBLOCK *pBlock)
+{
+
+  char sTempName[PATH_MAX];
+  FILE *fp;
+
+  //a checkpoint must not point behind output that was lost
+  if (ow->iFailed) {
+    return;
+  }
+  if (fdatasync(ow->fd) != 0) {
+    fprintf(stdout, "%s %s [ERROR]: Unable to sync output file: %s\n", GetDateTime(), sUUID, strerror(errno));
+    ow->iFailed = 1;
+    return;
+  }
+  if (snprintf(sTempName, sizeof(sTempName), "%s.tmp", ow->sCheckpointFileName) >= (int) sizeof(sTempName) || (fp = fopen(sTempName, "w")) == NULL) {
+    fprintf(stdout, "%s %s [ERROR]: Unable to write checkpoint file %s\n", GetDateTime(), sUUID, ow->sCheckpointFileName);
+    return;
+  }
+  fprintf(fp, "records=%ld\nrejected=%ld\nrecord_length=%d\ninput_offset=%ld\noutput_offset=%ld\n", pBlock->lCheckpointRecords, pBlock->lCheckpointRejected,
+          ow->iInputRecordLength, (long) pBlock->lCheckpointInput, (long) ow->lOffset);
+  if (fflush(fp) != 0 || fsync(fileno(fp)) != 0 || fclose(fp) != 0 || rename(sTempName, ow->sCheckpointFileName) != 0) {
+    fprintf(stdout, "%s %s [ERROR]: Unable to write checkpoint file %s\n", GetDateTime(), sUUID, ow->sCheckpointFileName);
+    return;
+  }
+  fprintf(stdout, "%s %s [INFO]: Checkpoint: %ld records, output offset %ld\n", GetDateTime(), sUUID, pBlock->lCheckpointRecords, (long) ow->lOffset);
+}
+
+//flush thread: writes the blocks in the order they were filled, compressed ones as soon as they are compressed
+void *OutputFlusher(void *pArg)
+{
+
+  OUTPUTWRITER *ow = (OUTPUTWRITER *) pArg;
+  OUTPUTBLOCK *pBlock;
+  int iReady = (ow->iCompression == COMPRESS_NONE) ? BLOCK_FILLED : BLOCK_COMPRESSED;
+  size_t lAligned;
+
+  pthread_mutex_lock(&ow->mutex);
+  for (;;) {
+    pBlock = &ow->Blocks[ow->lNextToFlush % ow->iNumberOfBlocks];
+    while (!(ow->lNextToFlush < ow->lNextToFill && pBlock->iState == iReady) && !(ow->iStop && ow->lNextToFlush == ow->lNextToFill)) {
+      pthread_cond_wait(&ow->cond, &ow->mutex);
+    }
+    if (ow->lNextToFlush == ow->lNextToFill) {
+      break;
+    }
+    pthread_mutex_unlock(&ow->mutex);
+
+    if (ow->iCompression != COMPRESS_NONE) {
+      WriteBlock(ow, pBlock->pCompressed, pBlock->lCompressedLength, ow->lOffset);
+      ow->lOffset += pBlock->lCompressedLength;
+    }
+    else {
+      //O_DIRECT writes whole alignment units only, the tail of the last block goes through the page cache
+      lAligned = 0;
+      if (ow->iDirect && pBlock->lLength % OUTPUT_ALIGNMENT != 0) {
+        lAligned = (pBlock->lLength / OUTPUT_ALIGNMENT) * OUTPUT_ALIGNMENT;
+        WriteBlock(ow, pBlock->pData, lAligned, ow->lOffset);
+        fcntl(ow->fd, F_SETFL, fcntl(ow->fd, F_GETFL) & ~O_DIRECT);
+      }
+      WriteBlock(ow, &pBlock->pData[lAligned], pBlock->lLength - lAligned, ow->lOffset + lAligned);
+      ow->lOffset += pBlock->lLength;
+    }
+    if (pBlock->lCheckpointRecords > 0) {
+      WriteCheckpoint(ow, pBlock);
+    }
+
+    pthread_mutex_lock(&ow->mutex);
+    pBlock->iState = BLOCK_FREE;
+    ow->lNextToFlush++;
+    pthread_cond_broadcast(&ow->cond);
+  }
+  pthread_mutex_unlock(&ow->mutex);
+  return NULL;
+}
+
+//compressor thread: every filled block becomes a gzip member or zstd frame of its own,
+//concatenated they are a valid gzip or zstd file
+void *OutputCompressor(void *pArg)
+{
+
+  OUTPUTWRITER *ow = (OUTPUTWRITER *) pArg;
+  OUTPUTBLOCK *pBlock;
+  z_stream zs;
+#ifdef HAVE_ZSTD
+  ZSTD_CCtx *cctx = NULL;
+#endif
+
+  if (ow->iCompression == COMPRESS_GZIP) {
+    memset(&zs, 0, sizeof(zs));
+    //16: gzip header and trailer instead of zlib ones
+    if (deflateInit2(&zs, COMPRESS_LEVEL_GZIP, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+      fprintf(stdout, "%s %s [ERROR]: Can't initialize gzip compression.\n", GetDateTime(), sUUID);
+      exit(-1);
+    }
+  }
+#ifdef HAVE_ZSTD
+  else if ((cctx = ZSTD_createCCtx()) == NULL) {
+    fprintf(stdout, "%s %s [ERROR]: Can't initialize zstd compression.\n", GetDateTime(), sUUID);
+    exit(-1);
+  }
+#endif
+
+  pthread_mutex_lock(&ow->mutex);
+  for (;;) {
+    while (ow->lNextToCompress == ow->lNextToFill && !ow->iStop) {
+      pthread_cond_wait(&ow->cond, &ow->mutex);
+    }
+    if (ow->lNextToCompress == ow->lNextToFill) {
+      break;
+    }
+    pBlock = &ow->Blocks[ow->lNextToCompress % ow->iNumberOfBlocks];
+    ow->lNextToCompress++;
+    pthread_mutex_unlock(&ow->mutex);
+
+    if (ow->iCompression == COMPRESS_GZIP) {
+      deflateReset(&zs);
+      zs.next_in = pBlock->pData;
+      zs.avail_in = pBlock->lLength;
+      zs.next_out = pBlock->pCompressed;
+      zs.avail_out = ow->lCompressedCapacity;
+      if (deflate(&zs, Z_FINISH) != Z_STREAM_END) {
+        fprintf(stdout, "%s %s [ERROR]: gzip compression of an output block failed.\n", GetDateTime(), sUUID);
+        exit(-1);
+      }
+      pBlock->lCompressedLength = ow->lCompressedCapacity - zs.avail_out;
+    }
+#ifdef HAVE_ZSTD
+    else {
+      pBlock->lCompressedLength = ZSTD_compressCCtx(cctx, pBlock->pCompressed, ow->lCompressedCapacity, pBlock->pData, pBlock->lLength, COMPRESS_LEVEL_ZSTD);
+      if (ZSTD_isError(pBlock->lCompressedLength)) {
+        fprintf(stdout, "%s %s [ERROR]: zstd compression of an output block failed: %s\n", GetDateTime(), sUUID, ZSTD_getErrorName(pBlock->lCompressedLength));
+        exit(-1);
+      }
+    }
+#endif
+
+    pthread_mutex_lock(&ow->mutex);
+    pBlock->iState = BLOCK_COMPRESSED;
+    pthread_cond_broadcast(&ow->cond);
+  }
+  pthread_mutex_unlock(&ow->mutex);
+
+  if (ow->iCompression == COMPRESS_GZIP) {
+    deflateEnd(&zs);
+  }
+#ifdef HAVE_ZSTD
+  else {
+    ZSTD_freeCCtx(cctx);
+  }
+#endif
+  return NULL;
+}
+
+//allocate the output blocks and start the flush and compressor threads, the record size is known from the metadata
+int StartOutput(CONVERTER *cv)
+{
+
+  int i;
+  size_t lCapacity;
+  OUTPUTWRITER *ow = &cv->Output;
+
+  //Parquet pages are compressed by the Parquet writer, not the file
+  ow->iCompression = (cv->iOutputFormat == FORMAT_PARQUET) ? COMPRESS_NONE : cv->iCompression;
+  ow->iCompressThreads = (ow->iCompression == COMPRESS_NONE) ? 0 : cv->iCompressThreads;
+  ow->lBlockSize = (size_t) cv->iOutputBlockSizeMB * 1024 * 1024;
+  //two blocks for double buffering, one more for every block being compressed
+  ow->iNumberOfBlocks = 2 + ow->iCompressThreads;
+  //a block takes the record that crosses its end, the overflow is moved into the next block
+  lCapacity = ow->lBlockSize + ((cv->iWriteRecordSize + OUTPUT_ALIGNMENT - 1) / OUTPUT_ALIGNMENT) * OUTPUT_ALIGNMENT;
+  if (ow->iCompression == COMPRESS_GZIP) {
+    ow->lCompressedCapacity = compressBound(lCapacity) + 32;
+  }
+#ifdef HAVE_ZSTD
+  else if (ow->iCompression == COMPRESS_ZSTD) {
+    ow->lCompressedCapacity = ZSTD_compressBound(lCapacity);
+  }
+#endif
+  if ((ow->Blocks = (OUTPUTBLOCK *) calloc(ow->iNumberOfBlocks, sizeof(OUTPUTBLOCK))) == NULL) {
+    fprintf(stdout, "%s %s [ERROR]: Can't allocate output blocks.\n", GetDateTime(), sUUID);
+    exit(-1);
+  }
+  for (i = 0; i < ow->iNumberOfBlocks; i++) {
+    if (posix_memalign((void **) &ow->Blocks[i].pData, OUTPUT_ALIGNMENT, lCapacity) != 0
+        || (ow->iCompression != COMPRESS_NONE && (ow->Blocks[i].pCompressed = (unsigned char *) malloc(ow->lCompressedCapacity)) == NULL)) {
+      fprintf(stdout, "%s %s [ERROR]: Can't allocate output blocks.\n", GetDateTime(), sUUID);
+      exit(-1);
+    }
+  }
+  ow->lNextToFill = ow->lNextToCompress = ow->lNextToFlush = 0;
+  ow->lFill = 0;
+  ow->lOffset = cv->lResumeOffset;
+  ow->iStop = 0;
+  ow->iFailed = 0;
+  //Parquet files are only valid once their footer is written, they are always converted from the start
+  ow->sCheckpointFileName = (cv->iCheckpointSeconds > 0 && cv->iOutputFormat != FORMAT_PARQUET) ? cv->sCheckpointFileName : NULL;
+  ow->iInputRecordLength = cv->iInputRecordLength;
+  ow->iChecksum = (cv->iShards > 0);
+  ow->lCrc = crc32(0L, Z_NULL, 0);
+  cv->dNextCheckpoint = MonotonicSeconds() + cv->iCheckpointSeconds;
+  pthread_mutex_init(&ow->mutex, NULL);
+  pthread_cond_init(&ow->cond, NULL);
+  if (pthread_create(&ow->FlushThread, NULL, OutputFlusher, ow) != 0) {
+    fprintf(stdout, "%s %s [ERROR]: Can't create output flush thread.\n", GetDateTime(), sUUID);
+    exit(-1);
+  }
+  for (i = 0; i < ow->iCompressThreads; i++) {
+    if (pthread_create(&ow->CompressThreads[i], NULL, OutputCompressor, ow) != 0) {
+      fprintf(stdout, "%s %s [ERROR]: Can't create output compressor thread.\n", GetDateTime(), sUUID);
+      exit(-1);
+    }
+  }
+  fprintf(stdout, "%s %s [INFO]: Output blocks: %d MB%s\n", GetDateTime(), sUUID, cv->iOutputBlockSizeMB, ow->iDirect ? ", O_DIRECT" : "");
+  if (ow->iCompression != COMPRESS_NONE) {
+    fprintf(stdout, "%s %s [INFO]: Output compression: %s on %d threads\n", GetDateTime(), sUUID, (ow->iCompression == COMPRESS_GZIP) ? "gzip" : "zstd", ow->iCompressThreads);
+  }
+  return 0;
+}
+
+//hand the first lLength bytes of the current block to the compressor or flush thread and continue
+//in the next one with the rest
+static void SubmitOutputBlock(OUTPUTWRITER *ow, size_t lLength)
+{
+
+  OUTPUTBLOCK *pBlock = &ow->Blocks[ow->lNextToFill % ow->iNumberOfBlocks];
+  OUTPUTBLOCK *pNext = &ow->Blocks[(ow->lNextToFill + 1) % ow->iNumberOfBlocks];
+  double dWait;
+
+  pthread_mutex_lock(&ow->mutex);
+  if (pNext->iState != BLOCK_FREE) {
+    dWait = MonotonicSeconds();
+    while (pNext->iState != BLOCK_FREE) {
+      pthread_cond_wait(&ow->cond, &ow->mutex);
+    }
+    __atomic_fetch_add(&Metrics.lOutputWaitNanos, (long) ((MonotonicSeconds() - dWait) * 1e9), __ATOMIC_RELAXED);
+  }
+  pBlock->lLength = lLength;
+  pBlock->iState = BLOCK_FILLED;
+  ow->lNextToFill++;
+  pthread_cond_broadcast(&ow->cond);
+  pthread_mutex_unlock(&ow->mutex);
+  memcpy(pNext->pData, &pBlock->pData[lLength], ow->lFill - lLength);
+  pNext->lCheckpointRecords = 0;
+  ow->lFill -= lLength;
+}
+
+//room for one converted record in the current block
+unsigned char *ReserveOutput(OUTPUTWRITER *ow)
+{
+  return &ow->Blocks[ow->lNextToFill % ow->iNumberOfBlocks].pData[ow->lFill];
+}
+
+//the record written to the room given by ReserveOutput() takes lLength bytes
+void CommitOutput(OUTPUTWRITER *ow, size_t lLength)
+{
+  ow->lFill += lLength;
+  if (ow->lFill >= ow->lBlockSize) {
+    SubmitOutputBlock(ow, ow->lBlockSize);
+  }
+}
+
+//called between records: the current block ends after the last complete record and the flush thread
+//takes a checkpoint once it is written, every block is compressed on its own so this holds for gzip and zstd too,
+//lInput is the offset of the input that record ends at
+void CheckpointOutput(CONVERTER *cv, long lRejected, off_t lInput)
+{
+
+  OUTPUTWRITER *ow = &cv->Output;
+  OUTPUTBLOCK *pBlock = &ow->Blocks[ow->lNextToFill % ow->iNumberOfBlocks];
+
+  //nothing converted since the last block, tried again after the next records
+  if (ow->sCheckpointFileName == NULL || ow->lFill == 0) {
+    return;
+  }
+  pBlock->lCheckpointRecords = cv->iCurrentRecord - 1;
+  pBlock->lCheckpointRejected = lRejected;
+  pBlock->lCheckpointInput = lInput;
+  SubmitOutputBlock(ow, ow->lFill);
+  cv->dNextCheckpoint = MonotonicSeconds() + cv->iCheckpointSeconds;
+}
+
+//copy converted records into the output blocks
+void WriteOutput(OUTPUTWRITER *ow, const unsigned char *pData, size_t lLength)
+{
+
+  size_t lCopy;
+
+  while (lLength > 0) {
+    lCopy = (lLength < ow->lBlockSize - ow->lFill) ? lLength : ow->lBlockSize - ow->lFill;
+    memcpy(ReserveOutput(ow), pData, lCopy);
+    pData += lCopy;
+    lLength -= lCopy;
+    CommitOutput(ow, lCopy);
+  }
+}
+
+//hand over the last, partial block, stop the threads once everything is written and close the output file,
+//returns -1 if the output could not be written completely
+int CloseOutput(CONVERTER *cv)
+{
+
+  int i;
+  OUTPUTWRITER *ow = &cv->Output;
+  OUTPUTBLOCK *pBlock = &ow->Blocks[ow->lNextToFill % ow->iNumberOfBlocks];
+
+  pthread_mutex_lock(&ow->mutex);
+  if (ow->lFill > 0) {
+    pBlock->lLength = ow->lFill;
+    pBlock->iState = BLOCK_FILLED;
+    ow->lNextToFill++;
+  }
+  ow->iStop = 1;
+  pthread_cond_broadcast(&ow->cond);
+  pthread_mutex_unlock(&ow->mutex);
+  for (i = 0; i < ow->iCompressThreads; i++) {
+    pthread_join(ow->CompressThreads[i], NULL);
+  }
+  pthread_join(ow->FlushThread, NULL);
+
+  if (ow->fd >= 0 && close(ow->fd) != 0) {
+    fprintf(stdout, "%s %s [ERROR]: Unable to close output file: %s\n", GetDateTime(), sUUID, strerror(errno));
+    ow->iFailed = 1;
+  }
+  if (ow->iCompression != COMPRESS_NONE) {
+    fprintf(stdout, "%s %s [INFO]: Compressed output: %ld bytes\n", GetDateTime(), sUUID, (long) ow->lOffset);
+  }
+  pthread_cond_destroy(&ow->cond);
+  pthread_mutex_destroy(&ow->mutex);
+  for (i = 0; i < ow->iNumberOfBlocks; i++) {
+    free(ow->Blocks[i].pData);
+    free(ow->Blocks[i].pCompressed);
+  }
+  free(ow->Blocks);
+  return ow->iFailed ? -1 : 0;
+}
+
+//name of the current part of a sharded output: the part number goes before the extensions of the output file name,
+//out.txt.gz becomes out-part-00000.txt.gz, parts of parallel shards closed by size or records out-part-00001-00002.txt.gz
+static int PartFileName(CONVERTER *cv)
+{
+
+  const char *pBase = strrchr(cv->sPartBaseName, '/');
+  const char *pExtension;
+  int iStem;
+  int iLength;
+
+  pBase = (pBase == NULL) ? cv->sPartBaseName : pBase + 1;
+  if ((pExtension = strchr((*pBase == '.') ? pBase + 1 : pBase, '.')) == NULL) {
+    pExtension = pBase + strlen(pBase);
+  }
+  iStem = pExtension - cv->sPartBaseName;
+  if (cv->iShards > 1 && (cv->lShardBytes > 0 || cv->lShardRecords > 0)) {
+    iLength = snprintf(cv->sOutputFileName, sizeof(cv->sOutputFileName), "%.*s-part-%05d-%05d%s", iStem, cv->sPartBaseName, cv->iShard, cv->iPart, pExtension);
+  }
+  else {
+    iLength = snprintf(cv->sOutputFileName, sizeof(cv->sOutputFileName), "%.*s-part-%05d%s", iStem, cv->sPartBaseName, (cv->iShards > 1) ? cv->iShard : cv->iPart, pExtension);
+  }
+  return (iLength < (int) sizeof(cv->sOutputFileName)) ? 0 : -1;
+}
+
+//start the current part of a sharded output, it is written by output threads of its own, a part that can't be
+//opened takes its records without writing them and fails the file when it is closed
+static void OpenPart(CONVERTER *cv)
+{
+
+  int iOpened;
+
+  if ((iOpened = (PartFileName(cv) == 0 && OpenOutputFile(cv) == 0))) {
+    fprintf(stdout, "%s %s [INFO]: Output part: %s\n", GetDateTime(), sUUID, cv->sOutputFileName);
+  }
+  else {
+    fprintf(stdout, "%s %s [ERROR]: Unable to open output file: %s\n", GetDateTime(), sUUID, cv->sOutputFileName);
+    cv->Output.fd = -1;
+  }
+  cv->lPartRecords = 0;
+  cv->lPartBytes = 0;
+  StartOutput(cv);
+  cv->Output.iFailed = !iOpened;
+  if (cv->iOutputFormat == FORMAT_PARQUET) {
+    OpenParquet(cv);
+  }
+}
+
+//close the current part once everything is written and keep its records, bytes and crc32 for the manifest
+static void ClosePart(CONVERTER *cv)
+{
+
+  PART *pPart;
+
+  if (cv->iOutputFormat == FORMAT_PARQUET) {
+    CloseParquet(cv);
+  }
+  if (CloseOutput(cv) != 0) {
+    __atomic_store_n(&cv->iAbort, 1, __ATOMIC_RELAXED);
+  }
+  if ((cv->Parts = (PART *) realloc(cv->Parts, (cv->iParts + 1) * sizeof(PART))) == NULL) {
+    fprintf(stdout, "%s %s [ERROR]: Can't allocate part table.\n", GetDateTime(), sUUID);
+    exit(-1);
+  }
+  pPart = &cv->Parts[cv->iParts++];
+  strcpy(pPart->sFileName, cv->sOutputFileName);
+  pPart->lRecords = cv->lPartRecords;
+  pPart->lBytes = (long) cv->Output.lOffset;
+  pPart->lCrc = cv->Output.lCrc;
+  cv->iPart++;
+}
+
+//called before a record is written: a part that reached --shard-size or --shard-records is closed and the next
+//one started, so no part is started without a record for it, Parquet parts grow by whole row groups
+static inline void NextPartIfFull(CONVERTER *cv)
+{
+  if (cv->iShards > 0 && ((cv->lShardRecords > 0 && cv->lPartRecords >= cv->lShardRecords)
+      || (cv->lShardBytes > 0 && ((cv->iOutputFormat == FORMAT_PARQUET) ? cv->pParquet->lOffset : cv->lPartBytes) >= cv->lShardBytes))) {
+#ifdef E2A_COUNT_ALLOCATIONS
+    long *pCounter = pSteadyStateAllocations;
+
+    STOP_COUNTING_ALLOCATIONS();
+#endif
+    ClosePart(cv);
+    OpenPart(cv);
+#ifdef E2A_COUNT_ALLOCATIONS
+    pSteadyStateAllocations = (cv->iOutputFormat == FORMAT_PARQUET) ? NULL : pCounter;
+#endif
+  }
+}
+
+//field handlers of the record plan: convert one step from pRecord to pOutput, followed by a separator,
+//and return the number of characters written
+
+//one text field, translated and trimmed in place
+int HandleText(const FIELDPLAN *pStep, const unsigned char *pRecord, char *pOutput)
+{
+
+  TRIMBUFFER tb;
+  TEXTSCAN ts;
+
+  convert((unsigned char *) pOutput, &pRecord[pStep->iInputPosition], pStep->iInputFieldLength, pStep->pTable, &ts);
+  trim(pOutput, pOutput, pStep->iInputFieldLength, &tb, &ts);
+  pOutput[tb.iLength] = '|';
+  return tb.iLength + 1;
+}
+
+//every field of a translated text run trimmed forward into pOutput, each followed by a separator
+int TrimTextRun(const FIELDPLAN *pStep, char *pField, const TEXTSCAN *tsRun, char *pOutput)
+{
+
+  int j;
+  int iLength = 0;
+  int iFieldLength;
+  TRIMBUFFER tb;
+  TEXTSCAN ts;
+
+  for (j = 0; j < pStep->iFields; j++) {
+    iFieldLength = pStep->pFieldLengths[j];
+    //blank bounds of the field, characters are filtered only if the run contains any
+    ts.iSpecial = tsRun->iSpecial;
+    for (ts.iFirst = 0; ts.iFirst < iFieldLength && IS_BLANK(pField[ts.iFirst]); ts.iFirst++)
+      ;
+    if (ts.iFirst == iFieldLength) {
+      ts.iFirst = -1;
+    }
+    else {
+      for (ts.iLast = iFieldLength - 1; IS_BLANK(pField[ts.iLast]); ts.iLast--)
+        ;
+    }
+    trim(&pOutput[iLength], pField, iFieldLength, &tb, &ts);
+    iLength += tb.iLength;
+    pOutput[iLength++] = '|';
+    pField += iFieldLength;
+  }
+  return iLength;
+}
+
+//adjacent text fields, translated in one pass behind the room for their separators,
+//then every field is trimmed forward into its place
+int HandleTextRun(const FIELDPLAN *pStep, const unsigned char *pRecord, char *pOutput)
+{
+
+  TEXTSCAN tsRun;
+
+  convert((unsigned char *) &pOutput[pStep->iFields], &pRecord[pStep->iInputPosition], pStep->iInputFieldLength, pStep->pTable, &tsRun);
+  return TrimTextRun(pStep, &pOutput[pStep->iFields], &tsRun, pOutput);
+}
+
+//UTF-8 output of HandleText(): ASCII text stays as translated, only a field with other characters is expanded
+int HandleTextUtf8(const FIELDPLAN *pStep, const unsigned char *pRecord, char *pOutput)
+{
+
+  TRIMBUFFER tb;
+  TEXTSCAN ts;
+
+  convert((unsigned char *) pOutput, &pRecord[pStep->iInputPosition], pStep->iInputFieldLength, pStep->pTable, &ts);
+  trim(pOutput, pOutput, pStep->iInputFieldLength, &tb, &ts);
+  if (ts.iHigh) {
+    tb.iLength = ExpandUtf8(pOutput, tb.iLength, pStep->cEuro);
+  }
+  pOutput[tb.iLength] = '|';
+  return tb.iLength + 1;
+}
+
+//UTF-8 output of HandleTextRun(): the trimmed fields and their separators are expanded in one pass if the run needs it
+int HandleTextRunUtf8(const FIELDPLAN *pStep, const unsigned char *pRecord, char *pOutput)
+{
+
+  int iLength;
+  TEXTSCAN tsRun;
+
+  convert((unsigned char *) &pOutput[pStep->iFields], &pRecord[pStep->iInputPosition], pStep->iInputFieldLength, pStep->pTable, &tsRun);
+  iLength = TrimTextRun(pStep, &pOutput[pStep->iFields], &tsRun, pOutput);
+  return tsRun.iHigh ? ExpandUtf8(pOutput, iLength, pStep->cEuro) : iLength;
+}
+
+//a parsed date written as YYYY-MM-DD, no date is left empty, so is an invalid one unless it rejects the record
+static inline int PutDate(const FIELDPLAN *pStep, char *pOutput, int iDate, int iYear, int iMonth, int iDay)
+{
+  if (__builtin_expect(iDate == DATE_VALID, 1)) {
+    WriteDate(pOutput, iYear, iMonth, iDay);
+    pOutput[DATE_TEXT_LENGTH] = '|';
+    return DATE_TEXT_LENGTH + 1;
+  }
+  if (iDate == DATE_INVALID && pStep->iRejectDates) {
+    sDecodeError = "invalid date";
+  }
+  pOutput[0] = '|';
+  return 1;
+}
+
+//a date of text, translated in place and parsed between the blanks the translation found
+int HandleDate(const FIELDPLAN *pStep, const unsigned char *pRecord, char *pOutput)
+{
+
+  int iYear = 0, iMonth = 0, iDay = 0;
+  int iDate;
+  TEXTSCAN ts;
+
+  convert((unsigned char *) pOutput, &pRecord[pStep->iInputPosition], pStep->iInputFieldLength, pStep->pTable, &ts);
+  iDate = (ts.iFirst < 0) ? DATE_NULL : ParseDate(&pOutput[ts.iFirst], ts.iLast - ts.iFirst + 1, pStep->iDateFormat, &iYear, &iMonth, &iDay);
+  return PutDate(pStep, pOutput, iDate, iYear, iMonth, iDay);
+}
+
+//an AS400 CYYMMDD date packed into 4 bytes
+int HandlePackedDate(const FIELDPLAN *pStep, const unsigned char *pRecord, char *pOutput)
+{
+
+  int iYear = 0, iMonth = 0, iDay = 0;
+  int iDate;
+
+  iDate = ParsePackedDate(&pRecord[pStep->iInputPosition], &iYear, &iMonth, &iDay);
+  return PutDate(pStep, pOutput, iDate, iYear, iMonth, iDay);
+}
+
+int HandlePacked(const FIELDPLAN *pStep, const unsigned char *pRecord, char *pOutput)
+{
+
+  int iLength;
+
+  iLength = FormatDecimal(pOutput, unpack((const char *) &pRecord[pStep->iInputPosition], pStep->iInputFieldLength), pStep->iPrecision);
+  pOutput[iLength] = '|';
+  return iLength + 1;
+}
+
+int HandleZoned(const FIELDPLAN *pStep, const unsigned char *pRecord, char *pOutput)
+{
+
+  int iLength;
+
+  iLength = FormatDecimal(pOutput, unzone((const char *) &pRecord[pStep->iInputPosition], pStep->iInputFieldLength), pStep->iPrecision);
+  pOutput[iLength] = '|';
+  return iLength + 1;
+}
+
+int HandlePacked128(const FIELDPLAN *pStep, const unsigned char *pRecord, char *pOutput)
+{
+
+  int iLength;
+
+  iLength = FormatDecimal128(pOutput, unpack128((const char *) &pRecord[pStep->iInputPosition], pStep->iInputFieldLength), pStep->iPrecision);
+  pOutput[iLength] = '|';
+  return iLength + 1;
+}
+
+int HandleZoned128(const FIELDPLAN *pStep, const unsigned char *pRecord, char *pOutput)
+{
+
+  int iLength;
+
+  iLength = FormatDecimal128(pOutput, unzone128((const char *) &pRecord[pStep->iInputPosition], pStep->iInputFieldLength), pStep->iPrecision);
+  pOutput[iLength] = '|';
+  return iLength + 1;
+}
+
+int HandlePackedDigits(const FIELDPLAN *pStep, const unsigned char *pRecord, char *pOutput)
+{
+
+  int iLength;
+
+  iLength = FormatDecimalDigits(pOutput, (const char *) &pRecord[pStep->iInputPosition], pStep->iInputFieldLength, 0, pStep->iPrecision);
+  pOutput[iLength] = '|';
+  return iLength + 1;
+}
+
+int HandleZonedDigits(const FIELDPLAN *pStep, const unsigned char *pRecord, char *pOutput)
+{
+
+  int iLength;
+
+  iLength = FormatDecimalDigits(pOutput, (const char *) &pRecord[pStep->iInputPosition], pStep->iInputFieldLength, 1, pStep->iPrecision);
+  pOutput[iLength] = '|';
+  return iLength + 1;
+}
+
+//binary integers: one handler per width, so that the load is a single fixed-width load and bswap
+int HandleBinary2(const FIELDPLAN *pStep, const unsigned char *pRecord, char *pOutput)
+{
+
+  int iLength;
+
+  iLength = FormatDecimal(pOutput, unbinary((const char *) &pRecord[pStep->iInputPosition], 2), pStep->iPrecision);
+  pOutput[iLength] = '|';
+  return iLength + 1;
+}
+
+int HandleBinary4(const FIELDPLAN *pStep, const unsigned char *pRecord, char *pOutput)
+{
+
+  int iLength;
+
+  iLength = FormatDecimal(pOutput, unbinary((const char *) &pRecord[pStep->iInputPosition], 4), pStep->iPrecision);
+  pOutput[iLength] = '|';
+  return iLength + 1;
+}
+
+int HandleBinary8(const FIELDPLAN *pStep, const unsigned char *pRecord, char *pOutput)
+{
+
+  int iLength;
+
+  iLength = FormatDecimal(pOutput, unbinary((const char *) &pRecord[pStep->iInputPosition], 8), pStep->iPrecision);
+  pOutput[iLength] = '|';
+  return iLength + 1;
+}
+
+int HandleBinaryUnsigned(const FIELDPLAN *pStep, const unsigned char *pRecord, char *pOutput)
+{
+
+  int iLength;
+
+  iLength = FormatDecimal128(pOutput, unbinaryu((const char *) &pRecord[pStep->iInputPosition], pStep->iInputFieldLength), pStep->iPrecision);
+  pOutput[iLength] = '|';
+  return iLength + 1;
+}
+
+//floats with 9 significant digits for 4 bytes and 17 for 8 bytes, enough to read back the same value
+static inline int FormatFloat(char *pOutput, double dValue, size_t length)
+{
+  //no negative zero
+  return snprintf(pOutput, FLOAT_TEXT_LENGTH + 1, "%.*g", (length == 4) ? 9 : 17, (dValue == 0) ? 0.0 : dValue);
+}
+
+int HandleFloat(const FIELDPLAN *pStep, const unsigned char *pRecord, char *pOutput)
+{
+
+  int iLength;
+
+  iLength = FormatFloat(pOutput, unfloat((const char *) &pRecord[pStep->iInputPosition], pStep->iInputFieldLength), pStep->iInputFieldLength);
+  pOutput[iLength] = '|';
+  return iLength + 1;
+}
+
+int HandleHexFloat(const FIELDPLAN *pStep, const unsigned char *pRecord, char *pOutput)
+{
+
+  int iLength;
+
+  iLength = FormatFloat(pOutput, unhexfloat((const char *) &pRecord[pStep->iInputPosition], pStep->iInputFieldLength), pStep->iInputFieldLength);
+  pOutput[iLength] = '|';
+  return iLength + 1;
+}
+
+//run the record plan on a record that passed the filter
+static inline int RunRecordPlan(const CONVERTER *cv, const unsigned char *pRecord, unsigned char *pWriteBuffer)
+{
+
+  int iLastWritePosition = 0;
+  const FIELDPLAN *pStep;
+  const FIELDPLAN *pEnd = &cv->Plan[cv->iPlanSteps];
+
+  //every field is converted and trimmed in place in the write buffer, nothing is allocated per record
+  for (pStep = cv->Plan; pStep < pEnd; pStep++) {
+    iLastWritePosition += pStep->Handler(pStep, pRecord, (char *) &pWriteBuffer[iLastWritePosition]);
+    if (__builtin_expect(sDecodeError != NULL, 0)) {
+      iDecodeErrorField = pStep->iField;
+      return -1;
+    }
+  }
+  //the separator of the last field ends the record, CR/LF inside the fields have been replaced by trim()
+  iLastWritePosition--;
+  pWriteBuffer[iLastWritePosition] = '\n';
+  return iLastWritePosition + 1;
+}
+
+//run the record plan on a copybook record whose fields are selected record by record, left out fields stay empty
+static int RunRecordPlanSelected(const CONVERTER *cv, const unsigned char *pRecord, unsigned char *pWriteBuffer)
+{
+
+  int i;
+  int iEnd;
+  int iLastWritePosition = 0;
+  unsigned long lSelected;
+  const FIELDPLAN *pStep;
+  const FIELDPLAN *pEnd = &cv->Plan[cv->iPlanSteps];
+
+  if (SelectFields(cv, pRecord, &lSelected, &iEnd) != 0) {
+    return -1;
+  }
+  for (pStep = cv->Plan; pStep < pEnd; pStep++) {
+    if (SKIPPED_STEP(pStep, lSelected, iEnd)) {
+      for (i = 0; i < pStep->iFields; i++) {
+        pWriteBuffer[iLastWritePosition++] = '|';
+      }
+      continue;
+    }
+    iLastWritePosition += pStep->Handler(pStep, pRecord, (char *) &pWriteBuffer[iLastWritePosition]);
+    if (__builtin_expect(sDecodeError != NULL, 0)) {
+      iDecodeErrorField = pStep->iField;
+      return -1;
+    }
+  }
+  iLastWritePosition--;
+  pWriteBuffer[iLastWritePosition] = '\n';
+  return iLastWritePosition + 1;
+}
+
+//convert a single record from pRecord into pWriteBuffer by running the record plan,
+//returns the number of bytes to be written including the trailing newline, 0 if the record is filtered out
+//and -1 if a field can't be decoded
+int ConvertRecord(CONVERTER *cv, const unsigned char *pRecord, unsigned char *pWriteBuffer)
+{
+
+  int iKeep;
+
+  if (cv->iFilters > 0 && (iKeep = FilterRecord(cv, pRecord)) <= 0) {
+    return iKeep;
+  }
+  return cv->iSelectFields ? RunRecordPlanSelected(cv, pRecord, pWriteBuffer) : RunRecordPlan(cv, pRecord, pWriteBuffer);
+}
+
+//fixed-width output of a record that passed the filter: every field is converted like for the text output and then
+//padded to its width without separator, text and dates left-aligned and cut at the width, numbers right-aligned
+static int ConvertRecordFixed(const CONVERTER *cv, const unsigned char *pRecord, unsigned char *pWriteBuffer)
+{
+
+  int i;
+  int iChars;
+  int iLength;
+  int iPosition = 0;
+  int iEnd = cv->iInputRecordLength;
+  unsigned long lSelected = ~0UL;
+  char *pOutput;
+  const FIELDPLAN *pStep;
+  const FIELDPLAN *pEnd = &cv->Plan[cv->iPlanSteps];
+
+  if (cv->iSelectFields && SelectFields(cv, pRecord, &lSelected, &iEnd) != 0) {
+    return -1;
+  }
+  for (pStep = cv->Plan; pStep < pEnd; pStep++) {
+    pOutput = (char *) &pWriteBuffer[iPosition];
+    if (SKIPPED_STEP(pStep, lSelected, iEnd)) {
+      memset(pOutput, ' ', pStep->iWidth);
+      iPosition += pStep->iWidth;
+      continue;
+    }
+    iLength = pStep->Handler(pStep, pRecord, pOutput) - 1;
+    if (__builtin_expect(sDecodeError != NULL, 0)) {
+      iDecodeErrorField = pStep->iField;
+      return -1;
+    }
+    //UTF-8 text is cut and padded by characters, the bytes following the first byte of a character take no room
+    if (cv->iEncoding == ENCODING_UTF8 && (pStep->cDatatype == 'A' || pStep->cDatatype == 'T')) {
+      for (i = 0, iChars = 0; i < iLength && (iChars < pStep->iWidth || (pOutput[i] & 0xC0) == 0x80); i++) {
+        iChars += ((pOutput[i] & 0xC0) != 0x80);
+      }
+      memset(&pOutput[i], ' ', pStep->iWidth - iChars);
+      iPosition += i + pStep->iWidth - iChars;
+      continue;
+    }
+    if (iLength > pStep->iWidth) {
+      iLength = pStep->iWidth;
+    }
+    if (pStep->cDatatype != 'A' && pStep->cDatatype != 'T' && pStep->cDatatype != 'L') {
+      memmove(&pOutput[pStep->iWidth - iLength], pOutput, iLength);
+      memset(pOutput, ' ', pStep->iWidth - iLength);
+    }
+    else {
+      memset(&pOutput[iLength], ' ', pStep->iWidth - iLength);
+    }
+    iPosition += pStep->iWidth;
+  }
+  pWriteBuffer[iPosition] = '\n';
+  return iPosition + 1;
+}
+
+//index of a datatype in the metrics
+int MetricType(char cDatatype)
+{
+  const char *p = strchr(sMetricTypes, cDatatype);
+
+  return (p != NULL && cDatatype != '\0') ? (int) (p - sMetricTypes) : 0;
+}
+
+//add the counts of a converting thread to the process metrics and start counting again
+void FlushThreadMetrics(const CONVERTER *cv, THREADMETRICS *tm)
+{
+
+  int i;
+  const FIELDPLAN *pStep;
+
+  for (pStep = cv->Plan; pStep < &cv->Plan[cv->iPlanSteps]; pStep++) {
+    __atomic_fetch_add(&Metrics.lFieldValues[pStep->iMetricType], (tm->lRecords - tm->lFiltered) * pStep->iFields, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&Metrics.lFieldBytes[pStep->iMetricType], (tm->lRecords - tm->lFiltered) * pStep->iInputFieldLength, __ATOMIC_RELAXED);
+  }
+  for (i = 0; i < METRIC_TYPES; i++) {
+    __atomic_fetch_add(&Metrics.lFieldTicks[i], tm->lFieldTicks[i], __ATOMIC_RELAXED);
+  }
+  __atomic_fetch_add(&Metrics.lRecords, tm->lRecords - tm->lFiltered, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&Metrics.lFiltered, tm->lFiltered, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&Metrics.lInputBytes, tm->lRecords * cv->iInputRecordLength, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&Metrics.lPlanRecords, tm->lPlanRecords, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&Metrics.lSampledRecords, tm->lSampledRecords, __ATOMIC_RELAXED);
+  memset(tm, 0, sizeof(THREADMETRICS));
+}
+
+//write the metrics to sFileName, a temporary file renamed over it so readers never see half a report
+static void WriteMetricsFile(const char *sFileName, int iPrometheus)
+{
+
+  int i;
+  long lValue;
+  double dElapsed;
+  double dTicksPerSecond;
+  double dSampleScale;
+  char sTempName[PATH_MAX];
+  FILE *fp;
+  struct rusage ru;
+
+  dElapsed = MonotonicSeconds() - Metrics.dStartSeconds;
+  dTicksPerSecond = (dElapsed > 0) ? (ReadTicks() - Metrics.lStartTicks) / dElapsed : 1;
+  //field times are measured on sampled records and scaled to all records converted by the plan
+  lValue = __atomic_load_n(&Metrics.lSampledRecords, __ATOMIC_RELAXED);
+  dSampleScale = (lValue > 0) ? (double) __atomic_load_n(&Metrics.lPlanRecords, __ATOMIC_RELAXED) / lValue : 0;
+  getrusage(RUSAGE_SELF, &ru);
+
+  if (snprintf(sTempName, sizeof(sTempName), "%s.tmp", sFileName) >= (int) sizeof(sTempName) || (fp = fopen(sTempName, "w")) == NULL) {
+    fprintf(stdout, "%s %s [ERROR]: Unable to write metrics file %s\n", GetDateTime(), sUUID, sFileName);
+    return;
+  }
+  if (iPrometheus) {
+    fprintf(fp, "# HELP e2a_files_total Files converted or failed.\n# TYPE e2a_files_total counter\n");
+    fprintf(fp, "e2a_files_total{status=\"converted\"} %ld\n", __atomic_load_n(&Metrics.lFiles, __ATOMIC_RELAXED));
+    fprintf(fp, "e2a_files_total{status=\"failed\"} %ld\n", __atomic_load_n(&Metrics.lFilesFailed, __ATOMIC_RELAXED));
+    fprintf(fp, "# HELP e2a_records_total Records converted.\n# TYPE e2a_records_total counter\n");
+    fprintf(fp, "e2a_records_total %ld\n", __atomic_load_n(&Metrics.lRecords, __ATOMIC_RELAXED));
+    fprintf(fp, "# HELP e2a_rejected_records_total Records written to the reject file.\n# TYPE e2a_rejected_records_total counter\n");
+    fprintf(fp, "e2a_rejected_records_total %ld\n", __atomic_load_n(&Metrics.lRejected, __ATOMIC_RELAXED));
+    fprintf(fp, "# HELP e2a_filtered_records_total Records skipped by the --where filter.\n# TYPE e2a_filtered_records_total counter\n");
+    fprintf(fp, "e2a_filtered_records_total %ld\n", __atomic_load_n(&Metrics.lFiltered, __ATOMIC_RELAXED));
+    fprintf(fp, "# HELP e2a_input_bytes_total Bytes of converted input records.\n# TYPE e2a_input_bytes_total counter\n");
+    fprintf(fp, "e2a_input_bytes_total %ld\n", __atomic_load_n(&Metrics.lInputBytes, __ATOMIC_RELAXED));
+    fprintf(fp, "# HELP e2a_output_bytes_total Bytes written to output files.\n# TYPE e2a_output_bytes_total counter\n");
+    fprintf(fp, "e2a_output_bytes_total %ld\n", __atomic_load_n(&Metrics.lOutputBytes, __ATOMIC_RELAXED));
+    fprintf(fp, "# HELP e2a_field_values_total Field values converted by datatype.\n# TYPE e2a_field_values_total counter\n");
+    for (i = 0; i < METRIC_TYPES; i++) {
+      fprintf(fp, "e2a_field_values_total{type=\"%c\"} %ld\n", sMetricTypes[i], __atomic_load_n(&Metrics.lFieldValues[i], __ATOMIC_RELAXED));
+    }
+    fprintf(fp, "# HELP e2a_field_bytes_total Input bytes of field values by datatype.\n# TYPE e2a_field_bytes_total counter\n");
+    for (i = 0; i < METRIC_TYPES; i++) {
+      fprintf(fp, "e2a_field_bytes_total{type=\"%c\"} %ld\n", sMetricTypes[i], __atomic_load_n(&Metrics.lFieldBytes[i], __ATOMIC_RELAXED));
+    }
+    fprintf(fp, "# HELP e2a_field_seconds_total Conversion time by datatype, estimated from sampled records.\n# TYPE e2a_field_seconds_total counter\n");
+    for (i = 0; i < METRIC_TYPES; i++) {
+      fprintf(fp, "e2a_field_seconds_total{type=\"%c\"} %.6f\n", sMetricTypes[i], __atomic_load_n(&Metrics.lFieldTicks[i], __ATOMIC_RELAXED) / dTicksPerSecond * dSampleScale);
+    }
+    fprintf(fp, "# HELP e2a_wait_seconds_total Time the conversion waited for input or for free output blocks.\n# TYPE e2a_wait_seconds_total counter\n");
+    fprintf(fp, "e2a_wait_seconds_total{direction=\"input\"} %.6f\n", __atomic_load_n(&Metrics.lInputWaitNanos, __ATOMIC_RELAXED) / 1e9);
+    fprintf(fp, "e2a_wait_seconds_total{direction=\"output\"} %.6f\n", __atomic_load_n(&Metrics.lOutputWaitNanos, __ATOMIC_RELAXED) / 1e9);
+    fprintf(fp, "# HELP e2a_peak_memory_bytes Peak resident memory of the process.\n# TYPE e2a_peak_memory_bytes gauge\n");
+    fprintf(fp, "e2a_peak_memory_bytes %ld\n", ru.ru_maxrss * 1024L);
+    fprintf(fp, "# HELP e2a_uptime_seconds Time since the process started.\n# TYPE e2a_uptime_seconds gauge\n");
+    fprintf(fp, "e2a_uptime_seconds %.3f\n", dElapsed);
+  }
+  else {
+    fprintf(fp, "{\n  \"version\": \"%s\",\n  \"uuid\": \"%s\",\n  \"elapsed_seconds\": %.3f,\n", E2A_VERSION, sUUID, dElapsed);
+    fprintf(fp, "  \"files\": %ld,\n  \"files_failed\": %ld,\n", __atomic_load_n(&Metrics.lFiles, __ATOMIC_RELAXED), __atomic_load_n(&Metrics.lFilesFailed, __ATOMIC_RELAXED));
+    fprintf(fp, "  \"records\": %ld,\n  \"rejected_records\": %ld,\n  \"filtered_records\": %ld,\n", __atomic_load_n(&Metrics.lRecords, __ATOMIC_RELAXED),
+            __atomic_load_n(&Metrics.lRejected, __ATOMIC_RELAXED), __atomic_load_n(&Metrics.lFiltered, __ATOMIC_RELAXED));
+    fprintf(fp, "  \"input_bytes\": %ld,\n  \"output_bytes\": %ld,\n",
+            __atomic_load_n(&Metrics.lInputBytes, __ATOMIC_RELAXED), __atomic_load_n(&Metrics.lOutputBytes, __ATOMIC_RELAXED));
+    fprintf(fp, "  \"input_wait_seconds\": %.6f,\n  \"output_wait_seconds\": %.6f,\n", __atomic_load_n(&Metrics.lInputWaitNanos, __ATOMIC_RELAXED) / 1e9,
+            __atomic_load_n(&Metrics.lOutputWaitNanos, __ATOMIC_RELAXED) / 1e9);
+    fprintf(fp, "  \"peak_memory_bytes\": %ld,\n  \"sampled_records\": %ld,\n  \"field_types\": {\n", ru.ru_maxrss * 1024L, lValue);
+    for (i = 0; i < METRIC_TYPES; i++) {
+      fprintf(fp, "    \"%c\": {\"values\": %ld, \"bytes\": %ld, \"seconds\": %.6f}%s\n", sMetricTypes[i], __atomic_load_n(&Metrics.lFieldValues[i], __ATOMIC_RELAXED),
+              __atomic_load_n(&Metrics.lFieldBytes[i], __ATOMIC_RELAXED), __atomic_load_n(&Metrics.lFieldTicks[i], __ATOMIC_RELAXED) / dTicksPerSecond * dSampleScale,
+              (i < METRIC_TYPES - 1) ? "," : "");
+    }
+    fprintf(fp, "  }\n}\n");
+  }
+  if (fclose(fp) != 0 || rename(sTempName, sFileName) != 0) {
+    fprintf(stdout, "%s %s [ERROR]: Unable to write metrics file %s\n", GetDateTime(), sUUID, sFileName);
+  }
+}
+
+//write the requested metrics reports, called at exit, after every file of a batch or watch and on SIGUSR1
+void WriteMetricsReports(void)
+{
+  pthread_mutex_lock(&Metrics.mutex);
+  if (Metrics.sJsonFile != NULL) {
+    WriteMetricsFile(Metrics.sJsonFile, 0);
+  }
+  if (Metrics.sPrometheusFile != NULL) {
+    WriteMetricsFile(Metrics.sPrometheusFile, 1);
+  }
+  pthread_mutex_unlock(&Metrics.mutex);
+}
+
+//SIGUSR1 is blocked in all threads and taken here, so the reports are written outside of a signal handler
+void *MetricsSignalThread(void *pArg)
+{
+
+  int iSignal;
+  sigset_t sigReport;
+
+  sigemptyset(&sigReport);
+  sigaddset(&sigReport, SIGUSR1);
+  for (;;) {
+    if (sigwait(&sigReport, &iSignal) == 0) {
+      fprintf(stdout, "%s %s [INFO]: SIGUSR1, writing metrics\n", GetDateTime(), sUUID);
+      WriteMetricsReports();
+    }
+  }
+  return NULL;
+}
+
+//convert a record like ConvertRecord(), one record in METRICS_SAMPLE_RECORDS is timed field by field,
+//fixed-width records are not timed
+int ConvertRecordMetered(CONVERTER *cv, const unsigned char *pRecord, unsigned char *pWriteBuffer, THREADMETRICS *tm)
+{
+
+  int iLastWritePosition = 0;
+  unsigned long lTicks, lNow;
+  const FIELDPLAN *pStep;
+  const FIELDPLAN *pEnd = &cv->Plan[cv->iPlanSteps];
+
+  tm->lRecords++;
+  if (cv->iFilters > 0 && (iLastWritePosition = FilterRecord(cv, pRecord)) <= 0) {
+    tm->lFiltered += (iLastWritePosition == 0);
+  }
+  else if (cv->iOutputFormat == FORMAT_FIXED) {
+    iLastWritePosition = ConvertRecordFixed(cv, pRecord, pWriteBuffer);
+  }
+  else if (cv->iSelectFields) {
+    iLastWritePosition = RunRecordPlanSelected(cv, pRecord, pWriteBuffer);
+    tm->lPlanRecords++;
+  }
+  else if (tm->lRecords % METRICS_SAMPLE_RECORDS != 0) {
+    iLastWritePosition = RunRecordPlan(cv, pRecord, pWriteBuffer);
+    tm->lPlanRecords++;
+  }
+  else {
+    iLastWritePosition = 0;
+    lTicks = ReadTicks();
+    for (pStep = cv->Plan; pStep < pEnd && iLastWritePosition >= 0; pStep++) {
+      iLastWritePosition += pStep->Handler(pStep, pRecord, (char *) &pWriteBuffer[iLastWritePosition]);
+      lNow = ReadTicks();
+      tm->lFieldTicks[pStep->iMetricType] += lNow - lTicks;
+      lTicks = lNow;
+      if (sDecodeError != NULL) {
+        iDecodeErrorField = pStep->iField;
+        iLastWritePosition = -1;
+      }
+    }
+    if (iLastWritePosition >= 0) {
+      pWriteBuffer[--iLastWritePosition] = '\n';
+      iLastWritePosition++;
+    }
+    tm->lSampledRecords++;
+    tm->lPlanRecords++;
+  }
+  if (tm->lRecords == METRICS_FLUSH_RECORDS) {
+    FlushThreadMetrics(cv, tm);
+  }
+  return iLastWritePosition;
+}
+
+//a record that can't be converted: without a reject file the conversion of the file ends with it, its output is
+//removed and a batch goes on with the next file, otherwise the raw record is written to the reject file,
+//returns -1 once the conversion of the file is aborted
+int RejectRecord(CONVERTER *cv, long lRecord, const unsigned char *pRecord)
+{
+
+  static const char HexDigits[] = "0123456789ABCDEF";
+  int i;
+  long lRejected;
+  const char *sReason = sDecodeError;
+  const char *sField = cv->Metadata[iDecodeErrorField]->sFieldname;
+
+  sDecodeError = NULL;
+  if (!cv->iRejectRecords) {
+    if (!__atomic_exchange_n(&cv->iAbort, 1, __ATOMIC_RELAXED)) {
+      fprintf(stdout, "%s %s [ERROR]: Record %ld, field %s: %s!\n", GetDateTime(), sUUID, lRecord, sField, sReason);
+    }
+    return -1;
+  }
+  pthread_mutex_lock(&RejectMutex);
+  fprintf(fpRejectFile, "%s|%ld|%s|%s|", cv->sInputFileName, lRecord, sField, sReason);
+  for (i = 0; i < cv->iInputRecordLength; i++) {
+    putc(HexDigits[pRecord[i] >> 4], fpRejectFile);
+    putc(HexDigits[pRecord[i] & 0x0F], fpRejectFile);
+  }
+  putc('\n', fpRejectFile);
+  pthread_mutex_unlock(&RejectMutex);
+  __atomic_fetch_add(&Metrics.lRejected, 1, __ATOMIC_RELAXED);
+
+  lRejected = __atomic_add_fetch(&cv->lRejected, 1, __ATOMIC_RELAXED);
+  if (lRejected <= REJECT_LOGGED_RECORDS) {
+    fprintf(stdout, "%s %s [WARNING]: Record %ld rejected, field %s: %s\n", GetDateTime(), sUUID, lRecord, sField, sReason);
+  }
+  if (lRejected > cv->lMaxErrors) {
+    if (!__atomic_exchange_n(&cv->iAbort, 1, __ATOMIC_RELAXED)) {
+      fprintf(stdout, "%s %s [ERROR]: More than %ld records rejected, conversion of %s aborted!\n", GetDateTime(), sUUID, cv->lMaxErrors, cv->sInputFileName);
+    }
+    return -1;
+  }
+  return 0;
+}
+
+//worker thread: converts chunks in the order they were read
+void *ConversionWorker(void *pArg)
+{
+
+  WORKQUEUE *wq = (WORKQUEUE *) pArg;
+  CHUNK *pChunk;
+  int i;
+  int iLength;
+  THREADMETRICS tm;
+
+  memset(&tm, 0, sizeof(tm));
+  for (;;) {
+    pthread_mutex_lock(&wq->mutex);
+    while (wq->lNextToConvert == wq->lNextToRead && !wq->iEndOfInput) {
+      pthread_cond_wait(&wq->cond, &wq->mutex);
+    }
+    if (wq->lNextToConvert == wq->lNextToRead) {
+      pthread_mutex_unlock(&wq->mutex);
+      FlushThreadMetrics(wq->cv, &tm);
+      break;
+    }
+    pChunk = &wq->Chunks[wq->lNextToConvert % wq->iNumberOfChunks];
+    wq->lNextToConvert++;
+    pthread_mutex_unlock(&wq->mutex);
+
+    if (wq->cv->pInputMap != NULL && wq->cv->iRecordFormat != RECFM_F) {
+      GatherRecords(wq->cv, pChunk->lFirstIndex, pChunk->iRecords, pChunk->pReadBuffer);
+    }
+    //records of a chunk are packed one after the other into its write buffer
+    pChunk->iWriteLength = 0;
+    pChunk->iRejected = 0;
+    pChunk->iWritten = 0;
+    for (i = 0; i < pChunk->iRecords; i++) {
+      iLength = ConvertRecordMetered(wq->cv, &pChunk->pRecords[(size_t) i * wq->cv->iInputRecordLength], &pChunk->pWriteBuffer[pChunk->iWriteLength], &tm);
+      if (iLength >= 0) {
+        pChunk->iWriteLength += iLength;
+        pChunk->iWritten += (iLength > 0);
+      }
+      else if (pChunk->iRejected++, RejectRecord(wq->cv, pChunk->lFirstRecord + i, &pChunk->pRecords[(size_t) i * wq->cv->iInputRecordLength]) != 0) {
+        break;
+      }
+    }
+
+    pthread_mutex_lock(&wq->mutex);
+    pChunk->iState = CHUNK_CONVERTED;
+    pthread_cond_broadcast(&wq->cond);
+    pthread_mutex_unlock(&wq->mutex);
+    COUNT_ALLOCATIONS(wq->cv, 1);
+  }
+  STOP_COUNTING_ALLOCATIONS();
+  return NULL;
+}
+
+//the main thread reads record-aligned chunks and writes the converted chunks in their original order,
+//while the worker threads convert them in between
+int ExecuteParallelConversion(CONVERTER *cv)
+{
+
+  int i;
+  WORKQUEUE wq;
+  CHUNK *pChunk;
+  long lRejected = cv->lRejected;   //rejected records of the chunks written so far
+  pthread_t Threads[MAX_THREADS];
+
+  memset(&wq, 0, sizeof(wq));
+  wq.cv = cv;
+  wq.lRecordsRead = cv->iCurrentRecord;
+  wq.iRecordsPerChunk = (CHUNK_SIZE / cv->iInputRecordLength) + 1;
+  wq.iNumberOfChunks = 2 * cv->iNumberOfThreads;
+  if ((wq.Chunks = (CHUNK *) calloc(wq.iNumberOfChunks, sizeof(CHUNK))) == NULL) {
+    fprintf(stdout, "%s %s [ERROR]: Can't allocate chunk table.\n", GetDateTime(), sUUID);
+    exit(-1);
+  }
+  for (i = 0; i < wq.iNumberOfChunks; i++) {
+    //a mapped input file is converted straight from the mapping, no read buffers required,
+    //variable length records are gathered from it into the read buffers
+    if (cv->pInputMap == NULL || cv->iRecordFormat != RECFM_F) {
+      wq.Chunks[i].pReadBuffer = (unsigned char *) malloc((size_t) wq.iRecordsPerChunk * cv->iInputRecordLength);
+    }
+    wq.Chunks[i].pWriteBuffer = (unsigned char *) malloc((size_t) wq.iRecordsPerChunk * cv->iWriteRecordSize);
+    if (((cv->pInputMap == NULL || cv->iRecordFormat != RECFM_F) && wq.Chunks[i].pReadBuffer == NULL) || wq.Chunks[i].pWriteBuffer == NULL) {
+      fprintf(stdout, "%s %s [ERROR]: Can't allocate chunk buffers.\n", GetDateTime(), sUUID);
+      exit(-1);
+    }
+  }
+  pthread_mutex_init(&wq.mutex, NULL);
+  pthread_cond_init(&wq.cond, NULL);
+
+  fprintf(stdout, "%s %s [INFO]: Threads: %d, records per chunk: %d\n", GetDateTime(), sUUID, cv->iNumberOfThreads, wq.iRecordsPerChunk);
+  for (i = 0; i < cv->iNumberOfThreads; i++) {
+    if (pthread_create(&Threads[i], NULL, ConversionWorker, &wq) != 0) {
+      fprintf(stdout, "%s %s [ERROR]: Can't create worker thread.\n", GetDateTime(), sUUID);
+      exit(-1);
+    }
+  }
+
+  for (;;) {
+    //keep all free chunks filled, a short read means the end of the input file, an aborted conversion reads no more
+    while (!wq.iEndOfInput && wq.lNextToRead - wq.lNextToWrite < wq.iNumberOfChunks) {
+      pChunk = &wq.Chunks[wq.lNextToRead % wq.iNumberOfChunks];
+      //indexed variable length records are gathered by the workers, the reader only hands out ranges of the index
+      if (cv->pInputMap != NULL && cv->iRecordFormat != RECFM_F) {
+        pChunk->iRecords = (cv->lIndexedRecords - cv->lNextRecord < wq.iRecordsPerChunk) ? (int) (cv->lIndexedRecords - cv->lNextRecord) : wq.iRecordsPerChunk;
+        pChunk->lFirstIndex = cv->lNextRecord;
+        pChunk->pRecords = pChunk->pReadBuffer;
+        cv->lNextRecord += pChunk->iRecords;
+        if (pChunk->iRecords > 0) {
+          cv->lInputPosition = IndexedRecordEnd(cv, cv->lNextRecord - 1);
+        }
+      }
+      else {
+        pChunk->pRecords = (unsigned char *) ReadRecords(cv, pChunk->pReadBuffer, wq.iRecordsPerChunk, &pChunk->iRecords);
+      }
+      pChunk->lInputEnd = cv->lInputPosition;
+      pChunk->lFirstRecord = wq.lRecordsRead;
+      wq.lRecordsRead += pChunk->iRecords;
+      pthread_mutex_lock(&wq.mutex);
+      if (pChunk->iRecords > 0) {
+        pChunk->iState = CHUNK_READ;
+        wq.lNextToRead++;
+      }
+      if (pChunk->iRecords < wq.iRecordsPerChunk || __atomic_load_n(&cv->iAbort, __ATOMIC_RELAXED)) {
+        wq.iEndOfInput = 1;
+      }
+      pthread_cond_broadcast(&wq.cond);
+      pthread_mutex_unlock(&wq.mutex);
+    }
+    if (wq.lNextToWrite == wq.lNextToRead) {
+      break;
+    }
+    //write the oldest chunk as soon as it is converted
+    pChunk = &wq.Chunks[wq.lNextToWrite % wq.iNumberOfChunks];
+    pthread_mutex_lock(&wq.mutex);
+    while (pChunk->iState != CHUNK_CONVERTED) {
+      pthread_cond_wait(&wq.cond, &wq.mutex);
+    }
+    pthread_mutex_unlock(&wq.mutex);
+    //parts of a sharded output are closed between chunks
+    if (!__atomic_load_n(&cv->iAbort, __ATOMIC_RELAXED)) {
+      NextPartIfFull(cv);
+      WriteOutput(&cv->Output, pChunk->pWriteBuffer, pChunk->iWriteLength);
+      cv->lPartRecords += pChunk->iWritten;
+      cv->lPartBytes += pChunk->iWriteLength;
+    }
+    cv->iCurrentRecord += pChunk->iRecords;
+    lRejected += pChunk->iRejected;
+    pChunk->iState = CHUNK_FREE;
+    wq.lNextToWrite++;
+    if (cv->iCheckpointSeconds > 0 && !cv->iAbort && MonotonicSeconds() >= cv->dNextCheckpoint) {
+      CheckpointOutput(cv, lRejected, pChunk->lInputEnd);
+    }
+    COUNT_ALLOCATIONS(cv, 1);
+  }
+  STOP_COUNTING_ALLOCATIONS();
+
+  for (i = 0; i < cv->iNumberOfThreads; i++) {
+    pthread_join(Threads[i], NULL);
+  }
+  pthread_cond_destroy(&wq.cond);
+  pthread_mutex_destroy(&wq.mutex);
+  for (i = 0; i < wq.iNumberOfChunks; i++) {
+    free(wq.Chunks[i].pReadBuffer);
+    free(wq.Chunks[i].pWriteBuffer);
+  }
+  free(wq.Chunks);
+  return 0;
+}
+
+//Parquet output: records are collected column by column into row groups, every column chunk is written
+//as one data page, text columns dictionary encoded as long as the dictionary stays small,
+//the file metadata is written in the thrift compact protocol at the end of the file
+
+static void BufferReserve(BYTEBUFFER *b, size_t lLength)
+{
+
+  size_t lCapacity;
+
+  if (b->lLength + lLength <= b->lCapacity) {
+    return;
+  }
+  lCapacity = (b->lCapacity == 0) ? 64 * 1024 : b->lCapacity;
+  while (lCapacity < b->lLength + lLength) {
+    lCapacity *= 2;
+  }
+  if ((b->pData = (unsigned char *) realloc(b->pData, lCapacity)) == NULL) {
+    fprintf(stdout, "%s %s [ERROR]: Can't allocate Parquet buffer.\n", GetDateTime(), sUUID);
+    exit(-1);
+  }
+  b->lCapacity = lCapacity;
+}
+
+static void BufferPut(BYTEBUFFER *b, const void *pData, size_t lLength)
+{
+  BufferReserve(b, lLength);
+  memcpy(&b->pData[b->lLength], pData, lLength);
+  b->lLength += lLength;
+}
+
+static void BufferPutByte(BYTEBUFFER *b, unsigned char c)
+{
+  BufferReserve(b, 1);
+  b->pData[b->lLength++] = c;
+}
+
+static void BufferPutInt32(BYTEBUFFER *b, unsigned int iValue)
+{
+
+  unsigned char s[4];
+
+  s[0] = iValue;
+  s[1] = iValue >> 8;
+  s[2] = iValue >> 16;
+  s[3] = iValue >> 24;
+  BufferPut(b, s, 4);
+}
+
+static void BufferPutVarint(BYTEBUFFER *b, unsigned long lValue)
+{
+  while (lValue >= 0x80) {
+    BufferPutByte(b, (unsigned char) (lValue | 0x80));
+    lValue >>= 7;
+  }
+  BufferPutByte(b, (unsigned char) lValue);
+}
+
+//thrift compact protocol, field ids are written as delta to the previous field of the struct
+static void ThriftField(PARQUETWRITER *pw, BYTEBUFFER *b, int iId, int iType)
+{
+
+  int iDelta = iId - pw->LastFieldIds[pw->iFieldDepth];
+
+  if (iDelta > 0 && iDelta <= 15) {
+    BufferPutByte(b, (unsigned char) ((iDelta << 4) | iType));
+  }
+  else {
+    BufferPutByte(b, (unsigned char) iType);
+    BufferPutVarint(b, (unsigned long) ((iId << 1) ^ (iId >> 15)));
+  }
+  pw->LastFieldIds[pw->iFieldDepth] = iId;
+}
+
+static void ThriftI32(PARQUETWRITER *pw, BYTEBUFFER *b, int iId, int iValue)
+{
+  ThriftField(pw, b, iId, THRIFT_I32);
+  BufferPutVarint(b, ((unsigned int) iValue << 1) ^ (unsigned int) (iValue >> 31));
+}
+
+static void ThriftI64(PARQUETWRITER *pw, BYTEBUFFER *b, int iId, long lValue)
+{
+  ThriftField(pw, b, iId, THRIFT_I64);
+  BufferPutVarint(b, ((unsigned long) lValue << 1) ^ (unsigned long) (lValue >> 63));
+}
+
+static void ThriftString(PARQUETWRITER *pw, BYTEBUFFER *b, int iId, const char *s)
+{
+  ThriftField(pw, b, iId, THRIFT_BINARY);
+  BufferPutVarint(b, strlen(s));
+  BufferPut(b, s, strlen(s));
+}
+
+//iId 0: a struct inside a list, it has no field header
+static void ThriftStructBegin(PARQUETWRITER *pw, BYTEBUFFER *b, int iId)
+{
+  if (iId > 0) {
+    ThriftField(pw, b, iId, THRIFT_STRUCT);
+  }
+  pw->LastFieldIds[++pw->iFieldDepth] = 0;
+}
+
+static void ThriftStructEnd(PARQUETWRITER *pw, BYTEBUFFER *b)
+{
+  BufferPutByte(b, THRIFT_STOP);
+  pw->iFieldDepth--;
+}
+
+static void ThriftList(PARQUETWRITER *pw, BYTEBUFFER *b, int iId, int iElementType, int iSize)
+{
+  ThriftField(pw, b, iId, THRIFT_LIST);
+  if (iSize < 15) {
+    BufferPutByte(b, (unsigned char) ((iSize << 4) | iElementType));
+  }
+  else {
+    BufferPutByte(b, (unsigned char) (0xF0 | iElementType));
+    BufferPutVarint(b, iSize);
+  }
+}
+
+//RLE/bit-packing hybrid: all values bit-packed in groups of 8, the last group padded with zeros
+static void PutBitPacked(BYTEBUFFER *b, const unsigned int *pValues, int iCount, int iBitWidth)
+{
+
+  int i;
+  int iBits = 0;
+  unsigned long lBuffer = 0;
+  int iGroups = (iCount + 7) / 8;
+
+  BufferPutVarint(b, ((unsigned long) iGroups << 1) | 1);
+  BufferReserve(b, (size_t) iGroups * iBitWidth + 8);
+  for (i = 0; i < iGroups * 8; i++) {
+    lBuffer |= (unsigned long) ((i < iCount) ? pValues[i] : 0) << iBits;
+    iBits += iBitWidth;
+    while (iBits >= 8) {
+      b->pData[b->lLength++] = (unsigned char) lBuffer;
+      lBuffer >>= 8;
+      iBits -= 8;
+    }
+  }
+}
+
+//definition levels of an optional column (bit width 1), prefixed by their length
+static void PutDefinitionLevels(PARQUETWRITER *pw, PARQUETCOLUMN *pc)
+{
+
+  int i;
+  size_t lStart;
+
+  BufferPutInt32(&pw->Page, 0);
+  lStart = pw->Page.lLength;
+  if (pc->iNulls == 0) {
+    //a single run of ones
+    BufferPutVarint(&pw->Page, (unsigned long) pw->iRows << 1);
+    BufferPutByte(&pw->Page, 1);
+  }
+  else {
+    for (i = 0; i < pw->iRows; i++) {
+      pw->Indices[i] = pc->pDefined[i];
+    }
+    PutBitPacked(&pw->Page, pw->Indices, pw->iRows, 1);
+  }
+  i = pw->Page.lLength - lStart;
+  memcpy(&pw->Page.pData[lStart - 4], &i, 4);
+}
+
+//dictionary of a text column, fails if it gets too large to pay off
+static int BuildDictionary(PARQUETWRITER *pw, PARQUETCOLUMN *pc, int *piEntries)
+{
+
+  int i, j;
+  int iEntries = 0;
+  unsigned int iHash;
+  unsigned int iLength;
+  const unsigned char *pValue;
+  const unsigned char *pEntry;
+  const unsigned int iMask = 2 * PARQUET_DICTIONARY_ENTRIES - 1;
+
+  memset(pw->HashTable, 0, 2 * PARQUET_DICTIONARY_ENTRIES * sizeof(int));
+  pw->Dictionary.lLength = 0;
+  for (i = 0; i < pw->iRows; i++) {
+    pValue = &pc->Values.pData[pc->pOffsets[i]];
+    memcpy(&iLength, pValue, 4);
+    iHash = 2166136261u;
+    for (j = 0; j < iLength + 4; j++) {
+      iHash = (iHash ^ pValue[j]) * 16777619u;
+    }
+    for (iHash &= iMask; pw->HashTable[iHash] != 0; iHash = (iHash + 1) & iMask) {
+      pEntry = &pc->Values.pData[pw->DictionaryOffsets[pw->HashTable[iHash] - 1]];
+      if (memcmp(pEntry, pValue, iLength + 4) == 0) {
+        break;
+      }
+    }
+    if (pw->HashTable[iHash] == 0) {
+      if (iEntries == PARQUET_DICTIONARY_ENTRIES || pw->Dictionary.lLength + iLength + 4 > PARQUET_DICTIONARY_BYTES) {
+        return -1;
+      }
+      pw->DictionaryOffsets[iEntries++] = pc->pOffsets[i];
+      pw->HashTable[iHash] = iEntries;
+      BufferPut(&pw->Dictionary, pValue, iLength + 4);
+    }
+    pw->Indices[i] = pw->HashTable[iHash] - 1;
+  }
+  *piEntries = iEntries;
+  return 0;
+}
+
+//compress the page if requested and write it with its header, returns the bytes written
+static long WriteParquetPage(CONVERTER *cv, int iPageType, int iValues, int iEncoding, long *plUncompressed)
+{
+
+  PARQUETWRITER *pw = cv->pParquet;
+  const unsigned char *pPage = pw->Page.pData;
+  size_t lPageLength = pw->Page.lLength;
+  long lWritten;
+#ifdef HAVE_ZSTD
+  size_t lResult;
+#endif
+
+  if (pw->iCompression == COMPRESS_GZIP) {
+    pw->Compressed.lLength = 0;
+    BufferReserve(&pw->Compressed, compressBound(lPageLength) + 32);
+    deflateReset(&pw->zs);
+    pw->zs.next_in = pw->Page.pData;
+    pw->zs.avail_in = lPageLength;
+    pw->zs.next_out = pw->Compressed.pData;
+    pw->zs.avail_out = pw->Compressed.lCapacity;
+    if (deflate(&pw->zs, Z_FINISH) != Z_STREAM_END) {
+      fprintf(stdout, "%s %s [ERROR]: gzip compression of a Parquet page failed.\n", GetDateTime(), sUUID);
+      exit(-1);
+    }
+    pPage = pw->Compressed.pData;
+    lPageLength = pw->zs.total_out;
+  }
+#ifdef HAVE_ZSTD
+  else if (pw->iCompression == COMPRESS_ZSTD) {
+    pw->Compressed.lLength = 0;
+    BufferReserve(&pw->Compressed, ZSTD_compressBound(lPageLength));
+    lResult = ZSTD_compressCCtx(pw->cctx, pw->Compressed.pData, pw->Compressed.lCapacity, pw->Page.pData, lPageLength, COMPRESS_LEVEL_ZSTD);
+    if (ZSTD_isError(lResult)) {
+      fprintf(stdout, "%s %s [ERROR]: zstd compression of a Parquet page failed: %s\n", GetDateTime(), sUUID, ZSTD_getErrorName(lResult));
+      exit(-1);
+    }
+    pPage = pw->Compressed.pData;
+    lPageLength = lResult;
+  }
+#endif
+
+  //PageHeader
+  pw->Header.lLength = 0;
+  ThriftStructBegin(pw, &pw->Header, 0);
+  ThriftI32(pw, &pw->Header, 1, iPageType);
+  ThriftI32(pw, &pw->Header, 2, (int) pw->Page.lLength);
+  ThriftI32(pw, &pw->Header, 3, (int) lPageLength);
+  if (iPageType == PAGE_DATA) {
+    ThriftStructBegin(pw, &pw->Header, 5);
+    ThriftI32(pw, &pw->Header, 1, iValues);
+    ThriftI32(pw, &pw->Header, 2, iEncoding);
+    ThriftI32(pw, &pw->Header, 3, ENCODING_RLE);
+    ThriftI32(pw, &pw->Header, 4, ENCODING_RLE);
+    ThriftStructEnd(pw, &pw->Header);
+  }
+  else {
+    ThriftStructBegin(pw, &pw->Header, 7);
+    ThriftI32(pw, &pw->Header, 1, iValues);
+    ThriftI32(pw, &pw->Header, 2, iEncoding);
+    ThriftStructEnd(pw, &pw->Header);
+  }
+  ThriftStructEnd(pw, &pw->Header);
+
+  WriteOutput(&cv->Output, pw->Header.pData, pw->Header.lLength);
+  WriteOutput(&cv->Output, pPage, lPageLength);
+  lWritten = pw->Header.lLength + lPageLength;
+  *plUncompressed += pw->Header.lLength + pw->Page.lLength;
+  pw->lOffset += lWritten;
+  return lWritten;
+}
+
+//write the chunk of a column of the current row group: dictionary page (if any) and data page
+static void WriteParquetColumnChunk(CONVERTER *cv, PARQUETCOLUMN *pc, PARQUETCHUNK *pChunk)
+{
+
+  int iEntries;
+  int iBitWidth;
+  int iEncoding = ENCODING_PLAIN;
+  PARQUETWRITER *pw = cv->pParquet;
+
+  pChunk->lFileOffset = pw->lOffset;
+  pChunk->lDictionaryPageOffset = -1;
+  pChunk->lUncompressedSize = 0;
+  pChunk->lCompressedSize = 0;
+  pChunk->lValues = pw->iRows;
+
+  if (pc->iType == PARQUET_BYTE_ARRAY && BuildDictionary(pw, pc, &iEntries) == 0) {
+    pChunk->lDictionaryPageOffset = pw->lOffset;
+    pw->Page.lLength = 0;
+    BufferPut(&pw->Page, pw->Dictionary.pData, pw->Dictionary.lLength);
+    pChunk->lCompressedSize += WriteParquetPage(cv, PAGE_DICTIONARY, iEntries, ENCODING_PLAIN, &pChunk->lUncompressedSize);
+    iEncoding = ENCODING_RLE_DICTIONARY;
+  }
+
+  pChunk->lDataPageOffset = pw->lOffset;
+  pw->Page.lLength = 0;
+  if (pc->iOptional) {
+    PutDefinitionLevels(pw, pc);
+  }
+  if (iEncoding == ENCODING_RLE_DICTIONARY) {
+    for (iBitWidth = 1; iBitWidth < 32 && (1u << iBitWidth) < (unsigned int) iEntries; iBitWidth++)
+      ;
+    BufferPutByte(&pw->Page, (unsigned char) iBitWidth);
+    PutBitPacked(&pw->Page, pw->Indices, pw->iRows, iBitWidth);
+  }
+  else {
+    BufferPut(&pw->Page, pc->Values.pData, pc->Values.lLength);
+  }
+  pChunk->lCompressedSize += WriteParquetPage(cv, PAGE_DATA, pw->iRows, iEncoding, &pChunk->lUncompressedSize);
+
+  //the column starts over with the next row group
+  pc->Values.lLength = 0;
+  pc->iNulls = 0;
+}
+
+//write the row group collected so far
+static void FlushParquetRowGroup(CONVERTER *cv)
+{
+
+  int i;
+  long lSize = 0;
+  PARQUETWRITER *pw = cv->pParquet;
+  PARQUETCHUNK *pChunks;
+
+  if (pw->iRows == 0) {
+    return;
+  }
+  //the metadata arrays double when full instead of growing by every row group
+  if (pw->iRowGroups == pw->iRowGroupCapacity) {
+#ifdef E2A_COUNT_ALLOCATIONS
+    long *pCounter = pSteadyStateAllocations;
+
+    STOP_COUNTING_ALLOCATIONS();
+#endif
+    pw->iRowGroupCapacity = (pw->iRowGroupCapacity == 0) ? PARQUET_ROW_GROUP_CAPACITY : 2 * pw->iRowGroupCapacity;
+    pw->Chunks = (PARQUETCHUNK *) realloc(pw->Chunks, (size_t) pw->iRowGroupCapacity * pw->iColumns * sizeof(PARQUETCHUNK));
+    pw->RowGroupRows = (long *) realloc(pw->RowGroupRows, pw->iRowGroupCapacity * sizeof(long));
+    pw->RowGroupSizes = (long *) realloc(pw->RowGroupSizes, pw->iRowGroupCapacity * sizeof(long));
+    if (pw->Chunks == NULL || pw->RowGroupRows == NULL || pw->RowGroupSizes == NULL) {
+      fprintf(stdout, "%s %s [ERROR]: Can't allocate Parquet row group metadata.\n", GetDateTime(), sUUID);
+      exit(-1);
+    }
+#ifdef E2A_COUNT_ALLOCATIONS
+    pSteadyStateAllocations = pCounter;
+#endif
+  }
+  pChunks = &pw->Chunks[(size_t) pw->iRowGroups * pw->iColumns];
+  for (i = 0; i < pw->iColumns; i++) {
+    WriteParquetColumnChunk(cv, &pw->Columns[i], &pChunks[i]);
+    lSize += pChunks[i].lUncompressedSize;
+  }
+  pw->RowGroupRows[pw->iRowGroups] = pw->iRows;
+  pw->RowGroupSizes[pw->iRowGroups] = lSize;
+  pw->iRowGroups++;
+  pw->lTotalRows += pw->iRows;
+  pw->iRows = 0;
+}
+
+//map the fields to Parquet columns like CreateIngestionMetadataFile() maps them to ingestion types,
+//the physical types of decimals are chosen by their stored digits, so no value can overflow
+int OpenParquet(CONVERTER *cv)
+{
+
+  int i;
+  int iMaxLength = 0;
+  PARQUETWRITER *pw;
+  PARQUETCOLUMN *pc;
+  METADATARECORD *pField;
+
+  if ((pw = (PARQUETWRITER *) calloc(1, sizeof(PARQUETWRITER))) == NULL
+      || (pw->Columns = (PARQUETCOLUMN *) calloc(cv->iNumberOfColumns, sizeof(PARQUETCOLUMN))) == NULL) {
+    fprintf(stdout, "%s %s [ERROR]: Can't allocate Parquet writer.\n", GetDateTime(), sUUID);
+    exit(-1);
+  }
+  cv->pParquet = pw;
+  pw->iColumns = cv->iNumberOfColumns;
+  pw->iRowGroupSize = cv->iRowGroupSize;
+  pw->iCompression = cv->iCompression;
+  for (i = 0; i < pw->iColumns; i++) {
+    pc = &pw->Columns[i];
+    pField = cv->Metadata[cv->Columns[i]];
+    pc->pField = pField;
+    switch (pField->cDatatype) {
+      case 'A':
+      case 'T':
+        pc->iType = PARQUET_BYTE_ARRAY;
+        pc->iLogicalType = LOGICAL_STRING;
+        break;
+      case 'L':
+        pc->iType = PARQUET_INT32;
+        pc->iLogicalType = LOGICAL_DATE;
+        //dates that can't be read are null
+        pc->iOptional = 1;
+        break;
+      case 'P':
+      case 'S':
+        pc->iScale = pField->iPrecision;
+        pc->iPrecision = (pField->iDigits > pField->iPrecision) ? pField->iDigits : pField->iPrecision;
+        if (pc->iPrecision > MAX_DIGITS_INT128 || pField->iDecimalPath == DECIMAL_DIGITS) {
+          //wider than DECIMAL, delivered as text
+          pc->iType = PARQUET_BYTE_ARRAY;
+          pc->iLogicalType = LOGICAL_STRING;
+        }
+        else if (pc->iScale == 0 && pc->iPrecision <= MAX_DIGITS_LONG) {
+          pc->iType = (pc->iPrecision < 10) ? PARQUET_INT32 : PARQUET_INT64;
+          pc->iLogicalType = LOGICAL_NONE;
+        }
+        else {
+          pc->iType = (pc->iPrecision < 10) ? PARQUET_INT32 : (pc->iPrecision <= MAX_DIGITS_LONG) ? PARQUET_INT64 : PARQUET_FIXED_LEN_BYTE_ARRAY;
+          pc->iTypeLength = (pc->iType == PARQUET_FIXED_LEN_BYTE_ARRAY) ? 16 : 0;
+          pc->iLogicalType = LOGICAL_DECIMAL;
+        }
+        break;
+      //binary integers stay integers unless scaled or unsigned 8 bytes, those are DECIMAL
+      case 'B':
+        pc->iScale = pField->iPrecision;
+        pc->iPrecision = (pField->iDigits > pField->iPrecision) ? pField->iDigits : pField->iPrecision;
+        if (pc->iScale == 0 && pField->iDigits <= MAX_DIGITS_LONG + 1) {
+          pc->iType = (pField->iDigits < 10 || (pField->iDigits == 10 && !pField->iUnsigned)) ? PARQUET_INT32 : PARQUET_INT64;
+          pc->iLogicalType = LOGICAL_NONE;
+        }
+        else {
+          pc->iType = (pc->iPrecision < 10) ? PARQUET_INT32 : (pc->iPrecision <= MAX_DIGITS_LONG) ? PARQUET_INT64 : PARQUET_FIXED_LEN_BYTE_ARRAY;
+          pc->iTypeLength = (pc->iType == PARQUET_FIXED_LEN_BYTE_ARRAY) ? 16 : 0;
+          pc->iLogicalType = LOGICAL_DECIMAL;
+        }
+        break;
+      //hexadecimal floats reach beyond the exponents of a 4 byte float
+      case 'F':
+      case 'H':
+        pc->iType = (pField->cDatatype == 'F' && pField->iInputFieldLength == 4) ? PARQUET_FLOAT : PARQUET_DOUBLE;
+        pc->iLogicalType = LOGICAL_NONE;
+        break;
+    }
+    if ((pc->pOffsets = (int *) malloc(pw->iRowGroupSize * sizeof(int))) == NULL
+        || (pc->iOptional && (pc->pDefined = (unsigned char *) malloc(pw->iRowGroupSize)) == NULL)) {
+      fprintf(stdout, "%s %s [ERROR]: Can't allocate Parquet column.\n", GetDateTime(), sUUID);
+      exit(-1);
+    }
+    if (pField->iInputFieldLength > iMaxLength) {
+      iMaxLength = pField->iInputFieldLength;
+    }
+  }
+  //text in UTF-8 takes up to two bytes per character, decimals as text their digits, sign and point
+  pw->pScratch = (unsigned char *) malloc(2 * iMaxLength + 2 * MAX_DIGITS_INT128 + 8 + cv->iWriteRecordSize);
+  pw->HashTable = (int *) malloc(2 * PARQUET_DICTIONARY_ENTRIES * sizeof(int));
+  pw->DictionaryOffsets = (int *) malloc(PARQUET_DICTIONARY_ENTRIES * sizeof(int));
+  pw->Indices = (unsigned int *) malloc(pw->iRowGroupSize * sizeof(unsigned int));
+  if (pw->pScratch == NULL || pw->HashTable == NULL || pw->DictionaryOffsets == NULL || pw->Indices == NULL) {
+    fprintf(stdout, "%s %s [ERROR]: Can't allocate Parquet writer.\n", GetDateTime(), sUUID);
+    exit(-1);
+  }
+  //pages are compressed with the codec of --compress, the file itself is not
+  if (pw->iCompression == COMPRESS_GZIP && deflateInit2(&pw->zs, COMPRESS_LEVEL_GZIP, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    fprintf(stdout, "%s %s [ERROR]: Can't initialize gzip compression.\n", GetDateTime(), sUUID);
+    exit(-1);
+  }
+#ifdef HAVE_ZSTD
+  if (pw->iCompression == COMPRESS_ZSTD && (pw->cctx = ZSTD_createCCtx()) == NULL) {
+    fprintf(stdout, "%s %s [ERROR]: Can't initialize zstd compression.\n", GetDateTime(), sUUID);
+    exit(-1);
+  }
+#endif
+  WriteOutput(&cv->Output, (const unsigned char *) "PAR1", 4);
+  pw->lOffset = 4;
+  fprintf(stdout, "%s %s [INFO]: Parquet output: %d columns, %d rows per row group\n", GetDateTime(), sUUID, pw->iColumns, pw->iRowGroupSize);
+  return 0;
+}
+
+//days since 1970-01-01 of a valid date, March based years put the leap day at the end
+static int DaysFromCivil(int iYear, int iMonth, int iDay)
+{
+
+  int iEra;
+
+  iYear -= (iMonth <= 2);
+  iEra = (iYear >= 0 ? iYear : iYear - 399) / 400;
+  iYear -= iEra * 400;
+  return iEra * 146097 + iYear * 365 + iYear / 4 - iYear / 100 + (153 * (iMonth + (iMonth > 2 ? -3 : 9)) + 2) / 5 + iDay - 1 - 719468;
+}
+
+//parse a date field of the record in the format of the metadata, text is translated into pScratch
+static int DecodeDateField(const CONVERTER *cv, const METADATARECORD *pField, const unsigned char *pRecord, unsigned char *pScratch, int *piDays)
+{
+
+  int iYear = 0, iMonth = 0, iDay = 0;
+  int iDate;
+  TEXTSCAN ts;
+
+  if (IS_PACKED_DATE(pField)) {
+    iDate = ParsePackedDate(&pRecord[pField->iInputPosition], &iYear, &iMonth, &iDay);
+  }
+  else {
+    convert(pScratch, &pRecord[pField->iInputPosition], pField->iInputFieldLength, FieldCodePage(cv, pField)->pTable, &ts);
+    iDate = (ts.iFirst < 0) ? DATE_NULL : ParseDate((const char *) &pScratch[ts.iFirst], ts.iLast - ts.iFirst + 1, pField->iDateFormat, &iYear, &iMonth, &iDay);
+  }
+  if (iDate == DATE_VALID) {
+    *piDays = DaysFromCivil(iYear, iMonth, iDay);
+  }
+  return iDate;
+}
+
+//append a text value, the code page characters (ISO-8859) are written in UTF-8, cEuro as the euro sign
+static void PutParquetText(PARQUETCOLUMN *pc, int iRow, const unsigned char *pText, int iLength, unsigned char cEuro)
+{
+
+  unsigned int iUtf8Length;
+
+  pc->pOffsets[iRow] = pc->Values.lLength;
+  BufferReserve(&pc->Values, 4 + (cEuro ? UTF8_EURO_LENGTH : 2) * (size_t) iLength);
+  memcpy(&pc->Values.pData[pc->Values.lLength + 4], pText, iLength);
+  iUtf8Length = ExpandUtf8((char *) &pc->Values.pData[pc->Values.lLength + 4], iLength, cEuro);
+  memcpy(&pc->Values.pData[pc->Values.lLength], &iUtf8Length, 4);
+  pc->Values.lLength += 4 + iUtf8Length;
+}
+
+//decode a record into the columns of the current row group, returns 1 if the record is filtered out
+int ParquetAddRecord(CONVERTER *cv, const unsigned char *pRecord)
+{
+
+  int i, j;
+  int iDays;
+  int iValue;
+  long lValue;
+  __int128 llValue;
+  float fValue;
+  double dValue;
+  unsigned char sDecimal[16];
+  PARQUETWRITER *pw = cv->pParquet;
+  PARQUETCOLUMN *pc;
+  METADATARECORD *pField;
+  const char *pInput;
+  TRIMBUFFER tb;
+  TEXTSCAN ts;
+
+  if (cv->iFilters > 0 && (i = FilterRecord(cv, pRecord)) <= 0) {
+    return (i == 0) ? 1 : -1;
+  }
+  //the columns are filled one after the other, so a record is checked before the first one is touched
+  for (i = 0; i < pw->iColumns; i++) {
+    pField = pw->Columns[i].pField;
+    if (pField->cDatatype == 'P' || pField->cDatatype == 'S') {
+      if ((sDecodeError = CheckDecimalNibbles(&pRecord[pField->iInputPosition], pField->iInputFieldLength, pField->cDatatype == 'S')) != NULL) {
+        iDecodeErrorField = cv->Columns[i];
+        return -1;
+      }
+    }
+    else if (pField->cDatatype == 'F') {
+      unfloat((const char *) &pRecord[pField->iInputPosition], pField->iInputFieldLength);
+      if (sDecodeError != NULL) {
+        iDecodeErrorField = cv->Columns[i];
+        return -1;
+      }
+    }
+    else if (pField->cDatatype == 'L' && cv->iRejectDates && DecodeDateField(cv, pField, pRecord, pw->pScratch, &iDays) == DATE_INVALID) {
+      sDecodeError = "invalid date";
+      iDecodeErrorField = cv->Columns[i];
+      return -1;
+    }
+  }
+  for (i = 0; i < pw->iColumns; i++) {
+    pc = &pw->Columns[i];
+    pField = pc->pField;
+    pInput = (const char *) &pRecord[pField->iInputPosition];
+    switch (pField->cDatatype) {
+      //text is trimmed and filtered like in the text output
+      case 'A':
+      case 'T':
+        convert(pw->pScratch, (const unsigned char *) pInput, pField->iInputFieldLength, FieldCodePage(cv, pField)->pTable, &ts);
+        trim((char *) pw->pScratch, (char *) pw->pScratch, pField->iInputFieldLength, &tb, &ts);
+        PutParquetText(pc, pw->iRows, (const unsigned char *) tb.pBuffer, tb.iLength, FieldCodePage(cv, pField)->cEuro);
+        break;
+      case 'L':
+        if (DecodeDateField(cv, pField, pRecord, pw->pScratch, &iDays) == DATE_VALID) {
+          pc->pDefined[pw->iRows] = 1;
+          BufferPutInt32(&pc->Values, (unsigned int) iDays);
+        }
+        else {
+          pc->pDefined[pw->iRows] = 0;
+          pc->iNulls++;
+        }
+        break;
+      case 'P':
+      case 'S':
+        if (pc->iType == PARQUET_BYTE_ARRAY) {
+          j = FormatDecimalDigits((char *) pw->pScratch, pInput, pField->iInputFieldLength, pField->cDatatype == 'S', pField->iPrecision);
+          PutParquetText(pc, pw->iRows, pw->pScratch, j, 0);
+        }
+        //up to 18 digits the decimal path is DECIMAL_LONG
+        else if (pc->iType == PARQUET_INT32 || pc->iType == PARQUET_INT64) {
+          lValue = (pField->cDatatype == 'P') ? unpack(pInput, pField->iInputFieldLength) : unzone(pInput, pField->iInputFieldLength);
+          if (pc->iType == PARQUET_INT32) {
+            iValue = (int) lValue;
+            BufferPut(&pc->Values, &iValue, 4);
+          }
+          else {
+            BufferPut(&pc->Values, &lValue, 8);
+          }
+        }
+        else {
+          if (pField->iDecimalPath == DECIMAL_LONG) {
+            llValue = (pField->cDatatype == 'P') ? unpack(pInput, pField->iInputFieldLength) : unzone(pInput, pField->iInputFieldLength);
+          }
+          else {
+            llValue = (pField->cDatatype == 'P') ? unpack128(pInput, pField->iInputFieldLength) : unzone128(pInput, pField->iInputFieldLength);
+          }
+          //fixed length byte arrays hold the unscaled value big-endian in two's complement
+          for (j = 15; j >= 0; j--) {
+            sDecimal[j] = (unsigned char) llValue;
+            llValue >>= 8;
+          }
+          BufferPut(&pc->Values, sDecimal, 16);
+        }
+        break;
+      case 'B':
+        llValue = pField->iUnsigned ? (__int128) unbinaryu(pInput, pField->iInputFieldLength) : unbinary(pInput, pField->iInputFieldLength);
+        if (pc->iType == PARQUET_INT32) {
+          iValue = (int) llValue;
+          BufferPut(&pc->Values, &iValue, 4);
+        }
+        else if (pc->iType == PARQUET_INT64) {
+          lValue = (long) llValue;
+          BufferPut(&pc->Values, &lValue, 8);
+        }
+        else {
+          for (j = 15; j >= 0; j--) {
+            sDecimal[j] = (unsigned char) llValue;
+            llValue >>= 8;
+          }
+          BufferPut(&pc->Values, sDecimal, 16);
+        }
+        break;
+      case 'F':
+      case 'H':
+        dValue = (pField->cDatatype == 'F') ? unfloat(pInput, pField->iInputFieldLength) : unhexfloat(pInput, pField->iInputFieldLength);
+        if (pc->iType == PARQUET_FLOAT) {
+          fValue = (float) dValue;
+          BufferPut(&pc->Values, &fValue, 4);
+        }
+        else {
+          BufferPut(&pc->Values, &dValue, 8);
+        }
+        break;
+    }
+  }
+  if (++pw->iRows == pw->iRowGroupSize) {
+    FlushParquetRowGroup(cv);
+  }
+  return 0;
+}
+
+//write the last row group and the file metadata
+int CloseParquet(CONVERTER *cv)
+{
+
+  int i, j;
+  PARQUETWRITER *pw = cv->pParquet;
+  PARQUETCOLUMN *pc;
+  PARQUETCHUNK *pChunk;
+  BYTEBUFFER *b = &pw->Header;
+
+  FlushParquetRowGroup(cv);
+
+  //FileMetaData
+  b->lLength = 0;
+  ThriftStructBegin(pw, b, 0);
+  ThriftI32(pw, b, 1, 1);
+  //schema: the root and a flat list of columns
+  ThriftList(pw, b, 2, THRIFT_STRUCT, pw->iColumns + 1);
+  ThriftStructBegin(pw, b, 0);
+  ThriftString(pw, b, 4, "schema");
+  ThriftI32(pw, b, 5, pw->iColumns);
+  ThriftStructEnd(pw, b);
+  for (i = 0; i < pw->iColumns; i++) {
+    pc = &pw->Columns[i];
+    ThriftStructBegin(pw, b, 0);
+    ThriftI32(pw, b, 1, pc->iType);
+    if (pc->iType == PARQUET_FIXED_LEN_BYTE_ARRAY) {
+      ThriftI32(pw, b, 2, pc->iTypeLength);
+    }
+    ThriftI32(pw, b, 3, pc->iOptional ? 1 : 0);
+    ThriftString(pw, b, 4, pc->pField->sFieldname);
+    switch (pc->iLogicalType) {
+      case LOGICAL_STRING:
+        ThriftI32(pw, b, 6, 0);
+        ThriftStructBegin(pw, b, 10);
+        ThriftStructBegin(pw, b, LOGICAL_STRING);
+        ThriftStructEnd(pw, b);
+        ThriftStructEnd(pw, b);
+        break;
+      case LOGICAL_DATE:
+        ThriftI32(pw, b, 6, 6);
+        ThriftStructBegin(pw, b, 10);
+        ThriftStructBegin(pw, b, LOGICAL_DATE);
+        ThriftStructEnd(pw, b);
+        ThriftStructEnd(pw, b);
+        break;
+      case LOGICAL_DECIMAL:
+        ThriftI32(pw, b, 6, 5);
+        ThriftI32(pw, b, 7, pc->iScale);
+        ThriftI32(pw, b, 8, pc->iPrecision);
+        ThriftStructBegin(pw, b, 10);
+        ThriftStructBegin(pw, b, LOGICAL_DECIMAL);
+        ThriftI32(pw, b, 1, pc->iScale);
+        ThriftI32(pw, b, 2, pc->iPrecision);
+        ThriftStructEnd(pw, b);
+        ThriftStructEnd(pw, b);
+        break;
+    }
+    ThriftStructEnd(pw, b);
+  }
+  ThriftI64(pw, b, 3, pw->lTotalRows);
+  ThriftList(pw, b, 4, THRIFT_STRUCT, pw->iRowGroups);
+  for (j = 0; j < pw->iRowGroups; j++) {
+    //RowGroup
+    ThriftStructBegin(pw, b, 0);
+    ThriftList(pw, b, 1, THRIFT_STRUCT, pw->iColumns);
+    for (i = 0; i < pw->iColumns; i++) {
+      pc = &pw->Columns[i];
+      pChunk = &pw->Chunks[(size_t) j * pw->iColumns + i];
+      //ColumnChunk
+      ThriftStructBegin(pw, b, 0);
+      ThriftI64(pw, b, 2, pChunk->lFileOffset);
+      //ColumnMetaData
+      ThriftStructBegin(pw, b, 3);
+      ThriftI32(pw, b, 1, pc->iType);
+      if (pChunk->lDictionaryPageOffset >= 0) {
+        ThriftList(pw, b, 2, THRIFT_I32, 3);
+        BufferPutVarint(b, ENCODING_PLAIN << 1);
+        BufferPutVarint(b, ENCODING_RLE << 1);
+        BufferPutVarint(b, ENCODING_RLE_DICTIONARY << 1);
+      }
+      else {
+        ThriftList(pw, b, 2, THRIFT_I32, 2);
+        BufferPutVarint(b, ENCODING_PLAIN << 1);
+        BufferPutVarint(b, ENCODING_RLE << 1);
+      }
+      ThriftList(pw, b, 3, THRIFT_BINARY, 1);
+      BufferPutVarint(b, strlen(pc->pField->sFieldname));
+      BufferPut(b, pc->pField->sFieldname, strlen(pc->pField->sFieldname));
+      ThriftI32(pw, b, 4, (pw->iCompression == COMPRESS_GZIP) ? CODEC_GZIP : (pw->iCompression == COMPRESS_ZSTD) ? CODEC_ZSTD : CODEC_UNCOMPRESSED);
+      ThriftI64(pw, b, 5, pChunk->lValues);
+      ThriftI64(pw, b, 6, pChunk->lUncompressedSize);
+      ThriftI64(pw, b, 7, pChunk->lCompressedSize);
+      ThriftI64(pw, b, 9, pChunk->lDataPageOffset);
+      if (pChunk->lDictionaryPageOffset >= 0) {
+        ThriftI64(pw, b, 11, pChunk->lDictionaryPageOffset);
+      }
+      ThriftStructEnd(pw, b);
+      ThriftStructEnd(pw, b);
+    }
+    ThriftI64(pw, b, 2, pw->RowGroupSizes[j]);
+    ThriftI64(pw, b, 3, pw->RowGroupRows[j]);
+    ThriftStructEnd(pw, b);
+  }
+  ThriftString(pw, b, 6, "e2a version " E2A_VERSION);
+  ThriftStructEnd(pw, b);
+  BufferPutInt32(b, (unsigned int) b->lLength);
+  BufferPut(b, "PAR1", 4);
+  WriteOutput(&cv->Output, b->pData, b->lLength);
+  pw->lOffset += b->lLength;
+  fprintf(stdout, "%s %s [INFO]: Parquet file: %ld rows in %d row groups, %ld bytes\n", GetDateTime(), sUUID, pw->lTotalRows, pw->iRowGroups, pw->lOffset);
+
+  //release the writer
+  if (pw->iCompression == COMPRESS_GZIP) {
+    deflateEnd(&pw->zs);
+  }
+#ifdef HAVE_ZSTD
+  if (pw->cctx != NULL) {
+    ZSTD_freeCCtx(pw->cctx);
+  }
+#endif
+  for (i = 0; i < pw->iColumns; i++) {
+    free(pw->Columns[i].Values.pData);
+    free(pw->Columns[i].pOffsets);
+    free(pw->Columns[i].pDefined);
+  }
+  free(pw->Columns);
+  free(pw->Chunks);
+  free(pw->RowGroupRows);
+  free(pw->RowGroupSizes);
+  free(pw->Page.pData);
+  free(pw->Compressed.pData);
+  free(pw->Header.pData);
+  free(pw->Dictionary.pData);
+  free(pw->HashTable);
+  free(pw->DictionaryOffsets);
+  free(pw->Indices);
+  free(pw->pScratch);
+  free(pw);
+  cv->pParquet = NULL;
+  return 0;
+}
+
+//the records are decoded into columns on the main thread, row group by row group
+int ExecuteParquetConversion(CONVERTER *cv)
+{
+
+  int iRecords;
+  int iResult;
+  const unsigned char *pRecord;
+  THREADMETRICS tm;
+
+  memset(&tm, 0, sizeof(tm));
+  if (cv->iNumberOfThreads > 1) {
+    fprintf(stdout, "%s %s [INFO]: Parquet output is converted on a single thread.\n", GetDateTime(), sUUID);
+  }
+  //parts of a sharded output open and close their Parquet files themselves
+  if (cv->iShards == 0) {
+    OpenParquet(cv);
+  }
+  while ((pRecord = ReadRecords(cv, cv->pReadBuffer, 1, &iRecords)) != NULL) {
+    NextPartIfFull(cv);
+    if ((iResult = ParquetAddRecord(cv, pRecord)) < 0 && RejectRecord(cv, cv->iCurrentRecord, pRecord) != 0) {
+      break;
+    }
+    tm.lFiltered += (iResult > 0);
+    cv->lPartRecords += (iResult == 0);
+    cv->iCurrentRecord++;
+    if (++tm.lRecords == METRICS_FLUSH_RECORDS) {
+      FlushThreadMetrics(cv, &tm);
+    }
+    COUNT_ALLOCATIONS(cv, cv->pParquet->iRowGroups > 0);
+  }
+  STOP_COUNTING_ALLOCATIONS();
+  FlushThreadMetrics(cv, &tm);
+  if (cv->iShards == 0) {
+    CloseParquet(cv);
+  }
+  return 0;
+}
+
+//sink thread of a fan-out: converts every chunk read into the output of its sink, in the format of the sink
+void *SinkWorker(void *pArg)
+{
+
+  SINKTHREAD *st = (SINKTHREAD *) pArg;
+  FANOUT *fo = st->fo;
+  CONVERTER *cv = st->cv;
+  CHUNK *pChunk;
+  const unsigned char *pRecord;
+  int i;
+  int iLength;
+  THREADMETRICS tm;
+
+  memset(&tm, 0, sizeof(tm));
+  if (cv->iShards > 0) {
+    OpenPart(cv);
+  }
+  else if (cv->iOutputFormat == FORMAT_PARQUET) {
+    OpenParquet(cv);
+  }
+  for (;;) {
+    pthread_mutex_lock(&fo->mutex);
+    while (st->lNextToConvert >= fo->lNextToRead && !fo->iEndOfInput) {
+      pthread_cond_wait(&fo->cond, &fo->mutex);
+    }
+    if (st->lNextToConvert >= fo->lNextToRead) {
+      pthread_mutex_unlock(&fo->mutex);
+      break;
+    }
+    pChunk = &fo->Chunks[st->lNextToConvert % fo->iNumberOfChunks];
+    pthread_mutex_unlock(&fo->mutex);
+
+    //a sink aborted by its rejected records ends the conversion of the file, the others let the chunks pass
+    for (i = 0; i < pChunk->iRecords && !__atomic_load_n(&fo->cv->iAbort, __ATOMIC_RELAXED); i++) {
+      pRecord = &pChunk->pRecords[(size_t) i * cv->iInputRecordLength];
+      NextPartIfFull(cv);
+      if (cv->iOutputFormat == FORMAT_PARQUET) {
+        iLength = ParquetAddRecord(cv, pRecord);
+        tm.lFiltered += (iLength > 0);
+        cv->lPartRecords += (iLength == 0);
+        if (++tm.lRecords == METRICS_FLUSH_RECORDS) {
+          FlushThreadMetrics(cv, &tm);
+        }
+      }
+      else if ((iLength = ConvertRecordMetered(cv, pRecord, ReserveOutput(&cv->Output), &tm)) >= 0) {
+        CommitOutput(&cv->Output, iLength);
+        cv->lPartRecords += (iLength > 0);
+        cv->lPartBytes += iLength;
+      }
+      //shards reject for the file as a whole, sinks each for their own output
+      if (iLength < 0 && RejectRecord((cv->iShards > 1) ? fo->cv : cv, pChunk->lFirstRecord + i, pRecord) != 0) {
+        __atomic_store_n(&fo->cv->iAbort, 1, __ATOMIC_RELAXED);
+      }
+    }
+
+    pthread_mutex_lock(&fo->mutex);
+    if (--pChunk->iPending == 0) {
+      pthread_cond_broadcast(&fo->cond);
+    }
+    pthread_mutex_unlock(&fo->mutex);
+    st->lNextToConvert += fo->iStride;
+    COUNT_ALLOCATIONS(fo->cv, cv->iOutputFormat != FORMAT_PARQUET || cv->pParquet->iRowGroups > 0);
+  }
+  STOP_COUNTING_ALLOCATIONS();
+  FlushThreadMetrics(cv, &tm);
+  if (cv->iShards > 0) {
+    ClosePart(cv);
+  }
+  else if (cv->iOutputFormat == FORMAT_PARQUET) {
+    CloseParquet(cv);
+  }
+  return NULL;
+}
+
+//fan-out: the main thread reads the input once in record-aligned chunks, the output file and every sink convert
+//each chunk on a thread of their own, a chunk is read into again once all of them are done with it,
+//parallel shards take turns instead, chunk n is converted by shard n % shards only
+int ExecuteFanOutConversion(CONVERTER *cv)
+{
+
+  int i;
+  FANOUT fo;
+  CHUNK *pChunk;
+  SINKTHREAD Threads[MAX_THREADS];
+
+  memset(&fo, 0, sizeof(fo));
+  fo.cv = cv;
+  fo.iRecordsPerChunk = (CHUNK_SIZE / cv->iInputRecordLength) + 1;
+  if (cv->iShards > 1) {
+    fo.iSinks = fo.iStride = cv->iShards;
+    fo.iNumberOfChunks = 2 * cv->iShards;
+  }
+  else {
+    fo.iSinks = cv->iSinks + 1;
+    fo.iStride = 1;
+    fo.iNumberOfChunks = FANOUT_CHUNKS;
+  }
+  if ((fo.Chunks = (CHUNK *) calloc(fo.iNumberOfChunks, sizeof(CHUNK))) == NULL) {
+    fprintf(stdout, "%s %s [ERROR]: Can't allocate chunk table.\n", GetDateTime(), sUUID);
+    exit(-1);
+  }
+  //a mapped input file is converted straight from the mapping, no read buffers required unless records are gathered
+  for (i = 0; i < fo.iNumberOfChunks && (cv->pInputMap == NULL || cv->iRecordFormat != RECFM_F); i++) {
+    if ((fo.Chunks[i].pReadBuffer = (unsigned char *) malloc((size_t) fo.iRecordsPerChunk * cv->iInputRecordLength)) == NULL) {
+      fprintf(stdout, "%s %s [ERROR]: Can't allocate chunk buffers.\n", GetDateTime(), sUUID);
+      exit(-1);
+    }
+  }
+  pthread_mutex_init(&fo.mutex, NULL);
+  pthread_cond_init(&fo.cond, NULL);
+
+  if (cv->iShards > 1) {
+    fprintf(stdout, "%s %s [INFO]: Shards: %d, records per chunk: %d\n", GetDateTime(), sUUID, fo.iSinks, fo.iRecordsPerChunk);
+  }
+  else {
+    if (cv->iNumberOfThreads > 1) {
+      fprintf(stdout, "%s %s [INFO]: Every output of a fan-out is converted on a single thread.\n", GetDateTime(), sUUID);
+    }
+    fprintf(stdout, "%s %s [INFO]: Fan-out: %d outputs, records per chunk: %d\n", GetDateTime(), sUUID, fo.iSinks, fo.iRecordsPerChunk);
+  }
+  for (i = 0; i < fo.iSinks; i++) {
+    Threads[i].fo = &fo;
+    Threads[i].cv = (cv->iShards > 1) ? cv->Shards[i] : (i == 0) ? cv : cv->Sinks[i - 1];
+    Threads[i].lNextToConvert = (cv->iShards > 1) ? i : 0;
+    if (cv->iSinks > 0 && i > 0) {
+      StartOutput(Threads[i].cv);
+    }
+    if (pthread_create(&Threads[i].Thread, NULL, SinkWorker, &Threads[i]) != 0) {
+      fprintf(stdout, "%s %s [ERROR]: Can't create sink thread.\n", GetDateTime(), sUUID);
+      exit(-1);
+    }
+  }
+
+  while (!fo.iEndOfInput) {
+    pChunk = &fo.Chunks[fo.lNextToRead % fo.iNumberOfChunks];
+    pthread_mutex_lock(&fo.mutex);
+    while (pChunk->iPending > 0) {
+      pthread_cond_wait(&fo.cond, &fo.mutex);
+    }
+    pthread_mutex_unlock(&fo.mutex);
+    pChunk->pRecords = (unsigned char *) ReadRecords(cv, pChunk->pReadBuffer, fo.iRecordsPerChunk, &pChunk->iRecords);
+    pChunk->lFirstRecord = cv->iCurrentRecord;
+    cv->iCurrentRecord += pChunk->iRecords;
+    pthread_mutex_lock(&fo.mutex);
+    if (pChunk->iRecords > 0) {
+      pChunk->iPending = (fo.iStride > 1) ? 1 : fo.iSinks;
+      fo.lNextToRead++;
+    }
+    if (pChunk->iRecords < fo.iRecordsPerChunk || __atomic_load_n(&cv->iAbort, __ATOMIC_RELAXED)) {
+      fo.iEndOfInput = 1;
+    }
+    pthread_cond_broadcast(&fo.cond);
+    pthread_mutex_unlock(&fo.mutex);
+    COUNT_ALLOCATIONS(cv, 1);
+  }
+  STOP_COUNTING_ALLOCATIONS();
+
+  for (i = 0; i < fo.iSinks; i++) {
+    pthread_join(Threads[i].Thread, NULL);
+  }
+  for (i = 0; i < cv->iSinks; i++) {
+    if (CloseOutput(cv->Sinks[i]) != 0) {
+      cv->iAbort = 1;
+    }
+  }
+  //a part of a shard that could not be written fails the file as a whole
+  for (i = 0; i < cv->iShards && cv->iShards > 1; i++) {
+    cv->iAbort |= cv->Shards[i]->iAbort;
+  }
+  pthread_cond_destroy(&fo.cond);
+  pthread_mutex_destroy(&fo.mutex);
+  for (i = 0; i < fo.iNumberOfChunks; i++) {
+    free(fo.Chunks[i].pReadBuffer);
+  }
+  free(fo.Chunks);
+  return 0;
+}
+
+int ExecuteCSVConversion(CONVERTER *cv)
+{
+
+  int iWriteLength;
+  int iRecords;
+  const unsigned char *pRecord;
+  THREADMETRICS tm;
+
+  //we need a valid converter, so it must not be NULL
+  if (cv != NULL) {
+    //allocate the read buffer, records are converted straight into the output blocks
+    if ((cv->pReadBuffer = (unsigned char *) malloc(cv->iInputRecordLength)) != NULL) {
+      //print statistics
+      fprintf(stdout, "%s %s [INFO]: Number of Attributes: %4d\n", GetDateTime(), sUUID, cv->iNumberOfAttributes);
+      fprintf(stdout, "%s %s [INFO]: Input Record Length:  %4d\n", GetDateTime(), sUUID, cv->iInputRecordLength);
+      fprintf(stdout, "%s %s [INFO]: Output Record Length: %4d\n", GetDateTime(), sUUID, cv->iOutputRecordLength);
+      fprintf(stdout, "%s %s [INFO]: Input file:  %s\n", GetDateTime(), sUUID, cv->sInputFileName);
+      fprintf(stdout, "%s %s [INFO]: Output file: %s\n", GetDateTime(), sUUID, cv->sOutputFileName);
+      //compressed input is decompressed on its own thread, otherwise the input file is mapped if possible
+      if (OpenInputStream(cv) != 0 && cv->iUseMmap) {
+        MapInputFile(cv);
+      }
+      //variable length records are read into fixed length slots, a mapped input is indexed first
+      if (cv->iRecordFormat != RECFM_F) {
+        PrepareVariableRecords(cv);
+        if (cv->pInputMap != NULL) {
+          IndexVariableRecords(cv);
+        }
+      }
+      //parallel shards start their parts on their own threads
+      if (cv->iShards == 0) {
+        StartOutput(cv);
+      }
+      else if (cv->iShards == 1) {
+        OpenPart(cv);
+      }
+      cv->iCurrentRecord = 1 + cv->lResumeRecords;
+      cv->lInputPosition = 0;
+      if (cv->lResumeRecords > 0 && SkipInputRecords(cv, cv->lResumeRecords) != 0) {
+        fprintf(stdout, "%s %s [ERROR]: Input file %s is shorter than its checkpoint.\n", GetDateTime(), sUUID, cv->sInputFileName);
+        cv->iAbort = 1;
+      }
+      else if (cv->lResumeRecords > 0 && cv->lInputPosition != cv->lResumeInput) {
+        fprintf(stdout, "%s %s [ERROR]: Input file %s doesn't match its checkpoint: record %ld ends at offset %ld instead of %ld.\n", GetDateTime(), sUUID,
+                cv->sInputFileName, cv->lResumeRecords, (long) cv->lInputPosition, (long) cv->lResumeInput);
+        cv->iAbort = 1;
+      }
+      memset(&tm, 0, sizeof(tm));
+      //an input that could not be indexed or positioned is not converted, the file fails
+      if (cv->iAbort) {
+        fprintf(stdout, "%s %s [ERROR]: Conversion of %s aborted!\n", GetDateTime(), sUUID, cv->sInputFileName);
+      }
+      else if (cv->iSinks > 0 || cv->iShards > 1) {
+        ExecuteFanOutConversion(cv);
+      }
+      else if (cv->iOutputFormat == FORMAT_PARQUET) {
+        ExecuteParquetConversion(cv);
+      }
+      else if (cv->iNumberOfThreads > 1) {
+        ExecuteParallelConversion(cv);
+      }
+      else {
+        //go through the file to be converted as long as there is a complete record left
+        while ((pRecord = ReadRecords(cv, cv->pReadBuffer, 1, &iRecords)) != NULL) {
+          //the record is converted straight into the output block
+          NextPartIfFull(cv);
+          if ((iWriteLength = ConvertRecordMetered(cv, pRecord, ReserveOutput(&cv->Output), &tm)) >= 0) {
+            CommitOutput(&cv->Output, iWriteLength);
+            cv->lPartRecords += (iWriteLength > 0);
+            cv->lPartBytes += iWriteLength;
+          }
+          else if (RejectRecord(cv, cv->iCurrentRecord, pRecord) != 0) {
+            break;
+          }
+          cv->iCurrentRecord++;
+          if (cv->iCheckpointSeconds > 0 && (cv->iCurrentRecord & (CHECKPOINT_CHECK_RECORDS - 1)) == 0 && MonotonicSeconds() >= cv->dNextCheckpoint) {
+            CheckpointOutput(cv, cv->lRejected, cv->lInputPosition);
+          }
+          COUNT_ALLOCATIONS(cv, 1);
+        } //end while
+        STOP_COUNTING_ALLOCATIONS();
+        FlushThreadMetrics(cv, &tm);
+      }
+#ifdef E2A_COUNT_ALLOCATIONS
+      if (cv->lSteadyStateAllocations > 0) {
+        fprintf(stdout, "%s %s [ERROR]: Heap allocations after the first record: %ld\n", GetDateTime(), sUUID, cv->lSteadyStateAllocations);
+        cv->iAbort = 1;
+      }
+      else {
+        fprintf(stdout, "%s %s [INFO]: Heap allocations after the first record: 0\n", GetDateTime(), sUUID);
+      }
+#endif
+      if (cv->iShards == 0 && CloseOutput(cv) != 0) {
+        cv->iAbort = 1;
+      }
+      else if (cv->iShards == 1) {
+        ClosePart(cv);
+      }
+    } //malloc pReadBuffer
+    else {
+      fprintf(stdout, "%s %s [ERROR]: Can't allocate read buffer.\n", GetDateTime(), sUUID);
+      exit(-1);
+    }
+  } // malloc CONVERTER
+  else {
+    fprintf(stdout, "%s %s [ERROR]: Converter instance is NULL.\n", GetDateTime(), sUUID);
+    exit(-1);
+  }
+  if (cv->pInputMap != NULL) {
+    munmap(cv->pInputMap, cv->lInputMapSize);
+    cv->pInputMap = NULL;
+  }
+  if (cv->pInputStream != NULL && CloseInputStream(cv) != 0) {
+    cv->iAbort = 1;
+  }
+  if (cv->iRecordFormat != RECFM_F) {
+    if (cv->lShortRecords > 0) {
+      fprintf(stdout, "%s %s [INFO]: %ld records shorter than the metadata, missing fields filled.\n", GetDateTime(), sUUID, cv->lShortRecords);
+    }
+    if (cv->lLongRecords > 0) {
+      fprintf(stdout, "%s %s [WARNING]: %ld records longer than the metadata, cut to %d bytes.\n", GetDateTime(), sUUID, cv->lLongRecords, cv->iInputRecordLength);
+    }
+    free(cv->RecordIndex);
+    free(cv->pPadRecord);
+    free(cv->PadFieldEnds);
+    cv->RecordIndex = NULL;
+    cv->pPadRecord = NULL;
+    cv->PadFieldEnds = NULL;
+  }
+  //done
+  if (cv->lRejected > 0) {
+    fprintf(stdout, "%s %s [WARNING]: %ld records rejected.\n", GetDateTime(), sUUID, cv->lRejected);
+  }
+  if (cv->iAbort) {
+    return -1;
+  }
+  fprintf(stdout, "%s %s [INFO]: Ready.\n", GetDateTime(), sUUID);
+  return 0;
+}
+
+//metadata file required by Produban, one line per output column
+int CreateIngestionMetadataFile(CONVERTER *cv)
+{
+
+  const char dot = '.';
+  const char slash = '/';
+
+  int i;
+  int iDecimalDigits = 0;
+  char sBuffer[255];
+  char *ret;
+  char *pch;
+
+  //table name is the schema file name without path and extension
+  ret = strrchr(cv->sSchema, slash);
+  if (ret == NULL) {
+    ret = cv->sSchema - 1;
+  }
+  if ((pch = strchr(&ret[1], dot)) != NULL) {
+    *pch = '\0';
+  }
+
+  INGESTIONMETADATA im;
+
+  if ((cv->fpIngestionMetadataFile = fopen(cv->sIngestionMetadataFileName, "w+")) != NULL) {
+    fprintf(stdout, "%s %s [INFO]: Output ingestion metadata file: %s\n", GetDateTime(),  sUUID, cv->sIngestionMetadataFileName);
+    for (i = 0; i < cv->iNumberOfColumns; i++) {
+      strcpy(im.sDatabase, cv->sDatabase);
+      strcpy(im.sTable, &ret[1]);
+      im.iFieldposition = i+1;
+      strcpy(im.sFieldname, cv->Metadata[cv->Columns[i]]->sFieldname);
+      switch (cv->Metadata[cv->Columns[i]]->cDatatype) {
+        case 'A':
+        case 'T':
+          strcpy (im.sDatatype, "CHAR");
+          break;
+        //the stored digits decide, not the declared length: a 3 byte packed field declared 40,2 is DECIMAL(5,2),
+        //DECIMAL(length, precision) holds up to 38 digits, wider values are delivered as text
+        case 'P':
+        case 'S':
+          iDecimalDigits = (cv->Metadata[cv->Columns[i]]->iDigits > cv->Metadata[cv->Columns[i]]->iPrecision) ? cv->Metadata[cv->Columns[i]]->iDigits : cv->Metadata[cv->Columns[i]]->iPrecision;
+          if (cv->Metadata[cv->Columns[i]]->iDecimalPath == DECIMAL_DIGITS || iDecimalDigits > MAX_DIGITS_INT128) {
+            strcpy(im.sDatatype, "CHAR");
+          }
+          else if (cv->Metadata[cv->Columns[i]]->iPrecision == 0 && iDecimalDigits <= MAX_DIGITS_LONG) {
+            if (iDecimalDigits < 10) {
+              strcpy(im.sDatatype, "INTEGER");
+            }
+            else {
+              strcpy(im.sDatatype, "BIGINT");
+            }
+          }
+          else {
+            strcpy(im.sDatatype, "DECIMAL");
+          }
+          break;
+        case 'L':
+          strcpy(im.sDatatype, "DATE");
+          break;
+        //binary integers by the values their width holds: 2 and 4 bytes fit INTEGER unless unsigned, 8 bytes BIGINT
+        case 'B':
+          if (cv->Metadata[cv->Columns[i]]->iPrecision > 0 || cv->Metadata[cv->Columns[i]]->iDigits > MAX_DIGITS_LONG + 1) {
+            strcpy(im.sDatatype, "DECIMAL");
+          }
+          else if (cv->Metadata[cv->Columns[i]]->iDigits < 10 || (cv->Metadata[cv->Columns[i]]->iDigits == 10 && !cv->Metadata[cv->Columns[i]]->iUnsigned)) {
+            strcpy(im.sDatatype, "INTEGER");
+          }
+          else {
+            strcpy(im.sDatatype, "BIGINT");
+          }
+          break;
+        case 'F':
+        case 'H':
+          strcpy(im.sDatatype, (cv->Metadata[cv->Columns[i]]->cDatatype == 'F' && cv->Metadata[cv->Columns[i]]->iInputFieldLength == 4) ? "FLOAT" : "DOUBLE");
+          break;
+        default:
+          break;
+      }
+      im.iLength = cv->Metadata[cv->Columns[i]]->iOutputFieldLength;
+      im.iPrecision = cv->Metadata[cv->Columns[i]]->iPrecision;
+      if (cv->Metadata[cv->Columns[i]]->cDatatype == 'B') {
+        im.iLength = cv->Metadata[cv->Columns[i]]->iDigits;
+      }
+      else if (cv->Metadata[cv->Columns[i]]->cDatatype == 'F' || cv->Metadata[cv->Columns[i]]->cDatatype == 'H') {
+        im.iLength = cv->Metadata[cv->Columns[i]]->iInputFieldLength;
+        im.iPrecision = 0;
+      }
+      //dates of every input format are written as YYYY-MM-DD
+      else if (cv->Metadata[cv->Columns[i]]->cDatatype == 'L') {
+        im.iLength = DATE_TEXT_LENGTH;
+      }
+      else if (cv->Metadata[cv->Columns[i]]->cDatatype == 'P' || cv->Metadata[cv->Columns[i]]->cDatatype == 'S') {
+        im.iLength = iDecimalDigits;
+      }
+      //text of a decimal wider than DECIMAL: digits, sign and decimal point, a leading zero if all digits are decimals
+      if (strcmp(im.sDatatype, "CHAR") == 0 && (cv->Metadata[cv->Columns[i]]->cDatatype == 'P' || cv->Metadata[cv->Columns[i]]->cDatatype == 'S')) {
+        im.iLength = ((cv->Metadata[cv->Columns[i]]->iDigits > cv->Metadata[cv->Columns[i]]->iPrecision) ? cv->Metadata[cv->Columns[i]]->iDigits : cv->Metadata[cv->Columns[i]]->iPrecision + 1) + 2;
+        im.iPrecision = 0;
+      }
+      snprintf(sBuffer, sizeof(sBuffer), "%s|%s|%d|%s|%s|%d|%d|%d\n", im.sDatabase, im.sTable, im.iFieldposition, im.sFieldname, im.sDatatype, im.iLength, im.iPrecision, 0);
+      fputs(sBuffer, cv->fpIngestionMetadataFile);
+    }
+    fclose(cv->fpIngestionMetadataFile);
+  }
+  else {
+    fprintf(stdout, "%s %s [ERROR]: Unable to open ingestion metadata file: %s\n", GetDateTime(), sUUID, cv->sIngestionMetadataFileName);
+    return -1;
+  }
+  return 0;
+}
+
+//the converters of the --sink outputs: a sink takes the options of the output file, the keys of its spec
+//override them: format=text|parquet|fixed, compress=gzip|zstd|none, columns=F1,F2,..., where=COND added to the
+//--where conditions and csv=FILE for an ingestion metadata file of its own
+//the metadata is shared, every sink compiles its own record plan and rejects the records it can't decode on its own,
+//a record is listed in the reject file once for every output that dropped it
+int OpenSinks(CONVERTER *cv)
+{
+
+  int i;
+  char *pToken;
+  char *pValue;
+  char *pSave;
+  CONVERTER *pSink;
+
+  for (i = 0; i < cv->iSinkSpecs; i++) {
+    if ((pSink = (CONVERTER *) malloc(sizeof(CONVERTER))) == NULL || (cv->Sinks[cv->iSinks] = pSink, pSink->sSinkSpec = strdup(cv->SinkSpecs[i])) == NULL) {
+      fprintf(stdout, "%s %s [ERROR]: Unable to  create a Converter!\n", GetDateTime(), sUUID);
+      exit(-1);
+    }
+    pValue = pSink->sSinkSpec;
+    *pSink = *cv;
+    pSink->sSinkSpec = pValue;
+    pSink->iSinkSpecs = 0;
+    pSink->iSinks = 0;
+    pSink->pReadBuffer = NULL;
+    pSink->Plan = NULL;
+    pSink->Columns = NULL;
+    pSink->Filters = NULL;
+    pSink->iFilters = 0;
+    pSink->Selectors = NULL;
+    pSink->iSelectors = 0;
+    pSink->sIngestionMetadataFileName[0] = '\0';
+    cv->iSinks++;
+
+    pToken = strtok_r(pSink->sSinkSpec, ":", &pSave);
+    if (pToken == NULL || strlen(pToken) >= sizeof(pSink->sOutputFileName)) {
+      fprintf(stdout, "%s %s [ERROR]: Invalid sink: %s\n", GetDateTime(), sUUID, cv->SinkSpecs[i]);
+      return -1;
+    }
+    strcpy(pSink->sOutputFileName, pToken);
+    while ((pToken = strtok_r(NULL, ":", &pSave)) != NULL) {
+      if ((pValue = strchr(pToken, '=')) == NULL) {
+        fprintf(stdout, "%s %s [ERROR]: Invalid sink option %s in %s\n", GetDateTime(), sUUID, pToken, cv->SinkSpecs[i]);
+        return -1;
+      }
+      *pValue++ = '\0';
+      if (strcmp(pToken, "format") == 0 && strcmp(pValue, "text") == 0) {
+        pSink->iOutputFormat = FORMAT_TEXT;
+      }
+      else if (strcmp(pToken, "format") == 0 && strcmp(pValue, "parquet") == 0) {
+        pSink->iOutputFormat = FORMAT_PARQUET;
+      }
+      else if (strcmp(pToken, "format") == 0 && strcmp(pValue, "fixed") == 0) {
+        pSink->iOutputFormat = FORMAT_FIXED;
+      }
+      else if (strcmp(pToken, "compress") == 0 && strcmp(pValue, "none") == 0) {
+        pSink->iCompression = COMPRESS_NONE;
+      }
+      else if (strcmp(pToken, "compress") == 0 && strcmp(pValue, "gzip") == 0) {
+        pSink->iCompression = COMPRESS_GZIP;
+      }
+#ifdef HAVE_ZSTD
+      else if (strcmp(pToken, "compress") == 0 && strcmp(pValue, "zstd") == 0) {
+        pSink->iCompression = COMPRESS_ZSTD;
+      }
+#endif
+      else if (strcmp(pToken, "columns") == 0) {
+        pSink->sColumns = pValue;
+      }
+      else if (strcmp(pToken, "where") == 0 && pSink->iWhereConditions < MAX_FILTERS) {
+        pSink->Where[pSink->iWhereConditions++] = pValue;
+      }
+      else if (strcmp(pToken, "csv") == 0 && strlen(pValue) < sizeof(pSink->sIngestionMetadataFileName)) {
+        strcpy(pSink->sIngestionMetadataFileName, pValue);
+      }
+      else {
+        fprintf(stdout, "%s %s [ERROR]: Invalid sink option %s=%s in %s\n", GetDateTime(), sUUID, pToken, pValue, cv->SinkSpecs[i]);
+        return -1;
+      }
+    }
+    //compressed blocks don't keep the alignment O_DIRECT requires
+    if (pSink->iCompression != COMPRESS_NONE) {
+      pSink->iDirectOutput = 0;
+    }
+    fprintf(stdout, "%s %s [INFO]: Sink: %s\n", GetDateTime(), sUUID, pSink->sOutputFileName);
+    if (CompileRecordPlan(pSink) != 0) {
+      return -1;
+    }
+    if (OpenOutputFile(pSink) != 0) {
+      fprintf(stdout, "%s %s [ERROR]: Unable to open output file: %s\n", GetDateTime(), sUUID, pSink->sOutputFileName);
+      return -1;
+    }
+    if (pSink->sIngestionMetadataFileName[0] != '\0' && CreateIngestionMetadataFile(pSink) != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+//the converters of the parallel shards: copies of the converter of the file, sharing its metadata and record plan,
+//every shard writes parts of its own
+int OpenShards(CONVERTER *cv)
+{
+
+  int i;
+
+  if (cv->iShards < 2) {
+    return 0;
+  }
+  if ((cv->Shards = (CONVERTER **) calloc(cv->iShards, sizeof(CONVERTER *))) == NULL) {
+    fprintf(stdout, "%s %s [ERROR]: Unable to  create a Converter!\n", GetDateTime(), sUUID);
+    exit(-1);
+  }
+  for (i = 0; i < cv->iShards; i++) {
+    if ((cv->Shards[i] = (CONVERTER *) malloc(sizeof(CONVERTER))) == NULL) {
+      fprintf(stdout, "%s %s [ERROR]: Unable to  create a Converter!\n", GetDateTime(), sUUID);
+      exit(-1);
+    }
+    *cv->Shards[i] = *cv;
+    cv->Shards[i]->Shards = NULL;
+    cv->Shards[i]->iShard = i;
+    cv->Shards[i]->pReadBuffer = NULL;
+  }
+  return 0;
+}
+
+//manifest of a sharded output, <output>.manifest: one line per part with its file name, records, bytes and
+//the crc32 of its bytes as hex, separated by |, in the order of the shards and their parts
+int WriteManifest(CONVERTER *cv)
+{
+
+  int i;
+  int j;
+  int iParts = 0;
+  char sManifest[PATH_MAX];
+  const CONVERTER *pShard;
+  FILE *fp;
+
+  if (snprintf(sManifest, sizeof(sManifest), "%s.manifest", cv->sPartBaseName) >= (int) sizeof(sManifest) || (fp = fopen(sManifest, "w")) == NULL) {
+    fprintf(stdout, "%s %s [ERROR]: Unable to write manifest file %s.manifest\n", GetDateTime(), sUUID, cv->sPartBaseName);
+    return -1;
+  }
+  for (i = 0; i < ((cv->iShards > 1) ? cv->iShards : 1); i++) {
+    pShard = (cv->iShards > 1) ? cv->Shards[i] : cv;
+    for (j = 0; j < pShard->iParts; j++) {
+      fprintf(fp, "%s|%ld|%ld|%08lx\n", pShard->Parts[j].sFileName, pShard->Parts[j].lRecords, pShard->Parts[j].lBytes, pShard->Parts[j].lCrc);
+      iParts++;
+    }
+  }
+  if (fclose(fp) != 0) {
+    fprintf(stdout, "%s %s [ERROR]: Unable to write manifest file %s\n", GetDateTime(), sUUID, sManifest);
+    return -1;
+  }
+  fprintf(stdout, "%s %s [INFO]: Manifest: %s, %d parts\n", GetDateTime(), sUUID, sManifest, iParts);
+  return 0;
+}
+
+//remove the parts of an aborted sharded output
+static void RemoveParts(CONVERTER *cv)
+{
+
+  int i;
+  int j;
+  const CONVERTER *pShard;
+
+  for (i = 0; i < ((cv->iShards > 1) ? cv->iShards : 1); i++) {
+    pShard = (cv->iShards > 1) ? cv->Shards[i] : cv;
+    for (j = 0; j < pShard->iParts; j++) {
+      unlink(pShard->Parts[j].sFileName);
+    }
+  }
+}
+
+//open the files of a converter and run the three main tasks, returns -1 if the file could not be converted
+int ConvertFile(CONVERTER *cv)
+{
+
+  int i;
+  int iRecordLength = 0;
+
+  //the checkpoint decides whether the output file is continued or written from the start
+  if (snprintf(cv->sCheckpointFileName, sizeof(cv->sCheckpointFileName), "%s.ckpt", cv->sOutputFileName) >= (int) sizeof(cv->sCheckpointFileName)) {
+    fprintf(stdout, "%s %s [ERROR]: Output file name too long: %s\n", GetDateTime(), sUUID, cv->sOutputFileName);
+    return -1;
+  }
+  if (cv->iResume && cv->iOutputFormat != FORMAT_PARQUET && (iRecordLength = LoadCheckpoint(cv)) < 0) {
+    return -1;
+  }
+  //open input and output files to read from and write to
+  if ((cv->fpInFile = fopen(cv->sInputFileName, "r")) == NULL) {
+    fprintf(stdout, "%s %s [ERROR]: Unable to open input file: %s\n", GetDateTime(), sUUID, cv->sInputFileName);
+    return -1;
+  }
+  //a sharded output opens its parts as the records arrive, they are named after the output file
+  if (cv->iShards > 0) {
+    strcpy(cv->sPartBaseName, cv->sOutputFileName);
+    cv->Output.fd = -1;
+  }
+  else if (OpenOutputFile(cv) != 0) {
+    fprintf(stdout, "%s %s [ERROR]: Unable to open output file: %s\n", GetDateTime(), sUUID, cv->sOutputFileName);
+    fclose(cv->fpInFile);
+    return -1;
+  }
+  //the three main tasks, in a batch the metadata comes from the schema cache
+  if ((cv->Metadata == NULL && LoadMetadata(cv) != 0) || OpenSinks(cv) != 0 || OpenShards(cv) != 0 || CreateIngestionMetadataFile(cv) != 0) {
+    close(cv->Output.fd);
+    fclose(cv->fpInFile);
+    return -1;
+  }
+  if (cv->lResumeRecords > 0 && iRecordLength != cv->iInputRecordLength) {
+    fprintf(stdout, "%s %s [ERROR]: Checkpoint %s was taken with another record length.\n", GetDateTime(), sUUID, cv->sCheckpointFileName);
+    close(cv->Output.fd);
+    fclose(cv->fpInFile);
+    return -1;
+  }
+  //an aborted conversion leaves no output behind that could be taken for complete,
+  //the checkpoint is only needed as long as the conversion didn't end
+  if (ExecuteCSVConversion(cv) != 0 || (cv->iShards > 0 && WriteManifest(cv) != 0)) {
+    if (cv->iShards > 0) {
+      RemoveParts(cv);
+    }
+    else {
+      unlink(cv->sOutputFileName);
+    }
+    unlink(cv->sCheckpointFileName);
+    unlink(cv->sIngestionMetadataFileName);
+    for (i = 0; i < cv->iSinks; i++) {
+      unlink(cv->Sinks[i]->sOutputFileName);
+    }
+    fclose(cv->fpInFile);
+    return -1;
+  }
+  unlink(cv->sCheckpointFileName);
+  fclose(cv->fpInFile);
+  return 0;
+}
+
+//free what CompileRecordPlan() allocated
+static void FreeRecordPlan(CONVERTER *cv)
+{
+
+  int i;
+
+  if (cv->Plan != NULL) {
+    free(cv->Plan);
+    free(cv->PlanFieldLengths);
+  }
+  free(cv->Columns);
+  for (i = 0; i < cv->iFilters; i++) {
+    free(cv->Filters[i].pText);
+  }
+  free(cv->Filters);
+  for (i = 0; i < cv->iSelectors; i++) {
+    free(cv->Selectors[i].pText);
+  }
+  free(cv->Selectors);
+}
+
+//free a converter, its metadata only if it is not shared with other converters of a batch,
+//its sinks always, they share its metadata but have their own record plan, and its shards, sharing both
+void FreeConverter(CONVERTER *cv, int iFreeMetadata)
+{
+
+  int i;
+
+  if (cv->pReadBuffer != NULL) {
+    free(cv->pReadBuffer);
+  }
+  for (i = 0; i < cv->iSinks; i++) {
+    FreeRecordPlan(cv->Sinks[i]);
+    free(cv->Sinks[i]->sSinkSpec);
+    free(cv->Sinks[i]);
+  }
+  for (i = 0; i < cv->iShards && cv->Shards != NULL; i++) {
+    free(cv->Shards[i]->Parts);
+    free(cv->Shards[i]);
+  }
+  free(cv->Shards);
+  free(cv->Parts);
+  if (iFreeMetadata) {
+    for (i = 0; i < cv->iNumberOfAttributes; i++) {
+      if (cv->Metadata[i] != NULL) {
+        free(cv->Metadata[i]);
+      }
+    }
+    FreeRecordPlan(cv);
+    if (cv->Metadata != NULL) {
+      free(cv->Metadata);
+    }
+    free(cv->AlternativeNames);
+    free(cv->AlternativeParents);
+  }
+  free(cv);
+}
+
+//a manifest line: input file, output file, ingestion metadata file, metadata file (.md) and database,
+//separated by blanks or tabs, empty lines and lines starting with # are skipped
+int LoadBatchManifest(BATCH *pBatch, const char *sManifest)
+{
+
+  int iLine = 0;
+  char sBuffer[5 * PATH_MAX];
+  char sRest[2];
+  FILE *fpManifest;
+  BATCHENTRY *pEntry;
+
+  if ((fpManifest = fopen(sManifest, "r")) == NULL) {
+    fprintf(stdout, "%s %s [ERROR]: Unable to open batch manifest: %s\n", GetDateTime(), sUUID, sManifest);
+    return -1;
+  }
+  while (fgets(sBuffer, sizeof(sBuffer), fpManifest) != NULL) {
+    iLine++;
+    if (sBuffer[strspn(sBuffer, " \t\r\n")] == '\0' || sBuffer[strspn(sBuffer, " \t")] == '#') {
+      continue;
+    }
+    if ((pBatch->Entries = (BATCHENTRY *) realloc(pBatch->Entries, (pBatch->iEntries + 1) * sizeof(BATCHENTRY))) == NULL) {
+      fprintf(stdout, "%s %s [ERROR]: Unable to allocate batch entries!\n", GetDateTime(), sUUID);
+      exit(-1);
+    }
+    pEntry = &pBatch->Entries[pBatch->iEntries];
+    memset(pEntry, 0, sizeof(BATCHENTRY));
+    if (sscanf(sBuffer, "%4095s %4095s %4095s %4095s %39s %1s", pEntry->sInputFileName, pEntry->sOutputFileName, pEntry->sIngestionMetadataFileName,
+               pEntry->sSchema, pEntry->sDatabase, sRest) != 5) {
+      fprintf(stdout, "%s %s [ERROR]: Batch manifest %s, line %d: expected <input> <output> <metadata output> <metadata input> <database>\n", GetDateTime(), sUUID, sManifest, iLine);
+      fclose(fpManifest);
+      return -1;
+    }
+    pBatch->iEntries++;
+  }
+  fclose(fpManifest);
+  return 0;
+}
+
+//the parsed metadata of a schema, loaded by the first file that needs it and shared by all others
+static const CONVERTER *GetBatchSchema(BATCH *pBatch, const char *sSchema)
+{
+
+  int i;
+  time_t tModified;
+  struct stat st;
+  CONVERTER *cv;
+
+  tModified = (stat(sSchema, &st) == 0) ? st.st_mtime : 0;
+  pthread_mutex_lock(&pBatch->mutex);
+  for (i = 0; i < pBatch->iSchemas; i++) {
+    if (strcmp(pBatch->Schemas[i].sSchema, sSchema) == 0 && pBatch->Schemas[i].tModified == tModified) {
+      cv = pBatch->Schemas[i].cv;
+      pthread_mutex_unlock(&pBatch->mutex);
+      return cv;
+    }
+  }
+  if ((pBatch->Schemas = (SCHEMACACHEENTRY *) realloc(pBatch->Schemas, (pBatch->iSchemas + 1) * sizeof(SCHEMACACHEENTRY))) == NULL
+      || (cv = (CONVERTER *) malloc(sizeof(CONVERTER))) == NULL) {
+    fprintf(stdout, "%s %s [ERROR]: Unable to allocate schema cache!\n", GetDateTime(), sUUID);
+    exit(-1);
+  }
+  *cv = *pBatch->pOptions;
+  strcpy(cv->sSchema, sSchema);
+  //a schema that can't be loaded is remembered as well, its files fail without reading it again
+  if (LoadMetadata(cv) != 0) {
+    FreeConverter(cv, 1);
+    cv = NULL;
+  }
+  //an older version of the schema stays in the cache, files still being converted use its plan
+  strcpy(pBatch->Schemas[pBatch->iSchemas].sSchema, sSchema);
+  pBatch->Schemas[pBatch->iSchemas].tModified = tModified;
+  pBatch->Schemas[pBatch->iSchemas].cv = cv;
+  pBatch->iSchemas++;
+  pthread_mutex_unlock(&pBatch->mutex);
+  return cv;
+}
+
+//hand a file to the batch workers
+void QueueBatchEntry(BATCH *pBatch, BATCHENTRY *pEntry)
+{
+  pEntry->pNext = NULL;
+  pthread_mutex_lock(&pBatch->mutex);
+  if (pBatch->pQueueTail != NULL) {
+    pBatch->pQueueTail->pNext = pEntry;
+  }
+  else {
+    pBatch->pQueueHead = pEntry;
+  }
+  pBatch->pQueueTail = pEntry;
+  pthread_cond_signal(&pBatch->condQueued);
+  pthread_mutex_unlock(&pBatch->mutex);
+}
+
+//batch worker thread: converts the queued files one after the other until the queue is closed and empty
+void *BatchWorker(void *pArg)
+{
+
+  BATCH *pBatch = (BATCH *) pArg;
+  BATCHENTRY *pEntry;
+  CONVERTER *cv;
+  const CONVERTER *pSchema;
+  struct timespec tsStart, tsEnd;
+
+  for (;;) {
+    pthread_mutex_lock(&pBatch->mutex);
+    while (pBatch->pQueueHead == NULL && !pBatch->iClosed) {
+      pthread_cond_wait(&pBatch->condQueued, &pBatch->mutex);
+    }
+    if ((pEntry = pBatch->pQueueHead) == NULL) {
+      pthread_mutex_unlock(&pBatch->mutex);
+      break;
+    }
+    if ((pBatch->pQueueHead = pEntry->pNext) == NULL) {
+      pBatch->pQueueTail = NULL;
+    }
+    pthread_mutex_unlock(&pBatch->mutex);
+
+    clock_gettime(CLOCK_MONOTONIC, &tsStart);
+    if ((cv = (CONVERTER *) malloc(sizeof(CONVERTER))) == NULL) {
+      fprintf(stdout, "%s %s [ERROR]: Unable to  create a Converter!\n", GetDateTime(), sUUID);
+      exit(-1);
+    }
+    *cv = *pBatch->pOptions;
+    strcpy(cv->sInputFileName, pEntry->sInputFileName);
+    strcpy(cv->sOutputFileName, pEntry->sOutputFileName);
+    strcpy(cv->sIngestionMetadataFileName, pEntry->sIngestionMetadataFileName);
+    strcpy(cv->sSchema, pEntry->sSchema);
+    strcpy(cv->sDatabase, pEntry->sDatabase);
+    pEntry->iStatus = -1;
+    if ((pSchema = GetBatchSchema(pBatch, pEntry->sSchema)) != NULL) {
+      cv->Metadata = pSchema->Metadata;
+      cv->iNumberOfAttributes = pSchema->iNumberOfAttributes;
+      cv->iInputRecordLength = pSchema->iInputRecordLength;
+      cv->iOutputRecordLength = pSchema->iOutputRecordLength;
+      cv->iWriteRecordSize = pSchema->iWriteRecordSize;
+      cv->iWriteRecordGrowth = pSchema->iWriteRecordGrowth;
+      cv->Plan = pSchema->Plan;
+      cv->iPlanSteps = pSchema->iPlanSteps;
+      cv->PlanFieldLengths = pSchema->PlanFieldLengths;
+      cv->Columns = pSchema->Columns;
+      cv->iNumberOfColumns = pSchema->iNumberOfColumns;
+      cv->Filters = pSchema->Filters;
+      cv->iFilters = pSchema->iFilters;
+      cv->iAlternatives = pSchema->iAlternatives;
+      cv->AlternativeNames = pSchema->AlternativeNames;
+      cv->AlternativeParents = pSchema->AlternativeParents;
+      cv->Selectors = pSchema->Selectors;
+      cv->iSelectors = pSchema->iSelectors;
+      cv->iSelectFields = pSchema->iSelectFields;
+      cv->iOccursMax = pSchema->iOccursMax;
+      cv->iDependingField = pSchema->iDependingField;
+      cv->iOccursPosition = pSchema->iOccursPosition;
+      cv->iOccursLength = pSchema->iOccursLength;
+      pEntry->iStatus = ConvertFile(cv);
+      pEntry->lRecords = (cv->iCurrentRecord > 0) ? cv->iCurrentRecord - 1 : 0;
+      pEntry->lRejected = cv->lRejected;
+    }
+    FreeConverter(cv, 0);
+    clock_gettime(CLOCK_MONOTONIC, &tsEnd);
+    pEntry->dSeconds = (tsEnd.tv_sec - tsStart.tv_sec) + (tsEnd.tv_nsec - tsStart.tv_nsec) / 1e9;
+    fprintf(stdout, "%s %s [INFO]: Batch file %s %s: %ld records in %.2f s\n", GetDateTime(), sUUID, pEntry->sInputFileName,
+            (pEntry->iStatus == 0) ? "converted" : "failed", pEntry->lRecords, pEntry->dSeconds);
+
+    pthread_mutex_lock(&pBatch->mutex);
+    if (pEntry->iStatus == 0) {
+      pBatch->iConverted++;
+    }
+    else {
+      pBatch->iFailed++;
+    }
+    pthread_mutex_unlock(&pBatch->mutex);
+    __atomic_fetch_add((pEntry->iStatus == 0) ? &Metrics.lFiles : &Metrics.lFilesFailed, 1, __ATOMIC_RELAXED);
+    WriteMetricsReports();
+    if (pBatch->iFreeEntries) {
+      free(pEntry);
+    }
+  }
+  return NULL;
+}
+
+//start iJobs batch workers waiting for queued files
+void StartBatch(BATCH *pBatch, const CONVERTER *pOptions, int iJobs)
+{
+
+  int i;
+
+  pBatch->pOptions = pOptions;
+  pBatch->iJobs = iJobs;
+  pthread_mutex_init(&pBatch->mutex, NULL);
+  pthread_cond_init(&pBatch->condQueued, NULL);
+  for (i = 0; i < iJobs; i++) {
+    if (pthread_create(&pBatch->Threads[i], NULL, BatchWorker, pBatch) != 0) {
+      fprintf(stdout, "%s %s [ERROR]: Can't create batch thread.\n", GetDateTime(), sUUID);
+      exit(-1);
+    }
+  }
+}
+
+//close the queue, wait until the workers have converted the queued files and free the schema cache
+void FinishBatch(BATCH *pBatch)
+{
+
+  int i;
+
+  pthread_mutex_lock(&pBatch->mutex);
+  pBatch->iClosed = 1;
+  pthread_cond_broadcast(&pBatch->condQueued);
+  pthread_mutex_unlock(&pBatch->mutex);
+  for (i = 0; i < pBatch->iJobs; i++) {
+    pthread_join(pBatch->Threads[i], NULL);
+  }
+  pthread_cond_destroy(&pBatch->condQueued);
+  pthread_mutex_destroy(&pBatch->mutex);
+  for (i = 0; i < pBatch->iSchemas; i++) {
+    if (pBatch->Schemas[i].cv != NULL) {
+      FreeConverter(pBatch->Schemas[i].cv, 1);
+    }
+  }
+  free(pBatch->Schemas);
+}
+
+//convert all files of a manifest on up to iJobs threads, returns the number of files that failed
+int ExecuteBatch(const CONVERTER *pOptions, const char *sManifest, int iJobs)
+{
+
+  int i;
+  BATCH batch;
+
+  memset(&batch, 0, sizeof(batch));
+  if (LoadBatchManifest(&batch, sManifest) != 0) {
+    exit(-1);
+  }
+  if (iJobs > batch.iEntries) {
+    iJobs = (batch.iEntries > 0) ? batch.iEntries : 1;
+  }
+  fprintf(stdout, "%s %s [INFO]: Batch manifest %s: %d files on %d jobs\n", GetDateTime(), sUUID, sManifest, batch.iEntries, iJobs);
+  StartBatch(&batch, pOptions, iJobs);
+  for (i = 0; i < batch.iEntries; i++) {
+    QueueBatchEntry(&batch, &batch.Entries[i]);
+  }
+  FinishBatch(&batch);
+
+  //summary report, one line per file in the order of the manifest
+  for (i = 0; i < batch.iEntries; i++) {
+    fprintf(stdout, "%s %s [INFO]: Batch summary: %-6s %10ld records %8ld rejected %8.2f s  %s\n", GetDateTime(), sUUID,
+            (batch.Entries[i].iStatus == 0) ? "OK" : "FAILED", batch.Entries[i].lRecords, batch.Entries[i].lRejected, batch.Entries[i].dSeconds,
+            batch.Entries[i].sInputFileName);
+  }
+  fprintf(stdout, "%s %s [INFO]: Batch summary: %d files, %d converted, %d failed, %d schemas parsed\n", GetDateTime(), sUUID,
+          batch.iEntries, batch.iConverted, batch.iFailed, batch.iSchemas);
+  free(batch.Entries);
+  return batch.iFailed;
+}
+
+//set by SIGINT/SIGTERM, the watch stops and the queued files are converted before exiting
+static volatile sig_atomic_t iStopWatch;
+
+static void StopWatch(int iSignal)
+{
+  iStopWatch = 1;
+}
+
+//watch mode: a file closed after writing or moved into the directory is converted to <output dir>/<name>.txt,
+//its schema is the lowercase name up to the first dot in the metadata directory (HIKO.20171201235553911093 -> hiko.md),
+//the same rule e2a.sh applies
+int ExecuteWatch(const CONVERTER *pOptions, const char *sWatchDir, const char *sOutputDir, const char *sMetadataDir, const char *sDatabase, int iJobs)
+{
+
+  int fd;
+  int i;
+  ssize_t lRead;
+  char *p;
+  char sTable[NAME_MAX + 1];
+  const char *sExtension;
+  char Events[64 * (sizeof(struct inotify_event) + NAME_MAX + 1)] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+  const struct inotify_event *pEvent;
+  BATCH batch;
+  BATCHENTRY *pEntry;
+  struct sigaction sa;
+  sigset_t sigStop;
+
+  if ((fd = inotify_init1(IN_CLOEXEC)) == -1 || inotify_add_watch(fd, sWatchDir, IN_CLOSE_WRITE | IN_MOVED_TO) == -1) {
+    fprintf(stdout, "%s %s [ERROR]: Unable to watch directory %s: %s\n", GetDateTime(), sUUID, sWatchDir, strerror(errno));
+    exit(-1);
+  }
+  if (pOptions->iOutputFormat == FORMAT_PARQUET) {
+    sExtension = ".parquet";
+  }
+  else if (pOptions->iCompression == COMPRESS_GZIP) {
+    sExtension = ".txt.gz";
+  }
+  else if (pOptions->iCompression == COMPRESS_ZSTD) {
+    sExtension = ".txt.zst";
+  }
+  else {
+    sExtension = ".txt";
+  }
+
+  //only the watching thread takes SIGINT/SIGTERM, the workers inherit a mask blocking them
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = StopWatch;
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+  sigemptyset(&sigStop);
+  sigaddset(&sigStop, SIGINT);
+  sigaddset(&sigStop, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &sigStop, NULL);
+  memset(&batch, 0, sizeof(batch));
+  batch.iFreeEntries = 1;
+  StartBatch(&batch, pOptions, iJobs);
+  pthread_sigmask(SIG_UNBLOCK, &sigStop, NULL);
+  fprintf(stdout, "%s %s [INFO]: Watching %s on %d jobs, output to %s, metadata from %s\n", GetDateTime(), sUUID, sWatchDir, iJobs, sOutputDir, sMetadataDir);
+
+  while (!iStopWatch) {
+    if ((lRead = read(fd, Events, sizeof(Events))) <= 0) {
+      if (lRead == -1 && errno == EINTR) {
+        continue;
+      }
+      fprintf(stdout, "%s %s [ERROR]: Reading inotify events failed: %s\n", GetDateTime(), sUUID, strerror(errno));
+      break;
+    }
+    for (p = Events; p < Events + lRead; p += sizeof(struct inotify_event) + pEvent->len) {
+      pEvent = (const struct inotify_event *) p;
+      if (pEvent->mask & IN_Q_OVERFLOW) {
+        fprintf(stdout, "%s %s [WARNING]: inotify queue overflow, files may have been missed in %s\n", GetDateTime(), sUUID, sWatchDir);
+      }
+      //hidden files are partial uploads of most FTP servers
+      if (pEvent->len == 0 || (pEvent->mask & IN_ISDIR) || pEvent->name[0] == '.') {
+        continue;
+      }
+      if ((pEntry = (BATCHENTRY *) calloc(1, sizeof(BATCHENTRY))) == NULL) {
+        fprintf(stdout, "%s %s [ERROR]: Unable to allocate batch entry!\n", GetDateTime(), sUUID);
+        exit(-1);
+      }
+      for (i = 0; pEvent->name[i] != '\0' && pEvent->name[i] != '.'; i++) {
+        sTable[i] = tolower((unsigned char) pEvent->name[i]);
+      }
+      sTable[i] = '\0';
+      if (snprintf(pEntry->sInputFileName, PATH_MAX, "%s/%s", sWatchDir, pEvent->name) >= PATH_MAX
+          || snprintf(pEntry->sOutputFileName, PATH_MAX, "%s/%s%s", sOutputDir, pEvent->name, sExtension) >= PATH_MAX
+          || snprintf(pEntry->sIngestionMetadataFileName, PATH_MAX, "%s/%s.csv", sOutputDir, pEvent->name) >= PATH_MAX
+          || snprintf(pEntry->sSchema, PATH_MAX, "%s/%s.md", sMetadataDir, sTable) >= PATH_MAX) {
+        fprintf(stdout, "%s %s [ERROR]: File name too long: %s\n", GetDateTime(), sUUID, pEvent->name);
+        free(pEntry);
+        continue;
+      }
+      strcpy(pEntry->sDatabase, sDatabase);
+      fprintf(stdout, "%s %s [INFO]: New file %s, metadata %s\n", GetDateTime(), sUUID, pEntry->sInputFileName, pEntry->sSchema);
+      QueueBatchEntry(&batch, pEntry);
+    }
+  }
+
+  fprintf(stdout, "%s %s [INFO]: Stopped watching %s, waiting for the queued files\n", GetDateTime(), sUUID, sWatchDir);
+  close(fd);
+  FinishBatch(&batch);
+  fprintf(stdout, "%s %s [INFO]: Watch summary: %d files converted, %d failed, %d schemas parsed\n", GetDateTime(), sUUID,
+          batch.iConverted, batch.iFailed, batch.iSchemas);
+  return batch.iFailed;
+}
+
+//next value of the xorshift generator behind the synthetic test data, reproducible for a seed
+static unsigned long NextRandom(unsigned long *plState)
+{
+  *plState ^= *plState << 13;
+  *plState ^= *plState >> 7;
+  *plState ^= *plState << 17;
+  return *plState;
+}
+
+//a synthetic record for the schema of cv: text with CP273 umlauts, partly filled and blank fields, dates in their format,
+//packed, zoned, binary and float values with a quarter of them negative, the bytes between fields are EBCDIC blanks
+void GenerateRecord(const CONVERTER *cv, const unsigned char (*Asc2Ebc)[256], unsigned char *pRecord, unsigned long *plState)
+{
+
+  static const char sText[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 \xE4\xF6\xFC\xC4\xD6\xDC\xDF-.,/";
+  int i, j;
+  int iLength;
+  int iDigits;
+  int iNegative;
+  int iYear, iMonth, iDay;
+  unsigned int iValue;
+  unsigned long lValue;
+  float fValue;
+  double dValue;
+  char sDate[16];
+  unsigned char *pField;
+  const unsigned char *pAsc2Ebc;
+  const METADATARECORD *pMeta;
+
+  memset(pRecord, 0x40, cv->iInputRecordLength);
+  for (i = 0; i < cv->iNumberOfAttributes; i++) {
+    pMeta = cv->Metadata[i];
+    pAsc2Ebc = Asc2Ebc[FieldCodePage(cv, pMeta) - CodePages];
+    if (pMeta->iInputPosition < 0 || pMeta->iInputPosition + pMeta->iInputFieldLength > cv->iInputRecordLength) {
+      continue;
+    }
+    pField = &pRecord[pMeta->iInputPosition];
+    switch (pMeta->cDatatype) {
+      case 'A':
+      case 'T':
+        //one field in eight is blank, the others are filled up to a random length
+        iLength = (NextRandom(plState) % 8 == 0) ? 0 : 1 + NextRandom(plState) % pMeta->iInputFieldLength;
+        for (j = 0; j < iLength; j++) {
+          pField[j] = pAsc2Ebc[(unsigned char) sText[NextRandom(plState) % (sizeof(sText) - 1)]];
+        }
+        break;
+      //one date in sixteen is blank, the others are written in the format of the metadata
+      case 'L':
+        if (NextRandom(plState) % 16 == 0) {
+          break;
+        }
+        iDay = 1 + NextRandom(plState) % 28;
+        iMonth = 1 + NextRandom(plState) % 12;
+        iYear = 1950 + NextRandom(plState) % 100;
+        if (IS_PACKED_DATE(pMeta)) {
+          iLength = (iYear - 1900) * 10000 + iMonth * 100 + iDay;
+          memset(pField, 0, 4);
+          for (j = 0; j < 7; j++, iLength /= 10) {
+            pField[3 - (j + 1) / 2] |= (iLength % 10) << (((j + 1) % 2) * 4);
+          }
+          pField[3] |= 0x0F;
+          break;
+        }
+        if (pMeta->iDateFormat == DATE_DMY) {
+          iLength = snprintf(sDate, sizeof(sDate), "%02d.%02d.%04d", iDay, iMonth, iYear);
+        }
+        else if (pMeta->iDateFormat == DATE_ISO) {
+          iLength = snprintf(sDate, sizeof(sDate), "%04d-%02d-%02d", iYear, iMonth, iDay);
+        }
+        else if (pMeta->iDateFormat == DATE_YYYYMMDD) {
+          iLength = snprintf(sDate, sizeof(sDate), "%04d%02d%02d", iYear, iMonth, iDay);
+        }
+        else {
+          iLength = snprintf(sDate, sizeof(sDate), "%d%02d%02d%02d", iYear / 100 - 19, iYear % 100, iMonth, iDay);
+        }
+        if (iLength > pMeta->iInputFieldLength) {
+          break;
+        }
+        for (j = 0; j < iLength; j++) {
+          pField[j] = pAsc2Ebc[(unsigned char) sDate[j]];
+        }
+        break;
+      case 'P':
+      case 'S':
+        //significant digits vary from none to all digits of the field
+        iDigits = NextRandom(plState) % (pMeta->iDigits + 1);
+        iNegative = (NextRandom(plState) % 4 == 0);
+        if (pMeta->cDatatype == 'P') {
+          memset(pField, 0, pMeta->iInputFieldLength);
+          for (j = 0; j < iDigits; j++) {
+            //digit j counted from the right, the lowest nibble holds the sign
+            pField[pMeta->iInputFieldLength - 1 - (j + 1) / 2] |= (NextRandom(plState) % 10) << (((j + 1) % 2) * 4);
+          }
+          pField[pMeta->iInputFieldLength - 1] |= iNegative ? 0x0D : 0x0C;
+        }
+        else {
+          memset(pField, 0xF0, pMeta->iInputFieldLength);
+          for (j = 0; j < iDigits; j++) {
+            pField[pMeta->iInputFieldLength - 1 - j] = 0xF0 | (NextRandom(plState) % 10);
+          }
+          pField[pMeta->iInputFieldLength - 1] = (pField[pMeta->iInputFieldLength - 1] & 0x0F) | (iNegative ? 0xD0 : 0xF0);
+        }
+        break;
+      //binary integers of any magnitude the width holds, big-endian
+      case 'B':
+        lValue = NextRandom(plState) >> (NextRandom(plState) % 64);
+        if (pMeta->iInputFieldLength < 8) {
+          lValue &= (1UL << (8 * pMeta->iInputFieldLength - !pMeta->iUnsigned)) - 1;
+        }
+        if (!pMeta->iUnsigned && NextRandom(plState) % 4 == 0) {
+          lValue = -lValue;
+        }
+        for (j = pMeta->iInputFieldLength - 1; j >= 0; j--, lValue >>= 8) {
+          pField[j] = (unsigned char) lValue;
+        }
+        break;
+      //floats: IEEE bits of a random double, hexadecimal floats a random fraction with a normalized first digit
+      case 'F':
+        dValue = ((long) (NextRandom(plState) % 2000000001) - 1000000000) / pow(10, NextRandom(plState) % 12);
+        if (pMeta->iInputFieldLength == 4) {
+          fValue = (float) dValue;
+          memcpy(&iValue, &fValue, 4);
+          lValue = (unsigned long) iValue << 32;
+        }
+        else {
+          memcpy(&lValue, &dValue, 8);
+        }
+        for (j = 0; j < pMeta->iInputFieldLength; j++) {
+          pField[j] = (unsigned char) (lValue >> (56 - 8 * j));
+        }
+        break;
+      case 'H':
+        lValue = NextRandom(plState);
+        pField[0] = ((NextRandom(plState) % 4 == 0) ? 0x80 : 0x00) | (64 - 4 + NextRandom(plState) % 12);
+        pField[1] = 0x10 | (lValue & 0x0F);
+        for (j = 2; j < pMeta->iInputFieldLength; j++) {
+          pField[j] = (unsigned char) (lValue >> (8 * j));
+        }
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+//write lRecords synthetic records for the schema of cv to the file sFileName
+int GenerateTestFile(CONVERTER *cv, const char *sFileName, long lRecords, unsigned long lSeed)
+{
+
+  int i;
+  int fd;
+  long l;
+  size_t lFill = 0;
+  size_t lBufferSize;
+  int j;
+  unsigned char Asc2Ebc[sizeof(CodePages) / sizeof(CODEPAGE)][256];
+  unsigned char *pBuffer;
+  unsigned long lState = lSeed ? lSeed : 1;
+
+  //reverse of every code page, fields may have their own, characters reached by two EBCDIC codes take the lower one
+  for (j = 0; CodePages[j].sName != NULL; j++) {
+    for (i = 255; i >= 0; i--) {
+      Asc2Ebc[j][CodePages[j].pTable[i]] = (unsigned char) i;
+    }
+  }
+  lBufferSize = ((size_t) 1024 * 1024 / cv->iInputRecordLength + 1) * cv->iInputRecordLength;
+  if ((pBuffer = (unsigned char *) malloc(lBufferSize)) == NULL) {
+    fprintf(stdout, "%s %s [ERROR]: Can't allocate generator buffer.\n", GetDateTime(), sUUID);
+    exit(-1);
+  }
+  if ((fd = open(sFileName, O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1) {
+    fprintf(stdout, "%s %s [ERROR]: Unable to open output file: %s\n", GetDateTime(), sUUID, sFileName);
+    free(pBuffer);
+    return -1;
+  }
+  for (l = 0; l < lRecords; l++) {
+    GenerateRecord(cv, (const unsigned char (*)[256]) Asc2Ebc, &pBuffer[lFill], &lState);
+    lFill += cv->iInputRecordLength;
+    if (lFill == lBufferSize || l == lRecords - 1) {
+      if (write(fd, pBuffer, lFill) != (ssize_t) lFill) {
+        fprintf(stdout, "%s %s [ERROR]: Writing %s failed: %s\n", GetDateTime(), sUUID, sFileName, strerror(errno));
+        exit(-1);
+      }
+      lFill = 0;
+    }
+  }
+  close(fd);
+  free(pBuffer);
+  fprintf(stdout, "%s %s [INFO]: Generated %ld records of %d bytes into %s\n", GetDateTime(), sUUID, lRecords, cv->iInputRecordLength, sFileName);
+  return 0;
+}
+
+//benchmark: generate lRecords synthetic records for the schema of cv into a temporary file and time every stage of the
+//conversion on them separately (read, translate, trim, date, decimal), then the whole record plan and the output writer
+int ExecuteBenchmark(CONVERTER *cv, long lRecords, unsigned long lSeed)
+{
+
+  int fd;
+  int i, j;
+  int iBlock;
+  int iStep;
+  int iDate, iYear = 0, iMonth = 0, iDay = 0;
+  long l;
+  ssize_t lRead;
+  size_t lInputSize;
+  size_t lWriteLength;
+  double dStart;
+  const char *sTempDir = (getenv("TMPDIR") != NULL) ? getenv("TMPDIR") : "/tmp";
+  char *pTranslated;
+  char *pTrimmed;
+  char *pField;
+  char *pDest;
+  unsigned char *pInput;
+  unsigned char *pRecord;
+  unsigned char *pWrite;
+  const FIELDPLAN *pStep;
+  TEXTSCAN *pScans;
+  TRIMBUFFER *pTrims;
+  BENCHSTAGE Stages[BENCH_STAGES] = {
+    {"read", 0, 0}, {"translate", 0, 0}, {"trim", 0, 0}, {"date", 0, 0}, {"decimal", 0, 0}, {"convert", 0, 0}, {"write", 0, 0}
+  };
+
+  //the output writer is measured on text, the Parquet writer buffers whole row groups
+  cv->iOutputFormat = FORMAT_TEXT;
+  if (snprintf(cv->sInputFileName, PATH_MAX, "%s/e2a-bench-XXXXXX", sTempDir) >= PATH_MAX
+      || snprintf(cv->sOutputFileName, PATH_MAX, "%s/e2a-bench-XXXXXX", sTempDir) >= PATH_MAX
+      || (fd = mkstemp(cv->sInputFileName)) == -1 || close(fd) != 0 || (fd = mkstemp(cv->sOutputFileName)) == -1 || close(fd) != 0) {
+    fprintf(stdout, "%s %s [ERROR]: Unable to create benchmark files in %s\n", GetDateTime(), sUUID, sTempDir);
+    return -1;
+  }
+  if (GenerateTestFile(cv, cv->sInputFileName, lRecords, lSeed) != 0) {
+    return -1;
+  }
+
+  lInputSize = (size_t) lRecords * cv->iInputRecordLength;
+  pInput = (unsigned char *) malloc(lInputSize + 1);
+  pTranslated = (char *) malloc((size_t) BENCH_BLOCK_RECORDS * cv->iInputRecordLength);
+  pTrimmed = (char *) malloc((size_t) BENCH_BLOCK_RECORDS * (cv->iWriteRecordSize + 1));
+  pWrite = (unsigned char *) malloc((size_t) BENCH_BLOCK_RECORDS * (cv->iWriteRecordSize + 1));
+  pScans = (TEXTSCAN *) malloc((size_t) BENCH_BLOCK_RECORDS * cv->iPlanSteps * sizeof(TEXTSCAN));
+  pTrims = (TRIMBUFFER *) malloc((size_t) BENCH_BLOCK_RECORDS * cv->iPlanSteps * sizeof(TRIMBUFFER));
+  if (pInput == NULL || pTranslated == NULL || pTrimmed == NULL || pWrite == NULL || pScans == NULL || pTrims == NULL) {
+    fprintf(stdout, "%s %s [ERROR]: Can't allocate benchmark buffers.\n", GetDateTime(), sUUID);
+    exit(-1);
+  }
+
+  //read: the generated file back from the page cache
+  dStart = MonotonicSeconds();
+  if ((fd = open(cv->sInputFileName, O_RDONLY)) == -1) {
+    fprintf(stdout, "%s %s [ERROR]: Unable to open input file: %s\n", GetDateTime(), sUUID, cv->sInputFileName);
+    exit(-1);
+  }
+  for (l = 0; (size_t) l < lInputSize; l += lRead) {
+    if ((lRead = read(fd, &pInput[l], (lInputSize - l < 1024 * 1024) ? lInputSize - l : 1024 * 1024)) <= 0) {
+      fprintf(stdout, "%s %s [ERROR]: Reading %s failed\n", GetDateTime(), sUUID, cv->sInputFileName);
+      exit(-1);
+    }
+  }
+  close(fd);
+  Stages[BENCH_READ].dSeconds = MonotonicSeconds() - dStart;
+  Stages[BENCH_READ].lBytes = lInputSize;
+
+  //the field stages run block by block, so the translated text of a block is still in the cache when it is trimmed
+  for (l = 0; l < lRecords; l += BENCH_BLOCK_RECORDS) {
+    iBlock = (lRecords - l < BENCH_BLOCK_RECORDS) ? lRecords - l : BENCH_BLOCK_RECORDS;
+
+    dStart = MonotonicSeconds();
+    for (i = 0; i < iBlock; i++) {
+      pRecord = &pInput[(l + i) * cv->iInputRecordLength];
+      for (iStep = 0, pStep = cv->Plan; iStep < cv->iPlanSteps; iStep++, pStep++) {
+        if (pStep->cDatatype == 'A' || pStep->cDatatype == 'T' || pStep->Handler == HandleDate) {
+          convert((unsigned char *) &pTranslated[i * cv->iInputRecordLength + pStep->iInputPosition],
+                  &pRecord[pStep->iInputPosition], pStep->iInputFieldLength, pStep->pTable, &pScans[i * cv->iPlanSteps + iStep]);
+        }
+      }
+    }
+    Stages[BENCH_TRANSLATE].dSeconds += MonotonicSeconds() - dStart;
+
+    dStart = MonotonicSeconds();
+    for (i = 0; i < iBlock; i++) {
+      for (iStep = 0, pStep = cv->Plan; iStep < cv->iPlanSteps; iStep++, pStep++) {
+        pField = &pTranslated[i * cv->iInputRecordLength + pStep->iInputPosition];
+        pDest = &pTrimmed[i * (cv->iWriteRecordSize + 1) + pStep->iInputPosition];
+        if (pStep->Handler == HandleTextRun || pStep->Handler == HandleTextRunUtf8) {
+          pTrims[i * cv->iPlanSteps + iStep].iLength = TrimTextRun(pStep, pField, &pScans[i * cv->iPlanSteps + iStep], pDest);
+        }
+        else if (pStep->cDatatype == 'A' || pStep->cDatatype == 'T') {
+          trim(pDest, pField, pStep->iInputFieldLength, &pTrims[i * cv->iPlanSteps + iStep], &pScans[i * cv->iPlanSteps + iStep]);
+        }
+        else {
+          continue;
+        }
+        //UTF-8 is part of trimming, only fields with characters outside of ASCII are expanded
+        if (cv->iEncoding == ENCODING_UTF8 && pScans[i * cv->iPlanSteps + iStep].iHigh) {
+          pTrims[i * cv->iPlanSteps + iStep].iLength = ExpandUtf8(pDest, pTrims[i * cv->iPlanSteps + iStep].iLength, pStep->cEuro);
+        }
+      }
+    }
+    Stages[BENCH_TRIM].dSeconds += MonotonicSeconds() - dStart;
+
+    //date: parsed between the blanks the translation found, packed dates straight from the record
+    dStart = MonotonicSeconds();
+    for (i = 0; i < iBlock; i++) {
+      pRecord = &pInput[(l + i) * cv->iInputRecordLength];
+      for (iStep = 0, pStep = cv->Plan; iStep < cv->iPlanSteps; iStep++, pStep++) {
+        if (pStep->cDatatype != 'L') {
+          continue;
+        }
+        if (pStep->Handler == HandlePackedDate) {
+          iDate = ParsePackedDate(&pRecord[pStep->iInputPosition], &iYear, &iMonth, &iDay);
+        }
         else {
-          fprintf(stdout, "%s %s [ERROR]: Unable to allocate metadata table!\n", GetDateTime(), sUUID);
-          exit(-1);
+          pField = &pTranslated[i * cv->iInputRecordLength + pStep->iInputPosition];
+          iDate = (pScans[i * cv->iPlanSteps + iStep].iFirst < 0) ? DATE_NULL
+                  : ParseDate(&pField[pScans[i * cv->iPlanSteps + iStep].iFirst], pScans[i * cv->iPlanSteps + iStep].iLast - pScans[i * cv->iPlanSteps + iStep].iFirst + 1,
+                              pStep->iDateFormat, &iYear, &iMonth, &iDay);
         }
-        cv->iNumberOfAttributes++;
-        i++;
+        PutDate(pStep, &pTrimmed[i * (cv->iWriteRecordSize + 1) + pStep->iInputPosition], iDate, iYear, iMonth, iDay);
+        sDecodeError = NULL;
       }
     }
-    fclose(fpMetadataFile);
+    Stages[BENCH_DATE].dSeconds += MonotonicSeconds() - dStart;
+
+    dStart = MonotonicSeconds();
+    for (i = 0; i < iBlock; i++) {
+      pRecord = &pInput[(l + i) * cv->iInputRecordLength];
+      for (j = 0, pStep = cv->Plan; j < cv->iPlanSteps; j++, pStep++) {
+        if (pStep->cDatatype != 'A' && pStep->cDatatype != 'T' && pStep->cDatatype != 'L') {
+          pStep->Handler(pStep, pRecord, &pTrimmed[i * (cv->iWriteRecordSize + 1) + pStep->iInputPosition]);
+        }
+      }
+    }
+    Stages[BENCH_DECIMAL].dSeconds += MonotonicSeconds() - dStart;
   }
-  else {
-    fprintf(stdout, "%s %s [ERROR]: Unable to open metadata file %s!\n", GetDateTime(), sUUID, cv->sSchema);
+  for (j = 0, pStep = cv->Plan; j < cv->iPlanSteps; j++, pStep++) {
+    if (pStep->cDatatype == 'A' || pStep->cDatatype == 'T') {
+      Stages[BENCH_TRANSLATE].lBytes += (long) lRecords * pStep->iInputFieldLength;
+      Stages[BENCH_TRIM].lBytes += (long) lRecords * pStep->iInputFieldLength;
+    }
+    else if (pStep->cDatatype == 'L') {
+      Stages[BENCH_TRANSLATE].lBytes += (pStep->Handler == HandleDate) ? (long) lRecords * pStep->iInputFieldLength : 0;
+      Stages[BENCH_DATE].lBytes += (long) lRecords * pStep->iInputFieldLength;
+    }
+    else {
+      Stages[BENCH_DECIMAL].lBytes += (long) lRecords * pStep->iInputFieldLength;
+    }
+  }
+
+  //convert: the whole record plan, write: the converted blocks through the output writer into a temporary file
+  if (OpenOutputFile(cv) != 0) {
+    fprintf(stdout, "%s %s [ERROR]: Unable to open output file: %s\n", GetDateTime(), sUUID, cv->sOutputFileName);
     exit(-1);
   }
-  fprintf(stdout, "%s %s [INFO]: Metadata file %s successfully processed.\n", GetDateTime(), sUUID, cv->sSchema);
+  StartOutput(cv);
+  for (l = 0; l < lRecords; l += BENCH_BLOCK_RECORDS) {
+    iBlock = (lRecords - l < BENCH_BLOCK_RECORDS) ? lRecords - l : BENCH_BLOCK_RECORDS;
+    dStart = MonotonicSeconds();
+    for (i = 0, lWriteLength = 0; i < iBlock; i++) {
+      lWriteLength += ConvertRecord(cv, &pInput[(l + i) * cv->iInputRecordLength], &pWrite[lWriteLength]);
+    }
+    Stages[BENCH_CONVERT].dSeconds += MonotonicSeconds() - dStart;
+    dStart = MonotonicSeconds();
+    WriteOutput(&cv->Output, pWrite, lWriteLength);
+    Stages[BENCH_WRITE].dSeconds += MonotonicSeconds() - dStart;
+    Stages[BENCH_WRITE].lBytes += lWriteLength;
+  }
+  dStart = MonotonicSeconds();
+  CloseOutput(cv);
+  Stages[BENCH_WRITE].dSeconds += MonotonicSeconds() - dStart;
+  Stages[BENCH_CONVERT].lBytes = lInputSize;
+
+  fprintf(stdout, "%s %s [INFO]: Benchmark: %ld records of %d bytes, %d attributes in %d plan steps, translation kernel %s\n", GetDateTime(), sUUID,
+          lRecords, cv->iInputRecordLength, cv->iNumberOfAttributes, cv->iPlanSteps, sTranslateKernel);
+  for (i = 0; i < BENCH_STAGES; i++) {
+    fprintf(stdout, "%s %s [INFO]: Benchmark %-10s %8.3f s %10.1f MB/s %14.0f records/s\n", GetDateTime(), sUUID, Stages[i].sName, Stages[i].dSeconds,
+            (Stages[i].dSeconds > 0) ? Stages[i].lBytes / Stages[i].dSeconds / (1024 * 1024) : 0.0,
+            (Stages[i].dSeconds > 0) ? lRecords / Stages[i].dSeconds : 0.0);
+  }
+
+  unlink(cv->sInputFileName);
+  unlink(cv->sOutputFileName);
+  free(pInput);
+  free(pTranslated);
+  free(pTrimmed);
+  free(pWrite);
+  free(pScans);
+  free(pTrims);
   return 0;
 }
 
-int ConvertDateToEuro(TRIMBUFFER *parm)
+//--self-test: every translation kernel this cpu runs against the scalar table lookup and the decimal formatting,
+//returns -1 on any difference
+int ExecuteSelfTest(void)
 {
 
-  const int SIZE_OF_THE_DATE = 10;
-  const int DIGITS_IN_YEAR = 4;
-
-  //converting char array to the string so it can be used in strtok()
-  //size changed from 10 to 11, because of the NULL endings.
-  char sTmpBuffer[SIZE_OF_THE_DATE + 1];
-  memcpy(sTmpBuffer, parm->pBuffer, SIZE_OF_THE_DATE);
-  sTmpBuffer[SIZE_OF_THE_DATE + 1] = '\0';
+  int iErrors = 0;
 
-  //extract date parts
-  char *pDayTok, *pMonTok, *pYearTokWithEnding;
-
-  //date tokenized by dots. assumed format: 01.01.0001
-  pDayTok = strtok(sTmpBuffer, ".");
-  pMonTok = strtok(NULL, ".");
-  pYearTokWithEnding = strtok(NULL, ".");
-  
-  //remove NULL ending from the char array
-  char pYearTok[DIGITS_IN_YEAR];
-  memcpy(pYearTok, pYearTokWithEnding, DIGITS_IN_YEAR);
-
-  //copying to the result char array with skipped NULL char.
-  char resultBuffer[SIZE_OF_THE_DATE];
-  strcpy(resultBuffer, pYearTok);
-  strcat(resultBuffer, "-");
-  strcat(resultBuffer, pMonTok);
-  strcat(resultBuffer, "-");
-  strcat(resultBuffer, pDayTok);
-
-  strcpy(parm->pBuffer, resultBuffer);
+#if defined(__x86_64__) || defined(__i386__)
+  if (__builtin_cpu_supports("avx2")) {
+    iErrors += TestTranslationKernel(TranslateAVX2, "avx2");
+  }
+  if (__builtin_cpu_supports("sse4.1")) {
+    iErrors += TestTranslationKernel(TranslateSSE41, "sse4.1");
+  }
+#endif
+  iErrors += TestDecimalFormatting();
+  iErrors += TestDecimalDecoding();
+  iErrors += TestTextConditions();
+  if (iErrors > 0) {
+    fprintf(stdout, "%s %s [ERROR]: Self-test failed: %d differences\n", GetDateTime(), sUUID, iErrors);
+    return -1;
+  }
+  fprintf(stdout, "%s %s [INFO]: Self-test passed.\n", GetDateTime(), sUUID);
   return 0;
 }
 
-int ExecuteCSVConversion(CONVERTER *cv)
+void PrintUsage(void)
 {
+  fprintf(stdout, "Usage: ./e2a [options] <input file ebcdic> <output file ascii .txt> <output file metadata .csv> <input file metadata .md> <system> <some number>\n");
+  fprintf(stdout, "  - input file:      name/path of the ebdic input file\n");
+  fprintf(stdout, "  - output file:     name/path of the ascii file (.txt)\n");
+  fprintf(stdout, "  - metadata output: name/path of metadata output file (.csv))\n");
+  fprintf(stdout, "  - metadata input:  name/path of the metaddata input file (.md) or of a COBOL copybook (.cpy, .cbl, .cob, .copy)\n");
+  fprintf(stdout, "  - system:          name of the system (e.g. as400)\n");
+  fprintf(stdout, "  - uuid:            number used for logging purpose (generated in the wrapper)\n");
+  fprintf(stdout, "   or: ./e2a [options] --batch <manifest> <some number>\n");
+  fprintf(stdout, "  - manifest:        one file per line: <input file> <output file> <metadata output> <metadata input> <system>\n");
+  fprintf(stdout, "   or: ./e2a [options] --watch <directory> --output-dir <directory> <system> <some number>\n");
+  fprintf(stdout, "   or: ./e2a [options] --generate N <output file ebcdic> <input file metadata .md> <some number>\n");
+  fprintf(stdout, "   or: ./e2a [options] --benchmark N <input file metadata .md> <some number>\n");
+  fprintf(stdout, "   or: ./e2a --self-test <some number>\n");
+  fprintf(stdout, "Options:\n");
+  fprintf(stdout, "  -t, --threads N    convert record-aligned chunks on N worker threads (default 1)\n");
+  fprintf(stdout, "      --no-mmap      read the input file with fread() instead of mapping it\n");
+  fprintf(stdout, "      --recfm F|V|VB|VS|VBS  record format of the input: fixed length (default) or variable length records with RDW,\n");
+  fprintf(stdout, "                     blocked with BDW, spanned, short records get blank text and zero decimals, long records are cut,\n");
+  fprintf(stdout, "                     a record ending in the middle of a packed or zoned field is rejected instead\n");
+  fprintf(stdout, "      --output-buffer MB  size of the output blocks written at once (default %d)\n", OUTPUT_BLOCK_SIZE_MB);
+  fprintf(stdout, "      --direct       write the output file with O_DIRECT, bypassing the page cache\n");
+  fprintf(stdout, "      --compress gzip|zstd  compress the output file block by block\n");
+  fprintf(stdout, "      --compress-threads N  compress on N background threads (default 1)\n");
+  fprintf(stdout, "      --format text|parquet|fixed  write pipe-delimited text (default), a Parquet file, --compress applies to its pages,\n");
+  fprintf(stdout, "                     or fixed-width text without separators\n");
+  fprintf(stdout, "      --row-group N  records per Parquet row group (default %d)\n", PARQUET_ROW_GROUP_RECORDS);
+  fprintf(stdout, "      --codepage CP  EBCDIC code page of the input: 273 (default), 1141, 037 or 500, a field can have its own in\n");
+  fprintf(stdout, "                     column 8 of the metadata input (behind description and translation, which can't be empty)\n");
+  fprintf(stdout, "      --encoding latin1|utf8  text output in the ISO-8859 characters of the code page (default, 1141 writes the\n");
+  fprintf(stdout, "                     euro sign as in ISO-8859-15) or in UTF-8, Parquet is always UTF-8, --where values are given in it\n");
+  fprintf(stdout, "      --invalid-dates null|reject  leave invalid dates empty (default) or reject their records like undecodable\n");
+  fprintf(stdout, "                     fields, dates (L) are read as DD.MM.YYYY or in the format of column 3 of the metadata input:\n");
+  fprintf(stdout, "                     L:YYYY-MM-DD, L:YYYYMMDD, L:CYYMMDD (AS400, 4 bytes are packed), all are written as YYYY-MM-DD\n");
+  fprintf(stdout, "      --batch FILE   convert all files listed in the manifest FILE, each metadata file is parsed once\n");
+  fprintf(stdout, "      --jobs N       convert N files of a batch at the same time (default %d)\n", BATCH_JOBS);
+  fprintf(stdout, "      --watch DIR    convert every file completely written or moved into DIR until SIGINT/SIGTERM\n");
+  fprintf(stdout, "      --output-dir DIR  output and metadata output (.csv) of watched files, named after the input file\n");
+  fprintf(stdout, "      --metadata-dir DIR  metadata input (.md) of watched files (default: metadata next to e2a)\n");
+  fprintf(stdout, "      --generate N   write N synthetic records for the metadata input\n");
+  fprintf(stdout, "      --benchmark N  time read, translate, trim, date, decimal, convert and write on N synthetic records\n");
+  fprintf(stdout, "      --seed N       seed of the synthetic records (default 1)\n");
+  fprintf(stdout, "      --self-test    compare the translation kernels of this cpu with the scalar table lookup and the decimal decoding and\n");
+  fprintf(stdout, "                     formatting with snprintf() and \"%%.*Lf\", check conditions on text, exits with -1 on a difference\n");
+  fprintf(stdout, "      --reject-file FILE  write records with undecodable fields to FILE and go on (input|record|field|reason|hex)\n");
+  fprintf(stdout, "      --max-errors N  abort a file after more than N rejected records, its output is removed (default %d)\n", REJECT_MAX_ERRORS);
+  fprintf(stdout, "      --columns F1,F2,...  convert only these fields, in the order of the metadata input\n");
+  fprintf(stdout, "      --where COND   convert only records with FIELD=VALUE (also != < <= > >=) on an A, T, P, S or B field, repeatable\n");
+  fprintf(stdout, "      --when ALT:COND  convert the fields of the copybook REDEFINES alternative ALT only in records with COND (as for\n");
+  fprintf(stdout, "                     --where), the others are left empty, repeatable\n");
+  fprintf(stdout, "      --sink FILE[:format=F][:compress=C][:columns=F1,F2][:where=COND][:csv=FILE]  another output from the same read\n");
+  fprintf(stdout, "                     of the input, converted on a thread of its own, options as for the output file unless given, repeatable\n");
+  fprintf(stdout, "      --shards N     write the output as N parts converted in parallel, listed in <output>.manifest with records, bytes\n");
+  fprintf(stdout, "                     and crc32 (file|records|bytes|crc32), a part is named <output>-part-NNNNN with the extensions of\n");
+  fprintf(stdout, "                     the output behind the number (o.txt: o-part-00000.txt, o.txt.gz: o-part-00000.txt.gz), with\n");
+  fprintf(stdout, "                     --shard-size or --shard-records <output>-part-NNNNN-MMMMM, the shard followed by its part\n");
+  fprintf(stdout, "      --shard-size MB  start the next part once a part holds MB of output (Parquet: after the row group reaching it)\n");
+  fprintf(stdout, "      --shard-records N  start the next part once a part holds N records\n");
+  fprintf(stdout, "      --checkpoint SECONDS  sync the text output and save the position to <output>.ckpt every SECONDS (default %d with --resume)\n", CHECKPOINT_SECONDS);
+  fprintf(stdout, "      --resume       continue after the last checkpoint of the output file, start from the beginning without one\n");
+  fprintf(stdout, "      --metrics FILE  write records, bytes, time per datatype, I/O wait and peak memory as JSON at exit and on SIGUSR1\n");
+  fprintf(stdout, "      --metrics-prom FILE  the same in Prometheus text format, also after every file of a batch or watch\n");
+  fprintf(stdout, "Example: ./e2a /data/fivb/fivb_ebcdic /data/fivb/fivb_ascii.txt /data/fivb/fivb.csv /metadata/fivb.md as400 3b9480f8-0ada-43f0-b943-3f320d1c4f65\n");
+}
 
-  //needed for debug sessions only in date conversions for type L
-  //problem: some tables don't come with the exepected date format dd.mm.yyyy but with dddd-mm-yy, so ConvertDateToEuro() fails.
-  //char sTest[255];
+int main(int argc, char *argv[])
+{
 
-  int i, j;
-  int iLastWritePosition;
-  long double ldUnpacked;
-  unsigned char *pUnpackBuffer;
-  unsigned char *pFormatBuffer;
-  TRIMBUFFER *tb;
+  int iOption;
+  int iNumberOfThreads = 1;
+  int iUseMmap = 1;
+  int iRecordFormat = RECFM_F;
+  int iOutputBlockSizeMB = OUTPUT_BLOCK_SIZE_MB;
+  int iDirectOutput = 0;
+  int iCompression = COMPRESS_NONE;
+  int iCompressThreads = 1;
+  int iOutputFormat = FORMAT_TEXT;
+  int iRowGroupSize = PARQUET_ROW_GROUP_RECORDS;
+  int iCodePage = 0;
+  int iEncoding = ENCODING_LATIN1;
+  int iRejectDates = 0;
+  int iSelfTest = 0;
+  int iJobs = BATCH_JOBS;
+  int iFailed;
+  char *sBatchManifest = NULL;
+  char *sWatchDir = NULL;
+  char *sOutputDir = NULL;
+  char sMetadataDir[PATH_MAX] = "";
+  ssize_t lLength;
+  long lGenerateRecords = 0;
+  long lBenchmarkRecords = 0;
+  unsigned long lSeed = 1;
+  pthread_t MetricsThread;
+  char *sRejectFile = NULL;
+  long lMaxErrors = REJECT_MAX_ERRORS;
+  int iCheckpointSeconds = 0;
+  int iResume = 0;
+  char *sColumns = NULL;
+  const char *Where[MAX_FILTERS] = { NULL };
+  int iWhereConditions = 0;
+  const char *When[MAX_FILTERS] = { NULL };
+  int iWhenConditions = 0;
+  const char *SinkSpecs[MAX_SINKS] = { NULL };
+  int iSinkSpecs = 0;
+  int iShards = 0;
+  long lShardBytes = 0;
+  long lShardRecords = 0;
+  sigset_t sigReport;
+  CONVERTER *cv;
 
-  //we need a valid converter, so it must not be NULL
-  if (cv != NULL) {
-    //allocate read and write buffers based on the record lengths of source and destination files
-    if ((cv->pReadBuffer = (unsigned char *) malloc(cv->iInputRecordLength)) != NULL) {
-      if ((cv->pWriteBuffer = (unsigned char *) malloc(cv->iOutputRecordLength + cv->iNumberOfAttributes)) != NULL) {
-      //print statistics
-        fprintf(stdout, "%s %s [INFO]: Number of Attributes: %4d\n", GetDateTime(), sUUID, cv->iNumberOfAttributes);
-        fprintf(stdout, "%s %s [INFO]: Input Record Length:  %4d\n", GetDateTime(), sUUID, cv->iInputRecordLength);
-        fprintf(stdout, "%s %s [INFO]: Output Record Length: %4d\n", GetDateTime(), sUUID, cv->iOutputRecordLength);
-        fprintf(stdout, "%s %s [INFO]: Input file:  %s\n", GetDateTime(), sUUID, cv->sInputFileName);
-        fprintf(stdout, "%s %s [INFO]: Output file: %s\n", GetDateTime(), sUUID, cv->sOutputFileName);
-        cv->iCurrentRecord = 1;
-        //open the file to be converted
-        while (!feof(cv->fpInFile)) {
-          //only if there still is something to read
-          if ((fread(cv->pReadBuffer, cv->iInputRecordLength, 1, cv->fpInFile)) != 0) {
-            //write buffer should be zero-ed when processing a new record
-            memset(cv->pWriteBuffer, 0, cv->iOutputRecordLength + cv->iNumberOfAttributes);
-            iLastWritePosition = 0;
-            //go through all attributes
-            for (i = 0; i < cv->iNumberOfAttributes; i++) {
-              switch (cv->Metadata[i]->cDatatype) {
-                case 'L':
-                  convert(&cv->pReadBuffer[cv->Metadata[i]->iInputPosition], cv->Metadata[i]->iInputFieldLength);
-                  if ((tb = (TRIMBUFFER *) malloc(sizeof (TRIMBUFFER))) != NULL) {
-                    if ((trim(&cv->pReadBuffer[cv->Metadata[i]->iInputPosition], cv->Metadata[i]->iInputFieldLength, tb)) == 0) {
-                      //debug only, see comment above
-                      //memcpy(sTest, tb->pBuffer, tb->iLength);
-                      //sTest[tb->iLength] = '\0';
-                      //printf("TrimBuffer: %s\n", sTest);
-                      ConvertDateToEuro(tb);
-                      memcpy(&cv->pWriteBuffer[iLastWritePosition], tb->pBuffer, tb->iLength);
-                      iLastWritePosition += tb->iLength;
-                    }
-                    else {
-                      if (tb->pBuffer != NULL) {
-                        free(tb->pBuffer);
-                      }
-                      if (tb != NULL) {
-                        free(tb);
-                      }
-                      fprintf(stderr, "%s %s [Error]: Trim was not successful!\n",  GetDateTime(), sUUID);
-                      exit(-1);
-                    }
-                    if (tb->pBuffer != NULL) {
-                      free(tb->pBuffer);
-                    }
-                    if (tb != NULL) {
-                      free(tb);
-                    }
-                  }
-                  else {
-                    fprintf(stderr, "%s %s [Error]: Can't allocate trim buffer structure!\n",  GetDateTime(), sUUID);
-                    exit(-1);
-                  }
-                  break;
-                case 'A':
-                case 'T':
-                  convert(&cv->pReadBuffer[cv->Metadata[i]->iInputPosition], cv->Metadata[i]->iInputFieldLength);
-                  if ((tb = (TRIMBUFFER *) malloc(sizeof (TRIMBUFFER))) != NULL) {
-                    if ((trim(&cv->pReadBuffer[cv->Metadata[i]->iInputPosition], cv->Metadata[i]->iInputFieldLength, tb)) == 0) {
-                      memcpy(&cv->pWriteBuffer[iLastWritePosition], tb->pBuffer, tb->iLength);
-                      iLastWritePosition += tb->iLength;
-                    }
-                    else {
-                      if (tb->pBuffer != NULL) {
-                        free(tb->pBuffer);
-                      }
-                      if (tb != NULL) {
-                        free(tb);
-                      }
-                      fprintf(stderr, "%s %s [Error]: Trim was not successful!\n",  GetDateTime(), sUUID);
-                      exit(-1);
-                    }
-                    if (tb->pBuffer != NULL) {
-                      free(tb->pBuffer);
-                    }
-                    if (tb != NULL) {
-                      free(tb);
-                    }
-                  }
-                  else {
-                    fprintf(stderr, "%s %s [Error]: Can't allocate trim buffer structure!\n",  GetDateTime(), sUUID);
-                    exit(-1);
-                  }
-                  break;
-                case 'S':
-                  ldUnpacked = 0;
-                  if ((pUnpackBuffer = (unsigned char *) malloc(cv->Metadata[i]->iInputFieldLength)) != NULL) {
-                    memcpy(pUnpackBuffer, &cv->pReadBuffer[cv->Metadata[i]->iInputPosition], cv->Metadata[i]->iInputFieldLength);
-                    ldUnpacked = unzone(pUnpackBuffer, cv->Metadata[i]->iInputFieldLength);
-                    if (pUnpackBuffer != NULL) {
-                      free(pUnpackBuffer);
-                    }
-                    if ((pFormatBuffer = (unsigned char *) malloc(cv->Metadata[i]->iOutputFieldLength)) != NULL) {
-                      //format unpacked value, divide by pow(10, number_of_decimals)
-                      sprintf(pFormatBuffer, "%-*.*Lf", cv->Metadata[i]->iOutputFieldLength, cv->Metadata[i]->iPrecision, ldUnpacked / pow(10, cv->Metadata[i]->iPrecision));
-                      if((tb = (TRIMBUFFER *) malloc(sizeof (TRIMBUFFER))) != NULL) {
-                        if ((trim(pFormatBuffer, cv->Metadata[i]->iOutputFieldLength, tb)) == 0) {
-                          memcpy(&cv->pWriteBuffer[iLastWritePosition], tb->pBuffer, tb->iLength);
-                          iLastWritePosition += tb->iLength;
-                          if (pFormatBuffer != NULL) {
-                            free(pFormatBuffer);
-                          }
-                          if (tb->pBuffer != NULL) {
-                            free(tb->pBuffer);
-                          }
-                          if (tb != NULL) {
-                            free(tb);
-                          }
-                        }
-                        else {
-                          if (pFormatBuffer != NULL) {
-                            free(pFormatBuffer);
-                          }
-                          if (tb->pBuffer != NULL) {
-                            free(tb->pBuffer);
-                          }
-                          if (tb != NULL) {
-                            free(tb);
-                          }
-                          fprintf(stdout, "%s %s [Error]: trim was not successful!\n", GetDateTime(), sUUID);
-                          exit(-1);
-                        }
-                      }
-                      else {
-                        if (pFormatBuffer != NULL) {
-                          free(pFormatBuffer);
-                        }
-                        fprintf(stdout, "%s %s [Error]: Can't allocate trim buffer structure!\n", GetDateTime(), sUUID);
-                        exit(-1);
-                      }
-                    }
-                    else {
-                      if (pUnpackBuffer != NULL) {
-                        free(pUnpackBuffer);
-                      }
-                      fprintf(stdout, "%s %s [Error]: Can't allocate trim buffer!\n", GetDateTime(), sUUID);
-                      exit(-1);
-                    }
-                  }
-                  else {
-                    fprintf(stdout, "%s %s [Error]: Can't allocate unpack buffer!\n", GetDateTime(), sUUID);
-                    exit(-1);
-                  }
-                  break;
-                case 'P':
-                  ldUnpacked = 0;
-                  if ((pUnpackBuffer = (unsigned char *) malloc(cv->Metadata[i]->iInputFieldLength)) != NULL) {
-                    memcpy(pUnpackBuffer, &cv->pReadBuffer[cv->Metadata[i]->iInputPosition], cv->Metadata[i]->iInputFieldLength);
-                    ldUnpacked = unpack(pUnpackBuffer, cv->Metadata[i]->iInputFieldLength);
-                    if (pUnpackBuffer != NULL) {
-                      free(pUnpackBuffer);
-                    }
-                    if ((pFormatBuffer = (unsigned char *) malloc(cv->Metadata[i]->iOutputFieldLength)) != NULL) {
-                      //format unpacked value, divide by pow(10, number_of_decimals)
-                      sprintf(pFormatBuffer, "%-*.*Lf", cv->Metadata[i]->iOutputFieldLength, cv->Metadata[i]->iPrecision, ldUnpacked / pow(10, cv->Metadata[i]->iPrecision));
-                      if ((tb = (TRIMBUFFER *) malloc(sizeof (TRIMBUFFER))) != NULL) {
-                        if ((trim(pFormatBuffer, cv->Metadata[i]->iOutputFieldLength, tb)) == 0) {
-                          memcpy(&cv->pWriteBuffer[iLastWritePosition], tb->pBuffer, tb->iLength);
-                          iLastWritePosition += tb->iLength;
-                          if (pFormatBuffer != NULL) {
-                            free(pFormatBuffer);
-                          }
-                          if (tb->pBuffer != NULL) {
-                            free(tb->pBuffer);
-                          }
-                          if (tb != NULL) {
-                            free(tb);
-                          }
-                        }
-                        else {
-                          if (pFormatBuffer != NULL) {
-                            free(pFormatBuffer);
-                          }
-                          if (tb->pBuffer != NULL) {
-                            free(tb->pBuffer);
-                          }
-                          if (tb != NULL) {
-                            free(tb);
-                          }
-                          fprintf(stdout, "%s %s [Error]: trim was not successful!\n", GetDateTime(), sUUID);
-                          exit(-1);
-                        }
-                      }
-                      else {
-                        if (pFormatBuffer != NULL) {
-                          free(pFormatBuffer);
-                        }
-                        fprintf(stdout, "%s %s [Error]: Can't allocate trim buffer structure!\n", GetDateTime(), sUUID);
-                        exit(-1);
-                      }
-                    }
-                    else {
-                      if (pUnpackBuffer != NULL) {
-                        free(pUnpackBuffer);
-                      }
-                      fprintf(stdout, "%s %s [Error]: Can't allocate trim buffer!\n", GetDateTime(), sUUID);
-                      exit(-1);
-                    }
-                  }
-                  else {
-                    fprintf(stdout, "%s %s [Error]: Can't allocate unpack buffer!\n", GetDateTime(), sUUID);
-                    exit(-1);                  }
-                  break;
-                default:
-                  fprintf(stdout, "%s %s [Error]: Unmanaged Datatype!\n", GetDateTime(), sUUID);
-                  exit(-1);
-              } //end switch
-              if (i < cv->iNumberOfAttributes - 1) {
-                memset(&cv->pWriteBuffer[iLastWritePosition], '|', 1);
-                iLastWritePosition += 1;
-              }
-              else {
-                memset(&cv->pWriteBuffer[iLastWritePosition], '\n', 1);
-              }
-            } //end for
-		        //replace CR/LF characters by some character (~) to avoid line breaks in the output
-		        for (j = 0; j < iLastWritePosition; j++) {
-			        if (cv->pWriteBuffer[j] == '\n' || cv->pWriteBuffer[j] == '\r') {
-				        cv->pWriteBuffer[j] = '~';
-			        }
-		        }
-            //now write buffer to output file and increase record counter
-            fwrite(cv->pWriteBuffer, iLastWritePosition + 1, 1, cv->fpOutFile);
-            cv->iCurrentRecord++;
-          } //end fread
-        } //end while
-      } //malloc pWriteBuffer
-      else {
-        fprintf(stdout, "%s %s [ERROR]: Can't allocate write buffer.\n", GetDateTime(), sUUID);
+  static struct option LongOptions[] = {
+    {"threads", required_argument, NULL, 't'},
+    {"no-mmap", no_argument, NULL, 'M'},
+    {"recfm", required_argument, NULL, 'V'},
+    {"output-buffer", required_argument, NULL, 'B'},
+    {"direct", no_argument, NULL, 'D'},
+    {"compress", required_argument, NULL, 'Z'},
+    {"compress-threads", required_argument, NULL, 'C'},
+    {"format", required_argument, NULL, 'F'},
+    {"row-group", required_argument, NULL, 'R'},
+    {"batch", required_argument, NULL, 'b'},
+    {"jobs", required_argument, NULL, 'j'},
+    {"watch", required_argument, NULL, 'W'},
+    {"output-dir", required_argument, NULL, 'O'},
+    {"metadata-dir", required_argument, NULL, 'm'},
+    {"generate", required_argument, NULL, 'g'},
+    {"benchmark", required_argument, NULL, 'k'},
+    {"seed", required_argument, NULL, 's'},
+    {"metrics", required_argument, NULL, 'J'},
+    {"reject-file", required_argument, NULL, 'r'},
+    {"max-errors", required_argument, NULL, 'e'},
+    {"checkpoint", required_argument, NULL, 'K'},
+    {"resume", no_argument, NULL, 'U'},
+    {"columns", required_argument, NULL, 'c'},
+    {"where", required_argument, NULL, 'w'},
+    {"when", required_argument, NULL, 'x'},
+    {"sink", required_argument, NULL, 'S'},
+    {"shards", required_argument, NULL, 'H'},
+    {"shard-size", required_argument, NULL, 'z'},
+    {"shard-records", required_argument, NULL, 'n'},
+    {"metrics-prom", required_argument, NULL, 'P'},
+    {"codepage", required_argument, NULL, 'p'},
+    {"encoding", required_argument, NULL, 'E'},
+    {"invalid-dates", required_argument, NULL, 'I'},
+    {"self-test", no_argument, NULL, 'T'},
+    {NULL, 0, NULL, 0}
+  };
+
+  Metrics.lStartTicks = ReadTicks();
+  Metrics.dStartSeconds = MonotonicSeconds();
+  while ((iOption = getopt_long(argc, argv, "t:", LongOptions, NULL)) != -1) {
+    switch (iOption) {
+      case 't':
+        iNumberOfThreads = atoi(optarg);
+        if (iNumberOfThreads < 1 || iNumberOfThreads > MAX_THREADS) {
+          fprintf(stdout, "Number of threads must be between 1 and %d\n", MAX_THREADS);
+          exit(-1);
+        }
+        break;
+      case 'M':
+        iUseMmap = 0;
+        break;
+      case 'V':
+        if ((iRecordFormat = (strcmp(optarg, "F") == 0) ? RECFM_F : (strcmp(optarg, "V") == 0) ? RECFM_V : (strcmp(optarg, "VB") == 0) ? RECFM_VB
+                           : (strcmp(optarg, "VS") == 0) ? RECFM_VS : (strcmp(optarg, "VBS") == 0) ? RECFM_VBS : -1) < 0) {
+          fprintf(stdout, "Record format must be F, V, VB, VS or VBS\n");
+          exit(-1);
+        }
+        break;
+      case 'B':
+        iOutputBlockSizeMB = atoi(optarg);
+        if (iOutputBlockSizeMB < 1 || iOutputBlockSizeMB > MAX_OUTPUT_BLOCK_SIZE_MB) {
+          fprintf(stdout, "Output buffer size must be between 1 and %d MB\n", MAX_OUTPUT_BLOCK_SIZE_MB);
+          exit(-1);
+        }
+        break;
+      case 'D':
+        iDirectOutput = 1;
+        break;
+      case 'Z':
+        if (strcmp(optarg, "gzip") == 0) {
+          iCompression = COMPRESS_GZIP;
+        }
+        else if (strcmp(optarg, "zstd") == 0) {
+#ifdef HAVE_ZSTD
+          iCompression = COMPRESS_ZSTD;
+#else
+          fprintf(stdout, "zstd compression requires a build with -DHAVE_ZSTD\n");
+          exit(-1);
+#endif
+        }
+        else {
+          fprintf(stdout, "Compression must be gzip or zstd\n");
+          exit(-1);
+        }
+        break;
+      case 'C':
+        iCompressThreads = atoi(optarg);
+        if (iCompressThreads < 1 || iCompressThreads > MAX_THREADS) {
+          fprintf(stdout, "Number of compress threads must be between 1 and %d\n", MAX_THREADS);
+          exit(-1);
+        }
+        break;
+      case 'F':
+        if (strcmp(optarg, "text") == 0) {
+          iOutputFormat = FORMAT_TEXT;
+        }
+        else if (strcmp(optarg, "parquet") == 0) {
+          iOutputFormat = FORMAT_PARQUET;
+        }
+        else if (strcmp(optarg, "fixed") == 0) {
+          iOutputFormat = FORMAT_FIXED;
+        }
+        else {
+          fprintf(stdout, "Format must be text, parquet or fixed\n");
+          exit(-1);
+        }
+        break;
+      case 'R':
+        iRowGroupSize = atoi(optarg);
+        if (iRowGroupSize < 1) {
+          fprintf(stdout, "Row group size must be at least 1\n");
+          exit(-1);
+        }
+        break;
+      case 'b':
+        sBatchManifest = optarg;
+        break;
+      case 'j':
+        iJobs = atoi(optarg);
+        if (iJobs < 1 || iJobs > MAX_THREADS) {
+          fprintf(stdout, "Number of jobs must be between 1 and %d\n", MAX_THREADS);
+          exit(-1);
+        }
+        break;
+      case 'W':
+        sWatchDir = optarg;
+        break;
+      case 'O':
+        sOutputDir = optarg;
+        break;
+      case 'm':
+        if (strlen(optarg) >= sizeof(sMetadataDir)) {
+          fprintf(stdout, "Metadata directory name too long\n");
+          exit(-1);
+        }
+        strcpy(sMetadataDir, optarg);
+        break;
+      case 'g':
+      case 'k':
+        if (atol(optarg) < 1) {
+          fprintf(stdout, "Number of records must be at least 1\n");
+          exit(-1);
+        }
+        if (iOption == 'g') {
+          lGenerateRecords = atol(optarg);
+        }
+        else {
+          lBenchmarkRecords = atol(optarg);
+        }
+        break;
+      case 's':
+        lSeed = strtoul(optarg, NULL, 10);
+        break;
+      case 'J':
+        Metrics.sJsonFile = optarg;
+        break;
+      case 'r':
+        sRejectFile = optarg;
+        break;
+      case 'e':
+        lMaxErrors = atol(optarg);
+        if (lMaxErrors < 0) {
+          fprintf(stdout, "Maximum number of errors must not be negative\n");
+          exit(-1);
+        }
+        break;
+      case 'K':
+        iCheckpointSeconds = atoi(optarg);
+        if (iCheckpointSeconds < 1) {
+          fprintf(stdout, "Checkpoint interval must be at least 1 second\n");
+          exit(-1);
+        }
+        break;
+      case 'U':
+        iResume = 1;
+        break;
+      case 'c':
+        sColumns = optarg;
+        break;
+      case 'w':
+        if (iWhereConditions == MAX_FILTERS) {
+          fprintf(stdout, "At most %d --where conditions can be given\n", MAX_FILTERS);
+          exit(-1);
+        }
+        Where[iWhereConditions++] = optarg;
+        break;
+      case 'x':
+        if (iWhenConditions == MAX_FILTERS) {
+          fprintf(stdout, "At most %d --when conditions can be given\n", MAX_FILTERS);
+          exit(-1);
+        }
+        When[iWhenConditions++] = optarg;
+        break;
+      case 'S':
+        if (iSinkSpecs == MAX_SINKS) {
+          fprintf(stdout, "At most %d --sink outputs can be given\n", MAX_SINKS);
+          exit(-1);
+        }
+        SinkSpecs[iSinkSpecs++] = optarg;
+        break;
+      case 'H':
+        iShards = atoi(optarg);
+        if (iShards < 1 || iShards > MAX_THREADS) {
+          fprintf(stdout, "Number of shards must be between 1 and %d\n", MAX_THREADS);
+          exit(-1);
+        }
+        break;
+      case 'z':
+        lShardBytes = atol(optarg) * 1024 * 1024;
+        if (lShardBytes < 1) {
+          fprintf(stdout, "Shard size must be at least 1 MB\n");
+          exit(-1);
+        }
+        break;
+      case 'n':
+        lShardRecords = atol(optarg);
+        if (lShardRecords < 1) {
+          fprintf(stdout, "Shard records must be at least 1\n");
+          exit(-1);
+        }
+        break;
+      case 'P':
+        Metrics.sPrometheusFile = optarg;
+        break;
+      case 'p':
+        if ((iCodePage = FindCodePage(optarg)) < 0) {
+          fprintf(stdout, "Code page must be 273, 1141, 037 or 500\n");
+          exit(-1);
+        }
+        break;
+      case 'E':
+        if (strcmp(optarg, "latin1") == 0) {
+          iEncoding = ENCODING_LATIN1;
+        }
+        else if (strcmp(optarg, "utf8") == 0) {
+          iEncoding = ENCODING_UTF8;
+        }
+        else {
+          fprintf(stdout, "Encoding must be latin1 or utf8\n");
+          exit(-1);
+        }
+        break;
+      case 'T':
+        iSelfTest = 1;
+        break;
+      case 'I':
+        if (strcmp(optarg, "null") == 0) {
+          iRejectDates = 0;
+        }
+        else if (strcmp(optarg, "reject") == 0) {
+          iRejectDates = 1;
+        }
+        else {
+          fprintf(stdout, "Invalid dates must be null or reject\n");
+          exit(-1);
+        }
+        break;
+      default:
+        PrintUsage();
         exit(-1);
-      }
-    } //malloc pReadBuffer
-    else {
-      fprintf(stdout, "%s %s [ERROR]: Can't allocate read buffer.\n", GetDateTime(), sUUID);
-      exit(-1);
     }
-  } // malloc CONVERTER
-  else {
-    fprintf(stdout, "%s %s [ERROR]: Converter instance is NULL.\n", GetDateTime(), sUUID);
-    exit(-1);
   }
-  //done
-  fprintf(stdout, "%s %s [INFO]: Ready.\n", GetDateTime(), sUUID);
-  return 0;
-}
 
-//metadata file required by Produban
-int CreateIngestionMetadataFile(CONVERTER *cv)
-{
+  //a resumed conversion goes on taking checkpoints
+  if (iResume && iCheckpointSeconds == 0) {
+    iCheckpointSeconds = CHECKPOINT_SECONDS;
+  }
+  if (iCheckpointSeconds > 0 && iOutputFormat == FORMAT_PARQUET) {
+    fprintf(stdout, "--checkpoint and --resume apply to text output only\n");
+    exit(-1);
+  }
 
-  const char dot = '.';
-  const char slash = '/';
+  //sinks have file names of their own, they go with the conversion of a single file
+  if (iSinkSpecs > 0 && (sBatchManifest != NULL || sWatchDir != NULL || lGenerateRecords > 0 || lBenchmarkRecords > 0 || iCheckpointSeconds > 0)) {
+    fprintf(stdout, "--sink can't be combined with --batch, --watch, --generate, --benchmark, --checkpoint or --resume\n");
+    exit(-1);
+  }
 
-  int i;
-  char sBuffer[255];
-  char *ret;
-  char *pch;
+  //parts one after the other unless --shards is given, the parts of a file can't be continued or fed by sinks
+  if (iShards == 0 && (lShardBytes > 0 || lShardRecords > 0)) {
+    iShards = 1;
+  }
+  if (iShards > 0 && (iSinkSpecs > 0 || iCheckpointSeconds > 0)) {
+    fprintf(stdout, "--shards, --shard-size and --shard-records can't be combined with --sink, --checkpoint or --resume\n");
+    exit(-1);
+  }
 
-  ret = strrchr(cv->sSchema, slash);
-  pch = strchr(ret, dot);
-  ret[pch-ret] = '\0';
+  //generated and benchmarked records are fixed length
+  if (iRecordFormat != RECFM_F && (lGenerateRecords > 0 || lBenchmarkRecords > 0)) {
+    fprintf(stdout, "--recfm can't be combined with --generate or --benchmark\n");
+    exit(-1);
+  }
 
-  INGESTIONMETADATA im;
+  //compressed blocks don't keep the alignment O_DIRECT requires
+  if (iDirectOutput && iCompression != COMPRESS_NONE) {
+    fprintf(stdout, "--direct can't be combined with --compress\n");
+    exit(-1);
+  }
 
-  if ((cv->fpIngestionMetadataFile = fopen(cv->sIngestionMetadataFileName, "w+")) != NULL) {
-    fprintf(stdout, "%s %s [INFO]: Output ingestion metadata file: %s\n", GetDateTime(),  sUUID, cv->sIngestionMetadataFileName);
-    for (i = 0; i < cv->iNumberOfAttributes; i++) {
-      strcpy(im.sDatabase, cv->sDatabase);
-      strcpy(im.sTable, &ret[1]);
-      im.iFieldposition = i+1;
-      strcpy(im.sFieldname, cv->Metadata[i]->sFieldname);
-      switch (cv->Metadata[i]->cDatatype) {
-        case 'A':
-        case 'T':
-          strcpy (im.sDatatype, "CHAR");
-          break;
-        case 'P':
-        case 'S':
-          if (cv->Metadata[i]->iPrecision == 0) {
-            if (cv->Metadata[i]->iOutputFieldLength < 10) {
-              strcpy(im.sDatatype, "INTEGER");
-            }
-            else {
-              strcpy(im.sDatatype, "BIGINT");
-            }
-          }
-          else {
-            strcpy(im.sDatatype, "DECIMAL");
-          }
-          break;
-        case 'L':
-          strcpy(im.sDatatype, "DATE");
-          break;
-        default:
-          break;
-      }
-      im.iLength = cv->Metadata[i]->iOutputFieldLength;
-      im.iPrecision = cv->Metadata[i]->iPrecision;
-      snprintf(sBuffer, sizeof(sBuffer), "%s|%s|%d|%s|%s|%d|%d|%d\n", im.sDatabase, im.sTable, im.iFieldposition, im.sFieldname, im.sDatatype, im.iLength, im.iPrecision, 0);
-      fputs(sBuffer, cv->fpIngestionMetadataFile);
+  //a watched directory needs its own output directory, the output would be picked up as new input otherwise
+  if (sWatchDir != NULL && (sBatchManifest != NULL || sOutputDir == NULL || strcmp(sWatchDir, sOutputDir) == 0)) {
+    fprintf(stdout, "--watch needs an --output-dir different from the watched directory and can't be combined with --batch\n");
+    exit(-1);
+  }
+  //the metadata directory next to the executable, where e2a.sh looks for it
+  if (sWatchDir != NULL && sMetadataDir[0] == '\0') {
+    if ((lLength = readlink("/proc/self/exe", sMetadataDir, sizeof(sMetadataDir) - sizeof("/metadata"))) <= 0) {
+      fprintf(stdout, "Unable to locate the metadata directory, use --metadata-dir\n");
+      exit(-1);
     }
+    sMetadataDir[lLength] = '\0';
+    strcpy(strrchr(sMetadataDir, '/'), "/metadata");
   }
-  fclose(cv->fpIngestionMetadataFile);
-}
-
-int main(int argc, char *argv[])
-{
-
-  int i;
-  CONVERTER *cv;
 
   //command line has too may arguments, there is room for enhancements
-  if (argc != 7) {
-    fprintf(stdout, "Usage: ./e2a <input file ebcdic> <output file ascii .txt> <output file metadata .csv> <input file metadata .md> <system> <some number>\n");
-    fprintf(stdout, "  - input file:      name/path of the ebdic input file\n");
-    fprintf(stdout, "  - output file:     name/path of the ascii file (.txt)\n");
-    fprintf(stdout, "  - metadata output: name/path of metadata output file (.csv))\n");
-    fprintf(stdout, "  - metadata input:  name/path of the metaddata input file (.md)\n");
-    fprintf(stdout, "  - system:          name of the system (e.g. as400)\n");
-    fprintf(stdout, "  - uuid:            number used for logging purpose (generated in the wrapper)\n");
-    fprintf(stdout, "Example: ./e2a /data/fivb/fivb_ebcdic /data/fivb/fivb_ascii.txt /data/fivb/fivb.csv /metadata/fivb.md as400 3b9480f8-0ada-43f0-b943-3f320d1c4f65\n");
-    exit(-1);
-  }
-  //allocate buffer to hold datetime for logging
-  pDateTimeBuffer = (char *) malloc(100);
-  sUUID = (char *) malloc(36);
-  strcpy(sUUID, argv[6]);
-  fprintf(stdout, "%s %s [INFO]: Starting EBCDIC-ASCII File Converter v1.7.5\n", GetDateTime(),  sUUID);
+  //a batch takes the file names from its manifest, only the uuid is left on the command line,
+  //a watch takes them from the directory and keeps system and uuid
+  //--generate writes a file for a schema, --benchmark only needs the schema, --self-test nothing but the uuid
+  if ((lGenerateRecords > 0) + (lBenchmarkRecords > 0) + (sBatchManifest != NULL) + (sWatchDir != NULL) + iSelfTest > 1) {
+    fprintf(stdout, "Only one of --batch, --watch, --generate, --benchmark and --self-test can be given\n");
+    exit(-1);
+  }
+  if (argc - optind != ((sBatchManifest != NULL || iSelfTest) ? 1 : (sWatchDir != NULL || lBenchmarkRecords > 0) ? 2 : (lGenerateRecords > 0) ? 3 : 6)) {
+    PrintUsage();
+    exit(-1);
+  }
+  argv += optind - 1;
+  sUUID = (char *) malloc(strlen(argv[argc - optind]) + 1);
+  strcpy(sUUID, argv[argc - optind]);
+  fprintf(stdout, "%s %s [INFO]: Starting EBCDIC-ASCII File Converter v%s\n", GetDateTime(),  sUUID, E2A_VERSION);
+  InitTranslation();
+  if (iSelfTest) {
+    return (ExecuteSelfTest() == 0) ? 0 : -1;
+  }
 
-  //allocate a CONVERTER structure pointer
-  if ((cv = (CONVERTER *) malloc(sizeof(CONVERTER))) != NULL) {
-    //copy the command line arguments into the structure
-    strcpy(cv->sInputFileName, argv[1]);
-    strcpy(cv->sOutputFileName, argv[2]);
-    strcpy(cv->sIngestionMetadataFileName, argv[3]);
-    strcpy(cv->sSchema, argv[4]);
-    strcpy(cv->sDatabase, argv[5]);
-    //open input and output files to read from and write to
-    if ((cv->fpInFile = fopen(cv->sInputFileName, "r")) != NULL) {
-      if ((cv->fpOutFile = fopen(cv->sOutputFileName, "w+")) != NULL) {
-      //the three main tasks
-        LoadMetadata(cv);
-        CreateIngestionMetadataFile(cv);
-        ExecuteCSVConversion(cv);
-      }
-      else {
-        fprintf(stdout, "%s %s [ERROR]: Unable to open output file: %s\n", GetDateTime(), sUUID, cv->sOutputFileName);
-        exit(-1);
-      }
-    }
-    else {
-      fprintf(stdout, "%s %s [ERROR]: Unable to open input file: %s\n", GetDateTime(), sUUID, &cv->sInputFileName);
+  //metrics reports are written at exit, fatal errors included, and by a thread taking SIGUSR1,
+  //which is blocked before any other thread is created so that they all inherit the mask
+  if (Metrics.sJsonFile != NULL || Metrics.sPrometheusFile != NULL) {
+    sigemptyset(&sigReport);
+    sigaddset(&sigReport, SIGUSR1);
+    pthread_sigmask(SIG_BLOCK, &sigReport, NULL);
+    if (pthread_create(&MetricsThread, NULL, MetricsSignalThread, NULL) != 0) {
+      fprintf(stdout, "%s %s [ERROR]: Can't create metrics thread.\n", GetDateTime(), sUUID);
       exit(-1);
     }
+    pthread_detach(MetricsThread);
+    atexit(WriteMetricsReports);
   }
-  else {
+
+  //allocate a CONVERTER structure pointer
+  if ((cv = (CONVERTER *) calloc(1, sizeof(CONVERTER))) == NULL) {
     fprintf(stdout, "%s %s [ERROR]: Unable to  create a Converter!\n", GetDateTime(), sUUID);
     exit(-1);
   }
-  //close files
-  fclose(cv->fpInFile);
-  fclose(cv->fpOutFile);
-  //free allocated memory
-  if (pDateTimeBuffer != NULL) {
-    free(pDateTimeBuffer);
-  }
-  for (i = 0; i < cv->iNumberOfAttributes; i++) {
-    if (cv->Metadata[i] != NULL) {
-      free(cv->Metadata[i]);
+  cv->iNumberOfThreads = iNumberOfThreads;
+  cv->iUseMmap = iUseMmap;
+  cv->iRecordFormat = iRecordFormat;
+  cv->iOutputBlockSizeMB = iOutputBlockSizeMB;
+  cv->iDirectOutput = iDirectOutput;
+  cv->iCompression = iCompression;
+  cv->iCompressThreads = iCompressThreads;
+  cv->iOutputFormat = iOutputFormat;
+  cv->iRowGroupSize = iRowGroupSize;
+  cv->pCodePage = &CodePages[iCodePage];
+  cv->iEncoding = iEncoding;
+  cv->iRejectDates = iRejectDates;
+  cv->lMaxErrors = lMaxErrors;
+  cv->iCheckpointSeconds = iCheckpointSeconds;
+  cv->iResume = iResume;
+  cv->sColumns = sColumns;
+  memcpy(cv->Where, Where, sizeof(Where));
+  cv->iWhereConditions = iWhereConditions;
+  memcpy(cv->When, When, sizeof(When));
+  cv->iWhenConditions = iWhenConditions;
+  memcpy(cv->SinkSpecs, SinkSpecs, sizeof(SinkSpecs));
+  cv->iSinkSpecs = iSinkSpecs;
+  cv->iShards = iShards;
+  cv->lShardBytes = lShardBytes;
+  cv->lShardRecords = lShardRecords;
+  if (sRejectFile != NULL) {
+    //a resumed run adds to the rejects of the run it continues
+    if ((fpRejectFile = fopen(sRejectFile, iResume ? "a" : "w")) == NULL) {
+      fprintf(stdout, "%s %s [ERROR]: Unable to open reject file: %s\n", GetDateTime(), sUUID, sRejectFile);
+      exit(-1);
     }
+    cv->iRejectRecords = 1;
   }
-  if (cv->pReadBuffer != NULL) {
-    free(cv->pReadBuffer);
-  }
-  if (cv->pWriteBuffer != NULL) {
-    free(cv->pWriteBuffer);
+
+  //in a batch this converter only carries the options copied into the converter of every file
+  if (sBatchManifest != NULL) {
+    iFailed = ExecuteBatch(cv, sBatchManifest, iJobs);
+    free(cv);
+    return (iFailed == 0) ? 0 : -1;
   }
-  if (cv->Metadata != NULL) {
-    free(cv->Metadata);
+  if (lGenerateRecords > 0 || lBenchmarkRecords > 0) {
+    strcpy(cv->sSchema, argv[argc - optind - 1]);
+    if (LoadMetadata(cv) != 0) {
+      exit(-1);
+    }
+    iFailed = (lGenerateRecords > 0) ? GenerateTestFile(cv, argv[1], lGenerateRecords, lSeed) : ExecuteBenchmark(cv, lBenchmarkRecords, lSeed);
+    FreeConverter(cv, 1);
+    return (iFailed == 0) ? 0 : -1;
   }
-  if (cv != NULL) {
+  if (sWatchDir != NULL) {
+    if (strlen(argv[1]) >= sizeof(cv->sDatabase)) {
+      fprintf(stdout, "%s %s [ERROR]: System name too long: %s\n", GetDateTime(), sUUID, argv[1]);
+      exit(-1);
+    }
+    iFailed = ExecuteWatch(cv, sWatchDir, sOutputDir, sMetadataDir, argv[1], iJobs);
     free(cv);
+    return (iFailed == 0) ? 0 : -1;
   }
+
+  //copy the command line arguments into the structure
+  strcpy(cv->sInputFileName, argv[1]);
+  strcpy(cv->sOutputFileName, argv[2]);
+  strcpy(cv->sIngestionMetadataFileName, argv[3]);
+  strcpy(cv->sSchema, argv[4]);
+  strcpy(cv->sDatabase, argv[5]);
+  if (ConvertFile(cv) != 0) {
+    Metrics.lFilesFailed++;
+    exit(-1);
+  }
+  Metrics.lFiles++;
+  //free allocated memory
+  FreeConverter(cv, 1);
   return 0;
 }
@@ -26,6 +26,8 @@
  # #1.0       Dominiczak    2018-01-09  initial version
  # #1.1       Vaehsen       2018-03-14  changes for control m 
  # #1.2       Vaehsen       2018-03-15  adding UUID and z(debug) parameter
+ # #1.3       Ebel          2026-10-16  compressed input no longer gunzipped in place, e2a reads it directly
+ # #1.4       Ebel          2026-10-16  compressed input other than gzip and zstd (compress, bzip2, xz, zip...) fails the run
  ########################################################################################/
 # Parameters.
 INPUT_FILE_PATTERN=""
@@ -161,23 +163,17 @@ then
 fi
 
 echo $(date '+%Y-%m-%d %T.%3N') "$UUID [INFO]: Pattern matched to: $INPUT_FILE_PATTERN" >> $LOG_FILE
-# Make unzipping only in case of zipped file. 
+# Compressed files (gzip, zstd) are decompressed by e2a while converting, no pre-processing here.
+# Any other compression (compress .Z, bzip2, xz, zip...) can't be read by e2a and fails the run.
 # Assumption: zipped or not zipped files will have no .gz extension in the name. 
-# If file is not zipped, skip that part and go stright to the matching metadata file.
 file_description="$(file $INPUT_FILE_PATTERN)"; 
-if [[ $file_description = *'compressed'* ]]; 
+if [[ $file_description = *'gzip compressed'* || $file_description = *'Zstandard compressed'* ]]; 
 then
-	echo $(date '+%Y-%m-%d %T.%3N') "$UUID [INFO]: Found compressed input file. Decompressing starts..."  >> $LOG_FILE
-	
-	# Check if files not ends with .gz and if adding .gz is necessary. 
-	if [[ $INPUT_FILE_PATTERN != *.gz ]]; then
-		echo $(date '+%Y-%m-%d %T.%3N') "$UUID [INFO]: Found no .gz extension during decompressing. Adding .gz extension..."  >> $LOG_FILE
-		mv $INPUT_FILE_PATTERN $INPUT_FILE_PATTERN.gz
-		echo $(date '+%Y-%m-%d %T.%3N') "$UUID [INFO]: Extension .gz added. File renamed in place."  >> $LOG_FILE
-	fi
-	# Actual decompression. 
-	gunzip $INPUT_FILE_PATTERN.gz
-	echo $(date '+%Y-%m-%d %T.%3N') "$UUID [INFO]: Decompression. [DONE]" >> $LOG_FILE
+	echo $(date '+%Y-%m-%d %T.%3N') "$UUID [INFO]: Found compressed input file. Decompressed by the converter."  >> $LOG_FILE
+elif [[ $file_description = *'compress'* || $file_description = *'archive'* ]];
+then
+	echo $(date '+%Y-%m-%d %T.%3N') "$UUID [ERROR]: Found input file compressed other than with gzip or zstd: ${file_description#*: }. Check!."  >> $LOG_FILE
+	exit -1
 elif [[ $INPUT_FILE_PATTERN == *.gz ]];
 then
 	# Not compressed file, with .gz extension. 